@@ -0,0 +1,186 @@
+// Kernel throughput benchmark. Usage: linkit_benchmark [--counters] [--size N] [--repeat N] [filter]
+// --counters adds hardware counters per element (Linux perf_event_open); otherwise, or when
+// the counters cannot be opened, only ns/element is reported. filter selects kernels whose
+// name contains it.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+#include "linkit/matrix3.h"
+#include "linkit/matrix3_batch.h"
+#include "linkit/matrix4.h"
+#include "linkit/perf_counters.h"
+#include "linkit/quaternion.h"
+#include "linkit/spline.h"
+#include "linkit/vector3.h"
+using namespace linkit;
+
+namespace
+{
+    // Batched kernels are driven in slices of this many elements so that parallel_for() runs
+    // them inline on the calling thread, where the counters are attached.
+    constexpr std::size_t slice = 4096;
+
+    struct Kernel
+    {
+        const char* name;
+        std::function<void()> run;
+    };
+
+    template <typename T>
+    void keep(const T& value)
+    {
+#if defined(__GNUC__)
+        asm volatile("" : : "g"(&value) : "memory");
+#else
+        static const void* volatile sink;
+        sink = &value;
+#endif
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    bool counters_mode = false;
+    std::size_t size = 1 << 16;
+    std::size_t repeat = 20;
+    const char* filter = "";
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--counters") == 0) counters_mode = true;
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) size = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = std::strtoull(argv[++i], nullptr, 10);
+        else filter = argv[i];
+    }
+
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<real> uniform(-1, 1);
+    const auto random_vector = [&] { return Vector3(uniform(rng), uniform(rng), uniform(rng)); };
+
+    std::vector<Vector3> vectors(size);
+    std::vector<Quaternion> quaternions(size);
+    std::vector<Matrix3> matrices3(size);
+    std::vector<Matrix3> spd3(size);
+    std::vector<Matrix4> matrices4(size);
+    std::vector<real> parameters(size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        vectors[i] = random_vector();
+        quaternions[i] = Quaternion(uniform(rng), uniform(rng), uniform(rng), uniform(rng));
+        matrices3[i] = Matrix3::rotate(uniform(rng) * PI, random_vector()) * Matrix3::scale(Vector3(2, 1, 0.5));
+        spd3[i] = matrices3[i].transposed() * matrices3[i];
+        matrices4[i] = Matrix4::object_transform_matrix(random_vector(), Quaternion(uniform(rng) * PI, random_vector()), Vector3(1, 2, 3));
+        parameters[i] = (uniform(rng) + 1) * 8;
+    }
+    std::vector<Vector3> control(17);
+    for (Vector3& point : control) point = random_vector();
+    const Spline spline = Spline::catmull_rom(control);
+
+    std::vector<Vector3> vector_out(size);
+    std::vector<Quaternion> quaternion_out(size);
+    std::vector<Matrix3> matrix3_out(size);
+    std::vector<Matrix4> matrix4_out(size);
+    std::vector<SolveStatus> status(size);
+
+    const std::vector<Kernel> kernels = {
+        {"matrix4_multiply", [&] {
+            for (std::size_t i = 0; i + 1 < size; ++i) matrix4_out[i] = matrices4[i] * matrices4[i + 1];
+            keep(matrix4_out);
+        }},
+        {"matrix4_invert", [&] {
+            for (std::size_t i = 0; i < size; ++i) matrix4_out[i] = matrices4[i].inverse();
+            keep(matrix4_out);
+        }},
+        {"matrix4_transform_point", [&] {
+            for (std::size_t i = 0; i < size; ++i) vector_out[i] = matrices4[i] * vectors[i];
+            keep(vector_out);
+        }},
+        {"matrix3_inverse", [&] {
+            for (std::size_t i = 0; i < size; ++i) matrix3_out[i] = matrices3[i].inverse();
+            keep(matrix3_out);
+        }},
+        {"matrix3_batch_invert", [&] {
+            for (std::size_t first = 0; first < size; first += slice)
+            {
+                const std::size_t n = std::min(slice, size - first);
+                invert(std::span<const Matrix3>(matrices3).subspan(first, n), std::span<Matrix3>(matrix3_out).subspan(first, n),
+                       std::span<SolveStatus>(status).subspan(first, n));
+            }
+            keep(matrix3_out);
+        }},
+        {"matrix3_solve", [&] {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                vector_out[i] = vectors[i];
+                matrices3[i].solve(vectors[i], vector_out[i]);
+            }
+            keep(vector_out);
+        }},
+        {"matrix3_batch_solve", [&] {
+            std::copy(vectors.begin(), vectors.end(), vector_out.begin());
+            for (std::size_t first = 0; first < size; first += slice)
+            {
+                const std::size_t n = std::min(slice, size - first);
+                solve(std::span<const Matrix3>(matrices3).subspan(first, n), std::span<Vector3>(vector_out).subspan(first, n),
+                      std::span<SolveStatus>(status).subspan(first, n));
+            }
+            keep(vector_out);
+        }},
+        {"matrix3_batch_solve_spd", [&] {
+            std::copy(vectors.begin(), vectors.end(), vector_out.begin());
+            for (std::size_t first = 0; first < size; first += slice)
+            {
+                const std::size_t n = std::min(slice, size - first);
+                solve_spd(std::span<const Matrix3>(spd3).subspan(first, n), std::span<Vector3>(vector_out).subspan(first, n),
+                          std::span<SolveStatus>(status).subspan(first, n));
+            }
+            keep(vector_out);
+        }},
+        {"quaternion_normalize", [&] {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                quaternion_out[i] = quaternions[i];
+                quaternion_out[i].normalize();
+            }
+            keep(quaternion_out);
+        }},
+        {"quaternion_multiply", [&] {
+            for (std::size_t i = 0; i + 1 < size; ++i) quaternion_out[i] = quaternions[i] * quaternions[i + 1];
+            keep(quaternion_out);
+        }},
+        {"quaternion_rotate", [&] {
+            for (std::size_t i = 0; i < size; ++i) vector_out[i] = quaternions[i].rotate(vectors[i]);
+            keep(vector_out);
+        }},
+        {"quaternion_slerp", [&] {
+            for (std::size_t i = 0; i + 1 < size; ++i) quaternion_out[i] = Quaternion::slerp(quaternions[i], quaternions[i + 1], static_cast<real>(0.3));
+            keep(quaternion_out);
+        }},
+        {"spline_evaluate", [&] {
+            for (std::size_t first = 0; first < size; first += slice)
+            {
+                const std::size_t n = std::min(slice, size - first);
+                spline.evaluate(std::span<const real>(parameters).subspan(first, n), std::span<Vector3>(vector_out).subspan(first, n));
+            }
+            keep(vector_out);
+        }},
+    };
+
+    PerfCounters counters(counters_mode);
+    if (counters_mode && !counters.available())
+        std::fprintf(stderr, "hardware counters unavailable (check kernel.perf_event_paranoid); reporting wall time only\n");
+
+    std::printf("%zu elements x %zu repetitions\n", size, repeat);
+    for (const Kernel& kernel : kernels)
+    {
+        if (std::strstr(kernel.name, filter) == nullptr) continue;
+        const PerfReport report = profile(counters, size, kernel.run, repeat);
+        std::printf("%-24s %s\n", kernel.name, report.to_string().c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#ifndef LINKIT_AABB_H
+#define LINKIT_AABB_H
+#include "precision.h"
+#include "vector3.h"
+#include <algorithm>
+#include <limits>
+#include <string>
+
+namespace linkit
+{
+    // Axis-aligned bounding box described by its minimum and maximum corners.
+    class AABB
+    {
+    public:
+        Vector3 min;
+        Vector3 max;
+
+        AABB() = default;
+        AABB(const Vector3& min, const Vector3& max): min(min), max(max) {}
+
+        static AABB from_center_extents(const Vector3& center, const Vector3& half_extents)
+        {
+            return AABB(center - half_extents, center + half_extents);
+        }
+
+        // Inverted box that any call to expand() replaces.
+        static AABB empty()
+        {
+            constexpr real inf = std::numeric_limits<real>::max();
+            return AABB(Vector3(inf, inf, inf), Vector3(-inf, -inf, -inf));
+        }
+
+        static AABB from_sphere(const Vector3& center, const real radius)
+        {
+            return AABB(center - radius, center + radius);
+        }
+
+        [[nodiscard]] Vector3 center() const
+        {
+            return (min + max) * static_cast<real>(0.5);
+        }
+
+        [[nodiscard]] Vector3 half_extents() const
+        {
+            return (max - min) * static_cast<real>(0.5);
+        }
+
+        [[nodiscard]] bool overlaps(const AABB& other) const
+        {
+            return min.x <= other.max.x && max.x >= other.min.x &&
+                   min.y <= other.max.y && max.y >= other.min.y &&
+                   min.z <= other.max.z && max.z >= other.min.z;
+        }
+
+        [[nodiscard]] bool contains(const Vector3& point) const
+        {
+            return point.x >= min.x && point.x <= max.x &&
+                   point.y >= min.y && point.y <= max.y &&
+                   point.z >= min.z && point.z <= max.z;
+        }
+
+        [[nodiscard]] bool contains(const AABB& other) const
+        {
+            return contains(other.min) && contains(other.max);
+        }
+
+        void expand(const Vector3& point)
+        {
+            min = Vector3(std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z));
+            max = Vector3(std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z));
+        }
+
+        void expand(const AABB& other)
+        {
+            expand(other.min);
+            expand(other.max);
+        }
+
+        [[nodiscard]] std::string to_string() const
+        {
+            return "[" + min.to_string() + " - " + max.to_string() + "]";
+        }
+    };
+
+    // Component access by axis index (0 = x, 1 = y, 2 = z), used by the spatial structures.
+    inline real axis_value(const Vector3& vec, const int axis)
+    {
+        return axis == 0 ? vec.x : (axis == 1 ? vec.y : vec.z);
+    }
+}
+
+#endif //LINKIT_AABB_H
@@ -0,0 +1,123 @@
+#ifndef LINKIT_ACCURACY_H
+#define LINKIT_ACCURACY_H
+#include "precision.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <span>
+#include <string>
+#include <utility>
+
+namespace linkit
+{
+    // Size of one unit in the last place of real at magnitude |x|.
+    inline long double real_ulp(const long double x)
+    {
+        const real magnitude = std::abs(static_cast<real>(x));
+        if (!(magnitude < std::numeric_limits<real>::max())) return std::numeric_limits<real>::max();
+        const real next = std::nextafter(magnitude, std::numeric_limits<real>::infinity());
+        return std::max(static_cast<long double>(next) - magnitude, static_cast<long double>(std::numeric_limits<real>::denorm_min()));
+    }
+
+    // Error of value against a higher-precision reference, in ULPs of real at magnitude scale.
+    // Pass the reference itself as scale for elementwise ULPs, or the largest component of a
+    // vector or matrix result for normwise ULPs (small entries then do not blow up the figure).
+    inline long double ulp_error(const real value, const long double reference, const long double scale)
+    {
+        if (std::isnan(value) != std::isnan(reference)) return std::numeric_limits<long double>::infinity();
+        if (std::isnan(value) || value == reference) return 0;
+        return std::abs(static_cast<long double>(value) - reference) / real_ulp(scale);
+    }
+
+    struct AccuracyStats
+    {
+        long double max_ulp = 0;
+        long double sum_ulp = 0;
+        std::size_t samples = 0;
+        std::size_t worst_input = 0;
+
+        void add(const long double ulp, const std::size_t input)
+        {
+            if (ulp > max_ulp || samples == 0)
+            {
+                max_ulp = std::max(max_ulp, ulp);
+                worst_input = input;
+            }
+            sum_ulp += ulp;
+            ++samples;
+        }
+
+        [[nodiscard]] long double mean_ulp() const
+        {
+            return samples > 0 ? sum_ulp / static_cast<long double>(samples) : 0;
+        }
+    };
+
+    // One row of a differential run: a fast path measured against its reference over an input
+    // set. A max_ulp_budget of 0 only reports; otherwise the row fails when max_ulp exceeds it.
+    struct AccuracyReport
+    {
+        std::string name;
+        std::size_t inputs = 0;
+        AccuracyStats stats;
+        long double max_ulp_budget = 0;
+        double nanoseconds_per_op = 0;
+
+        [[nodiscard]] bool passed() const
+        {
+            return max_ulp_budget <= 0 || stats.max_ulp <= max_ulp_budget;
+        }
+
+        [[nodiscard]] std::string to_string() const
+        {
+            char buffer[256];
+            char budget[32] = "report";
+            if (max_ulp_budget > 0)
+                std::snprintf(budget, sizeof(budget), "%.3Lg", max_ulp_budget);
+            std::snprintf(buffer, sizeof(buffer), "%-36s %8zu  max %12.4Lg  mean %12.4Lg  budget %-8s %9.3f ns/op  %s",
+                          name.c_str(), inputs, stats.max_ulp, stats.mean_ulp(), budget, nanoseconds_per_op,
+                          max_ulp_budget <= 0 ? "" : passed() ? "ok" : "FAIL");
+            return std::string(buffer);
+        }
+    };
+
+    // Differential run of fast(input) -> Output over inputs. compare(input, output, stats, index)
+    // adds the ULP error of each output against a reference computed however it likes (typically
+    // in long double). Throughput is timed separately from the comparison, with the outputs
+    // written to a buffer so the work cannot be optimized away.
+    template <typename Input, typename Output, typename Fast, typename Compare>
+    AccuracyReport measure_accuracy(std::string name, const std::span<const Input> inputs, std::span<Output> outputs,
+                                    Fast&& fast, Compare&& compare, const long double max_ulp_budget = 0)
+    {
+        AccuracyReport report;
+        report.name = std::move(name);
+        report.max_ulp_budget = max_ulp_budget;
+        const std::size_t count = std::min(inputs.size(), outputs.size());
+        report.inputs = count;
+        if (count == 0) return report;
+
+        for (std::size_t i = 0; i < count; ++i)
+            outputs[i] = fast(inputs[i]);
+        for (std::size_t i = 0; i < count; ++i)
+            compare(inputs[i], outputs[i], report.stats, i);
+
+        // Repeat until at least ~20 ms have elapsed for a stable figure
+        std::size_t ops = 0;
+        const auto start = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::steady_clock::duration::zero();
+        do
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                outputs[i] = fast(inputs[i]);
+            ops += count;
+            elapsed = std::chrono::steady_clock::now() - start;
+        }
+        while (elapsed < std::chrono::milliseconds(20));
+        report.nanoseconds_per_op = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(ops);
+        return report;
+    }
+}
+
+#endif //LINKIT_ACCURACY_H
@@ -0,0 +1,485 @@
+#ifndef LINKIT_ANIMATION_H
+#define LINKIT_ANIMATION_H
+#include "precision.h"
+#include "vector3.h"
+#include "quaternion.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define LINKIT_ANIMATION_SSE2 1
+#endif
+
+namespace linkit
+{
+    // Quaternions stored as separate component arrays: element i is (w[i], x[i], y[i], z[i]).
+    struct QuaternionSpans
+    {
+        std::span<const real> w, x, y, z;
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return std::min({w.size(), x.size(), y.size(), z.size()});
+        }
+
+        [[nodiscard]] Quaternion value(const std::size_t i) const
+        {
+            return Quaternion(w[i], x[i], y[i], z[i]);
+        }
+    };
+
+    namespace detail
+    {
+#if defined(LINKIT_ANIMATION_SSE2)
+        // Two consecutive elements of each component, one SSE2 register per component.
+        struct QuaternionPair
+        {
+            __m128d w, x, y, z;
+        };
+
+        template <typename T>
+        QuaternionPair load_quaternion_pair(const T* w, const T* x, const T* y, const T* z, const std::size_t i)
+        {
+            return {_mm_loadu_pd(w + i), _mm_loadu_pd(x + i), _mm_loadu_pd(y + i), _mm_loadu_pd(z + i)};
+        }
+
+        // Transposes the pair back into two consecutive Quaternion structs.
+        template <typename Q>
+        void store_quaternion_pair(const QuaternionPair& q, Q* out)
+        {
+            _mm_storeu_pd(&out[0].w, _mm_unpacklo_pd(q.w, q.x));
+            _mm_storeu_pd(&out[0].y, _mm_unpacklo_pd(q.y, q.z));
+            _mm_storeu_pd(&out[1].w, _mm_unpackhi_pd(q.w, q.x));
+            _mm_storeu_pd(&out[1].y, _mm_unpackhi_pd(q.y, q.z));
+        }
+
+        // b, negated in the lanes where it lies in the other hemisphere from a.
+        inline QuaternionPair align_hemisphere(const QuaternionPair& a, const QuaternionPair& b)
+        {
+            const __m128d dot = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(a.w, b.w), _mm_mul_pd(a.x, b.x)), _mm_mul_pd(a.y, b.y)),
+                                           _mm_mul_pd(a.z, b.z));
+            const __m128d sign = _mm_and_pd(_mm_cmplt_pd(dot, _mm_setzero_pd()), _mm_set1_pd(-0.0));
+            return {_mm_xor_pd(b.w, sign), _mm_xor_pd(b.x, sign), _mm_xor_pd(b.y, sign), _mm_xor_pd(b.z, sign)};
+        }
+
+        inline __m128d squared_norm(const __m128d w, const __m128d x, const __m128d y, const __m128d z)
+        {
+            return _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(w, w), _mm_mul_pd(x, x)), _mm_mul_pd(y, y)), _mm_mul_pd(z, z));
+        }
+
+        inline __m128d blend(const __m128d a, const __m128d wa, const __m128d b, const __m128d wb)
+        {
+            return _mm_add_pd(_mm_mul_pd(a, wa), _mm_mul_pd(b, wb));
+        }
+#endif
+
+        // The arithmetic of one element of the batched nlerp, shared by both layouts.
+        inline Quaternion nlerp_element(const Quaternion& a, const Quaternion& b, const real t)
+        {
+            const real wb = a.dot(b) < 0 ? -t : t;
+            const real wa = 1 - t;
+            const real qw = a.w * wa + b.w * wb;
+            const real qx = a.x * wa + b.x * wb;
+            const real qy = a.y * wa + b.y * wb;
+            const real qz = a.z * wa + b.z * wb;
+            const real inv = static_cast<real>(1.0) / real_sqrt(qw * qw + qx * qx + qy * qy + qz * qz);
+            return Quaternion(qw * inv, qx * inv, qy * inv, qz * inv);
+        }
+
+        // Elements [begin, end) of the structure-of-arrays nlerp. With SSE2 and real = double,
+        // two elements per step; otherwise, and for an odd last element, nlerp_element.
+        template <typename T = real>
+        void nlerp_range(const QuaternionSpans& a, const QuaternionSpans& b, const std::span<const real> t,
+                         const std::span<Quaternion> out, std::size_t i, const std::size_t end)
+        {
+#if defined(LINKIT_ANIMATION_SSE2)
+            if constexpr (std::is_same_v<T, double>)
+            {
+                const T* const tp = t.data();
+                const __m128d one = _mm_set1_pd(1.0);
+                for (; i + 2 <= end; i += 2)
+                {
+                    const QuaternionPair qa = load_quaternion_pair<T>(a.w.data(), a.x.data(), a.y.data(), a.z.data(), i);
+                    const QuaternionPair qb = align_hemisphere(qa, load_quaternion_pair<T>(b.w.data(), b.x.data(), b.y.data(), b.z.data(), i));
+                    const __m128d tb = _mm_loadu_pd(tp + i);
+                    const __m128d ta = _mm_sub_pd(one, tb);
+                    QuaternionPair q = {blend(qa.w, ta, qb.w, tb), blend(qa.x, ta, qb.x, tb), blend(qa.y, ta, qb.y, tb), blend(qa.z, ta, qb.z, tb)};
+                    const __m128d inv = _mm_div_pd(one, _mm_sqrt_pd(squared_norm(q.w, q.x, q.y, q.z)));
+                    q = {_mm_mul_pd(q.w, inv), _mm_mul_pd(q.x, inv), _mm_mul_pd(q.y, inv), _mm_mul_pd(q.z, inv)};
+                    store_quaternion_pair(q, &out[i]);
+                }
+            }
+#endif
+            for (; i < end; ++i)
+                out[i] = nlerp_element(a.value(i), b.value(i), t[i]);
+        }
+
+        // Elements [begin, end) of the structure-of-arrays slerp. The hemisphere select, the
+        // chord lengths and the final blend are done two elements per step as in nlerp_range;
+        // the atan2 and sin calls of Quaternion::slerp_weights stay per element.
+        template <typename T = real>
+        void slerp_range(const QuaternionSpans& a, const QuaternionSpans& b, const std::span<const real> t,
+                         const std::span<Quaternion> out, std::size_t i, const std::size_t end)
+        {
+#if defined(LINKIT_ANIMATION_SSE2)
+            if constexpr (std::is_same_v<T, double>)
+            {
+                const T* const tp = t.data();
+                for (; i + 2 <= end; i += 2)
+                {
+                    const QuaternionPair qa = load_quaternion_pair<T>(a.w.data(), a.x.data(), a.y.data(), a.z.data(), i);
+                    const QuaternionPair qb = align_hemisphere(qa, load_quaternion_pair<T>(b.w.data(), b.x.data(), b.y.data(), b.z.data(), i));
+                    alignas(16) T difference[2], sum[2], wa[2], wb[2];
+                    _mm_store_pd(difference, _mm_sqrt_pd(squared_norm(_mm_sub_pd(qa.w, qb.w), _mm_sub_pd(qa.x, qb.x),
+                                                                      _mm_sub_pd(qa.y, qb.y), _mm_sub_pd(qa.z, qb.z))));
+                    _mm_store_pd(sum, _mm_sqrt_pd(squared_norm(_mm_add_pd(qa.w, qb.w), _mm_add_pd(qa.x, qb.x),
+                                                               _mm_add_pd(qa.y, qb.y), _mm_add_pd(qa.z, qb.z))));
+                    for (std::size_t l = 0; l < 2; ++l)
+                        Quaternion::slerp_weights(difference[l], sum[l], tp[i + l], wa[l], wb[l]);
+                    const __m128d pa = _mm_load_pd(wa), pb = _mm_load_pd(wb);
+                    store_quaternion_pair({blend(qa.w, pa, qb.w, pb), blend(qa.x, pa, qb.x, pb), blend(qa.y, pa, qb.y, pb), blend(qa.z, pa, qb.z, pb)},
+                                          &out[i]);
+                }
+            }
+#endif
+            for (; i < end; ++i)
+                out[i] = Quaternion::slerp(a.value(i), b.value(i), t[i]);
+        }
+    }
+
+    // Batched quaternion interpolation along the shorter arc, out[i] = interpolate(a[i], b[i], t[i]),
+    // spread over the default job system. nlerp is straight-line arithmetic per element (a sign
+    // select and one square root, no calls); slerp is Quaternion::slerp per element. These take
+    // quaternions stored as structs and are not vectorized across elements; the QuaternionSpans
+    // overloads below take separate component arrays and, with SSE2, work on two at a time.
+    inline void nlerp(const std::span<const Quaternion> a, const std::span<const Quaternion> b,
+                      const std::span<const real> t, const std::span<Quaternion> out)
+    {
+        const std::size_t count = std::min({a.size(), b.size(), t.size(), out.size()});
+        parallel_for(count, 8192, [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                out[i] = detail::nlerp_element(a[i], b[i], t[i]);
+        });
+    }
+
+    inline void slerp(const std::span<const Quaternion> a, const std::span<const Quaternion> b,
+                      const std::span<const real> t, const std::span<Quaternion> out)
+    {
+        const std::size_t count = std::min({a.size(), b.size(), t.size(), out.size()});
+        parallel_for(count, 4096, [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                out[i] = Quaternion::slerp(a[i], b[i], t[i]);
+        });
+    }
+
+    // Structure-of-arrays forms of nlerp and slerp with the same results as the overloads above.
+    inline void nlerp(const QuaternionSpans& a, const QuaternionSpans& b, const std::span<const real> t, const std::span<Quaternion> out)
+    {
+        const std::size_t count = std::min({a.size(), b.size(), t.size(), out.size()});
+        parallel_for(count, 8192, [&](const std::size_t begin, const std::size_t end) {
+            detail::nlerp_range(a, b, t, out, begin, end);
+        });
+    }
+
+    inline void slerp(const QuaternionSpans& a, const QuaternionSpans& b, const std::span<const real> t, const std::span<Quaternion> out)
+    {
+        const std::size_t count = std::min({a.size(), b.size(), t.size(), out.size()});
+        parallel_for(count, 4096, [&](const std::size_t begin, const std::size_t end) {
+            detail::slerp_range(a, b, t, out, begin, end);
+        });
+    }
+
+    // Keyframes of one Vector3 channel (translation or scale), stored as separate arrays so key
+    // times can be scanned without touching the values. Times must be strictly increasing.
+    struct Vector3Track
+    {
+        std::vector<real> times;
+        std::vector<real> x, y, z;
+
+        void add_key(const real time, const Vector3& value)
+        {
+            times.push_back(time);
+            x.push_back(value.x);
+            y.push_back(value.y);
+            z.push_back(value.z);
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return times.size();
+        }
+
+        [[nodiscard]] Vector3 value(const std::size_t key) const
+        {
+            return Vector3(x[key], y[key], z[key]);
+        }
+    };
+
+    struct QuaternionTrack
+    {
+        std::vector<real> times;
+        std::vector<real> w, x, y, z;
+
+        void add_key(const real time, const Quaternion& value)
+        {
+            times.push_back(time);
+            w.push_back(value.w);
+            x.push_back(value.x);
+            y.push_back(value.y);
+            z.push_back(value.z);
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return times.size();
+        }
+
+        [[nodiscard]] Quaternion value(const std::size_t key) const
+        {
+            return Quaternion(w[key], x[key], y[key], z[key]);
+        }
+    };
+
+    // Translation, rotation and scale tracks for every bone of a skeleton. A bone whose track
+    // has no keys keeps its bind value (identity rotation, zero translation, unit scale).
+    struct AnimationClip
+    {
+        real duration = 0;
+        std::vector<Vector3Track> translations;
+        std::vector<QuaternionTrack> rotations;
+        std::vector<Vector3Track> scales;
+
+        explicit AnimationClip(const std::size_t bone_count = 0)
+            : translations(bone_count), rotations(bone_count), scales(bone_count) {}
+
+        [[nodiscard]] std::size_t bone_count() const
+        {
+            return rotations.size();
+        }
+    };
+
+    // Local (parent-relative) transforms of a skeleton as parallel TRS arrays.
+    struct LocalPose
+    {
+        std::vector<Vector3> translations;
+        std::vector<Quaternion> rotations;
+        std::vector<Vector3> scales;
+
+        explicit LocalPose(const std::size_t bone_count = 0)
+        {
+            resize(bone_count);
+        }
+
+        void resize(const std::size_t bone_count)
+        {
+            translations.assign(bone_count, Vector3());
+            rotations.assign(bone_count, Quaternion());
+            scales.assign(bone_count, Vector3(1, 1, 1));
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return rotations.size();
+        }
+    };
+
+    // Index k of the key segment [times[k], times[k + 1]] containing time, for times.size() >= 2.
+    // The search starts at cursor and walks forward a few keys before falling back to a binary
+    // search, so playing a clip forward costs O(1) per sample. cursor is updated in place.
+    inline std::uint32_t find_key(const std::span<const real> times, const real time, std::uint32_t& cursor)
+    {
+        const auto last_segment = static_cast<std::uint32_t>(times.size() - 2);
+        std::uint32_t k = std::min(cursor, last_segment);
+        if (time < times[k])
+        {
+            k = 0;
+            if (time > times[1])
+                k = static_cast<std::uint32_t>(std::upper_bound(times.begin(), times.end() - 1, time) - times.begin()) - 1;
+        }
+        else
+        {
+            int steps = 0;
+            while (k < last_segment && time >= times[k + 1] && ++steps <= 4) ++k;
+            if (k < last_segment && time >= times[k + 1])
+                k = static_cast<std::uint32_t>(std::upper_bound(times.begin() + k, times.end() - 1, time) - times.begin()) - 1;
+        }
+        cursor = k;
+        return k;
+    }
+
+    enum class RotationInterpolation
+    {
+        nlerp,
+        slerp
+    };
+
+    // Samples one clip into a LocalPose. Holds a key cursor per track, so keep one sampler per
+    // playing clip instance. Sampling is single-threaded by design: the caller parallelizes over
+    // characters. The segment endpoints of every rotation track are gathered into contiguous
+    // component arrays first and then interpolated with the structure-of-arrays nlerp/slerp.
+    class ClipSampler
+    {
+    public:
+        explicit ClipSampler(const AnimationClip& clip): _clip(&clip)
+        {
+            const std::size_t bones = clip.bone_count();
+            _translation_cursor.assign(bones, 0);
+            _rotation_cursor.assign(bones, 0);
+            _scale_cursor.assign(bones, 0);
+            for (std::vector<real>* component : {&_from_w, &_from_x, &_from_y, &_from_z, &_to_w, &_to_x, &_to_y, &_to_z})
+                component->resize(bones);
+            _alpha.resize(bones);
+        }
+
+        // Writes the pose at time into pose, which is resized to the clip's bone count. With loop
+        // set, time wraps around the clip duration; otherwise it is clamped to the keys.
+        void sample(real time, LocalPose& pose, const bool loop = true,
+                    const RotationInterpolation interpolation = RotationInterpolation::nlerp)
+        {
+            const AnimationClip& clip = *_clip;
+            const std::size_t bones = clip.bone_count();
+            if (pose.size() != bones) pose.resize(bones);
+            if (loop && clip.duration > 0)
+            {
+                time = std::fmod(time, clip.duration);
+                if (time < 0) time += clip.duration;
+            }
+
+            for (std::size_t bone = 0; bone < bones; ++bone)
+            {
+                sample_vector(clip.translations[bone], time, _translation_cursor[bone], Vector3(), pose.translations[bone]);
+                sample_vector(clip.scales[bone], time, _scale_cursor[bone], Vector3(1, 1, 1), pose.scales[bone]);
+
+                const QuaternionTrack& track = clip.rotations[bone];
+                if (track.size() == 0)
+                {
+                    set_segment(bone, Quaternion(), Quaternion(), 0);
+                    continue;
+                }
+                if (track.size() == 1)
+                {
+                    set_segment(bone, track.value(0), track.value(0), 0);
+                    continue;
+                }
+                const std::uint32_t k = find_key(track.times, time, _rotation_cursor[bone]);
+                set_segment(bone, track.value(k), track.value(k + 1), segment_alpha(track.times, k, time));
+            }
+
+            const QuaternionSpans from{_from_w, _from_x, _from_y, _from_z};
+            const QuaternionSpans to{_to_w, _to_x, _to_y, _to_z};
+            const std::span<Quaternion> rotations(pose.rotations.data(), bones);
+            if (interpolation == RotationInterpolation::slerp)
+                slerp(from, to, _alpha, rotations);
+            else
+                nlerp(from, to, _alpha, rotations);
+        }
+
+    private:
+        const AnimationClip* _clip;
+        std::vector<std::uint32_t> _translation_cursor;
+        std::vector<std::uint32_t> _rotation_cursor;
+        std::vector<std::uint32_t> _scale_cursor;
+        std::vector<real> _from_w, _from_x, _from_y, _from_z;
+        std::vector<real> _to_w, _to_x, _to_y, _to_z;
+        std::vector<real> _alpha;
+
+        void set_segment(const std::size_t bone, const Quaternion& from, const Quaternion& to, const real alpha)
+        {
+            _from_w[bone] = from.w;
+            _from_x[bone] = from.x;
+            _from_y[bone] = from.y;
+            _from_z[bone] = from.z;
+            _to_w[bone] = to.w;
+            _to_x[bone] = to.x;
+            _to_y[bone] = to.y;
+            _to_z[bone] = to.z;
+            _alpha[bone] = alpha;
+        }
+
+        static real segment_alpha(const std::span<const real> times, const std::uint32_t k, const real time)
+        {
+            const real span = times[k + 1] - times[k];
+            return std::clamp((time - times[k]) / span, static_cast<real>(0), static_cast<real>(1));
+        }
+
+        // An empty track writes bind, so a reused pose never carries values over from earlier
+        // samples or blends.
+        static void sample_vector(const Vector3Track& track, const real time, std::uint32_t& cursor, const Vector3& bind, Vector3& out)
+        {
+            if (track.size() == 0)
+            {
+                out = bind;
+                return;
+            }
+            if (track.size() == 1)
+            {
+                out = track.value(0);
+                return;
+            }
+            const std::uint32_t k = find_key(track.times, time, cursor);
+            const real a = segment_alpha(track.times, k, time);
+            out = Vector3(track.x[k] + (track.x[k + 1] - track.x[k]) * a,
+                          track.y[k] + (track.y[k + 1] - track.y[k]) * a,
+                          track.z[k] + (track.z[k + 1] - track.z[k]) * a);
+        }
+    };
+
+    enum class BlendMode
+    {
+        override, // Moves the target toward the layer by weight
+        additive  // Applies the layer as a delta from make_additive(), scaled by weight
+    };
+
+    // Blends layer into target in place. bone_weights, if not empty, scales weight per bone
+    // (a bone mask); bones past its end use weight unchanged.
+    inline void blend_pose(const LocalPose& layer, const real weight, const BlendMode mode, LocalPose& target,
+                           const std::span<const real> bone_weights = {})
+    {
+        const std::size_t bones = std::min(layer.size(), target.size());
+        for (std::size_t i = 0; i < bones; ++i)
+        {
+            const real w = i < bone_weights.size() ? weight * bone_weights[i] : weight;
+            if (w == 0) continue;
+
+            Vector3& t = target.translations[i];
+            Vector3& s = target.scales[i];
+            const Vector3& lt = layer.translations[i];
+            const Vector3& ls = layer.scales[i];
+            if (mode == BlendMode::override)
+            {
+                t = Vector3(t.x + (lt.x - t.x) * w, t.y + (lt.y - t.y) * w, t.z + (lt.z - t.z) * w);
+                s = Vector3(s.x + (ls.x - s.x) * w, s.y + (ls.y - s.y) * w, s.z + (ls.z - s.z) * w);
+                target.rotations[i] = Quaternion::nlerp(target.rotations[i], layer.rotations[i], w);
+            }
+            else
+            {
+                t = Vector3(t.x + lt.x * w, t.y + lt.y * w, t.z + lt.z * w);
+                s = Vector3(s.x * (1 + (ls.x - 1) * w), s.y * (1 + (ls.y - 1) * w), s.z * (1 + (ls.z - 1) * w));
+                target.rotations[i] = target.rotations[i] * Quaternion::nlerp(Quaternion(), layer.rotations[i], w);
+            }
+        }
+    }
+
+    // Converts pose into an additive layer relative to reference: translation and scale become
+    // the difference and ratio, and rotation the local-space delta reference^-1 * pose.
+    inline void make_additive(const LocalPose& pose, const LocalPose& reference, LocalPose& out)
+    {
+        const std::size_t bones = std::min(pose.size(), reference.size());
+        out.resize(bones);
+        for (std::size_t i = 0; i < bones; ++i)
+        {
+            out.translations[i] = pose.translations[i] - reference.translations[i];
+            const Vector3& s = pose.scales[i];
+            const Vector3& r = reference.scales[i];
+            out.scales[i] = Vector3(r.x != 0 ? s.x / r.x : 1, r.y != 0 ? s.y / r.y : 1, r.z != 0 ? s.z / r.z : 1);
+            out.rotations[i] = reference.rotations[i].conjugate() * pose.rotations[i];
+        }
+    }
+}
+
+#endif //LINKIT_ANIMATION_H
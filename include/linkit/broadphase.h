@@ -0,0 +1,332 @@
+#ifndef LINKIT_BROADPHASE_H
+#define LINKIT_BROADPHASE_H
+#include "precision.h"
+#include "vector3.h"
+#include "aabb.h"
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace linkit
+{
+    // Pair of body indices whose boxes overlap, always with a < b.
+    struct BodyPair
+    {
+        std::uint32_t a;
+        std::uint32_t b;
+    };
+
+    // Incremental sweep-and-prune. Body i is boxes[i] on every call to update(); the sorted
+    // order from the previous frame is kept, so bodies that moved a little are re-sorted with
+    // an insertion sort in close to O(n). Pairs are written into a buffer owned by the
+    // broadphase that is reused between frames.
+    class SweepAndPrune
+    {
+    public:
+        void reserve(const std::size_t bodies, const std::size_t pairs)
+        {
+            _endpoints.reserve(bodies);
+            _pairs.reserve(pairs);
+        }
+
+        void clear()
+        {
+            _endpoints.clear();
+            _pairs.clear();
+        }
+
+        const std::vector<BodyPair>& update(const std::span<const AABB> boxes)
+        {
+            resize(boxes.size());
+
+            const int axis = choose_axis(boxes);
+            const bool axis_changed = axis != _axis;
+            _axis = axis;
+
+            const int axis1 = (_axis + 1) % 3;
+            const int axis2 = (_axis + 2) % 3;
+            for (Endpoint& e : _endpoints)
+            {
+                const AABB& box = boxes[e.body];
+                e.lo = axis_value(box.min, _axis);
+                e.hi = axis_value(box.max, _axis);
+                e.lo1 = axis_value(box.min, axis1);
+                e.hi1 = axis_value(box.max, axis1);
+                e.lo2 = axis_value(box.min, axis2);
+                e.hi2 = axis_value(box.max, axis2);
+            }
+
+            if (axis_changed)
+            {
+                // The previous order is meaningless on a new axis, fall back to a full sort.
+                std::sort(_endpoints.begin(), _endpoints.end(),
+                    [](const Endpoint& l, const Endpoint& r) { return l.lo < r.lo; });
+            }
+            else
+            {
+                insertion_sort();
+            }
+
+            sweep();
+            return _pairs;
+        }
+
+        [[nodiscard]] const std::vector<BodyPair>& pairs() const
+        {
+            return _pairs;
+        }
+
+        [[nodiscard]] int axis() const
+        {
+            return _axis;
+        }
+
+    private:
+        struct Endpoint
+        {
+            real lo, hi;   // Extent on the sort axis
+            real lo1, hi1; // Extents on the two remaining axes
+            real lo2, hi2;
+            std::uint32_t body;
+        };
+
+        std::vector<Endpoint> _endpoints;
+        std::vector<BodyPair> _pairs;
+        int _axis = -1;
+
+        void resize(const std::size_t count)
+        {
+            if (_endpoints.size() == count) return;
+
+            if (_endpoints.size() > count)
+            {
+                std::erase_if(_endpoints, [count](const Endpoint& e) { return e.body >= count; });
+                return;
+            }
+
+            // New bodies are appended at the end and bubble into place during the sort.
+            for (auto body = static_cast<std::uint32_t>(_endpoints.size()); body < count; ++body)
+            {
+                Endpoint e{};
+                e.body = body;
+                _endpoints.push_back(e);
+            }
+            _axis = -1; // Force a full sort
+        }
+
+        // Sort along the axis with the largest spread of box centers, with some hysteresis so
+        // the axis does not flip back and forth between frames.
+        int choose_axis(const std::span<const AABB> boxes) const
+        {
+            if (boxes.empty()) return _axis < 0 ? 0 : _axis;
+
+            real sum[3] = {0, 0, 0};
+            real sum_sq[3] = {0, 0, 0};
+            for (const AABB& box : boxes)
+            {
+                const Vector3 c = box.min + box.max;
+                sum[0] += c.x; sum_sq[0] += c.x * c.x;
+                sum[1] += c.y; sum_sq[1] += c.y * c.y;
+                sum[2] += c.z; sum_sq[2] += c.z * c.z;
+            }
+
+            const real inv_n = static_cast<real>(1.0) / static_cast<real>(boxes.size());
+            real variance[3];
+            for (int i = 0; i < 3; ++i)
+                variance[i] = sum_sq[i] * inv_n - (sum[i] * inv_n) * (sum[i] * inv_n);
+
+            int best = 0;
+            if (variance[1] > variance[best]) best = 1;
+            if (variance[2] > variance[best]) best = 2;
+
+            if (_axis >= 0 && best != _axis && variance[best] < variance[_axis] * static_cast<real>(1.5))
+                return _axis;
+            return best;
+        }
+
+        void insertion_sort()
+        {
+            for (std::size_t i = 1; i < _endpoints.size(); ++i)
+            {
+                if (_endpoints[i - 1].lo <= _endpoints[i].lo) continue;
+
+                const Endpoint moving = _endpoints[i];
+                std::size_t j = i;
+                while (j > 0 && _endpoints[j - 1].lo > moving.lo)
+                {
+                    _endpoints[j] = _endpoints[j - 1];
+                    --j;
+                }
+                _endpoints[j] = moving;
+            }
+        }
+
+        void sweep()
+        {
+            _pairs.clear();
+            const std::size_t n = _endpoints.size();
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const Endpoint& e = _endpoints[i];
+                for (std::size_t j = i + 1; j < n && _endpoints[j].lo <= e.hi; ++j)
+                {
+                    const Endpoint& o = _endpoints[j];
+                    if (e.lo1 <= o.hi1 && e.hi1 >= o.lo1 && e.lo2 <= o.hi2 && e.hi2 >= o.lo2)
+                    {
+                        _pairs.push_back(e.body < o.body ? BodyPair{e.body, o.body} : BodyPair{o.body, e.body});
+                    }
+                }
+            }
+        }
+    };
+
+    // Uniform grid broadphase. Every box is binned into each cell it touches with a counting
+    // sort, and a pair is only reported by the cell that holds the minimum corner of the
+    // intersection of both boxes, so no duplicate removal pass is needed. The grid covers the
+    // bounds of the current frame and is capped at max_cells_per_axis in each direction.
+    class UniformGridBroadphase
+    {
+    public:
+        real cell_size;
+        int max_cells_per_axis;
+
+        explicit UniformGridBroadphase(const real cell_size, const int max_cells_per_axis = 64)
+            : cell_size(cell_size), max_cells_per_axis(max_cells_per_axis)
+        {
+        }
+
+        void reserve(const std::size_t entries, const std::size_t pairs)
+        {
+            _entries.reserve(entries);
+            _pairs.reserve(pairs);
+        }
+
+        const std::vector<BodyPair>& update(const std::span<const AABB> boxes)
+        {
+            _pairs.clear();
+            if (boxes.empty()) return _pairs;
+
+            AABB bounds = AABB::empty();
+            for (const AABB& box : boxes)
+                bounds.expand(box);
+
+            _origin = bounds.min;
+            const Vector3 extent = bounds.max - bounds.min;
+            _dims[0] = cells_along(extent.x);
+            _dims[1] = cells_along(extent.y);
+            _dims[2] = cells_along(extent.z);
+            _inv_cell[0] = extent.x > 0 ? _dims[0] / extent.x : 0;
+            _inv_cell[1] = extent.y > 0 ? _dims[1] / extent.y : 0;
+            _inv_cell[2] = extent.z > 0 ? _dims[2] / extent.z : 0;
+
+            const std::size_t cell_count = static_cast<std::size_t>(_dims[0]) * _dims[1] * _dims[2];
+            _cell_start.assign(cell_count + 1, 0);
+
+            // Counting pass
+            for (const AABB& box : boxes)
+            {
+                int lo[3], hi[3];
+                cell_range(box, lo, hi);
+                for (int z = lo[2]; z <= hi[2]; ++z)
+                    for (int y = lo[1]; y <= hi[1]; ++y)
+                        for (int x = lo[0]; x <= hi[0]; ++x)
+                            ++_cell_start[cell_index(x, y, z) + 1];
+            }
+            for (std::size_t c = 0; c < cell_count; ++c)
+                _cell_start[c + 1] += _cell_start[c];
+
+            // Scatter pass
+            _entries.resize(_cell_start[cell_count]);
+            _cursor.assign(_cell_start.begin(), _cell_start.end() - 1);
+            for (std::uint32_t body = 0; body < boxes.size(); ++body)
+            {
+                int lo[3], hi[3];
+                cell_range(boxes[body], lo, hi);
+                for (int z = lo[2]; z <= hi[2]; ++z)
+                    for (int y = lo[1]; y <= hi[1]; ++y)
+                        for (int x = lo[0]; x <= hi[0]; ++x)
+                            _entries[_cursor[cell_index(x, y, z)]++] = body;
+            }
+
+            // Pair pass
+            for (int z = 0; z < _dims[2]; ++z)
+            {
+                for (int y = 0; y < _dims[1]; ++y)
+                {
+                    for (int x = 0; x < _dims[0]; ++x)
+                    {
+                        const std::size_t cell = cell_index(x, y, z);
+                        const std::uint32_t begin = _cell_start[cell];
+                        const std::uint32_t end = _cell_start[cell + 1];
+                        for (std::uint32_t i = begin; i < end; ++i)
+                        {
+                            const AABB& a = boxes[_entries[i]];
+                            for (std::uint32_t j = i + 1; j < end; ++j)
+                            {
+                                const AABB& b = boxes[_entries[j]];
+                                if (!a.overlaps(b)) continue;
+
+                                const Vector3 corner(std::max(a.min.x, b.min.x),
+                                                     std::max(a.min.y, b.min.y),
+                                                     std::max(a.min.z, b.min.z));
+                                if (cell_coord(corner.x, 0) != x || cell_coord(corner.y, 1) != y ||
+                                    cell_coord(corner.z, 2) != z)
+                                    continue;
+
+                                const std::uint32_t ia = _entries[i];
+                                const std::uint32_t ib = _entries[j];
+                                _pairs.push_back(ia < ib ? BodyPair{ia, ib} : BodyPair{ib, ia});
+                            }
+                        }
+                    }
+                }
+            }
+            return _pairs;
+        }
+
+        [[nodiscard]] const std::vector<BodyPair>& pairs() const
+        {
+            return _pairs;
+        }
+
+    private:
+        std::vector<std::uint32_t> _cell_start;
+        std::vector<std::uint32_t> _cursor;
+        std::vector<std::uint32_t> _entries;
+        std::vector<BodyPair> _pairs;
+        Vector3 _origin;
+        int _dims[3] = {1, 1, 1};
+        real _inv_cell[3] = {0, 0, 0};
+
+        // Both clamp in real before converting: casting NaN or a value beyond int to int is undefined.
+        [[nodiscard]] int cells_along(const real extent) const
+        {
+            if (cell_size <= 0) return 1;
+            const real cells = extent / cell_size + 1;
+            if (!(cells >= 1)) return 1;
+            return static_cast<int>(std::min(cells, static_cast<real>(std::max(max_cells_per_axis, 1))));
+        }
+
+        [[nodiscard]] int cell_coord(const real value, const int axis) const
+        {
+            const real c = (value - axis_value(_origin, axis)) * _inv_cell[axis];
+            if (!(c > 0)) return 0;
+            return static_cast<int>(std::min(c, static_cast<real>(_dims[axis] - 1)));
+        }
+
+        void cell_range(const AABB& box, int lo[3], int hi[3]) const
+        {
+            lo[0] = cell_coord(box.min.x, 0); hi[0] = cell_coord(box.max.x, 0);
+            lo[1] = cell_coord(box.min.y, 1); hi[1] = cell_coord(box.max.y, 1);
+            lo[2] = cell_coord(box.min.z, 2); hi[2] = cell_coord(box.max.z, 2);
+        }
+
+        [[nodiscard]] std::size_t cell_index(const int x, const int y, const int z) const
+        {
+            return (static_cast<std::size_t>(z) * _dims[1] + y) * _dims[0] + x;
+        }
+    };
+}
+
+#endif //LINKIT_BROADPHASE_H
@@ -0,0 +1,425 @@
+#ifndef LINKIT_CONTACT_SOLVER_H
+#define LINKIT_CONTACT_SOLVER_H
+#include "precision.h"
+#include "vector3.h"
+#include "matrix3.h"
+#include "parallel.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace linkit
+{
+    // Velocity state the solver reads and writes. Bodies with zero inverse mass are static and
+    // are never written, so any number of constraints in a batch may share them.
+    struct SolverBody
+    {
+        Vector3 position; // Center of mass, world space
+        Vector3 linear_velocity;
+        Vector3 angular_velocity;
+        real inverse_mass = 0;
+        Matrix3 inverse_inertia = Matrix3() * static_cast<real>(0); // World space
+    };
+
+    struct SolverSettings
+    {
+        int iterations = 8;
+        real baumgarte = static_cast<real>(0.2);  // Fraction of position error fixed per step
+        real slop = static_cast<real>(0.005);     // Penetration allowed before the bias kicks in
+        bool warm_starting = true;
+    };
+
+    // Sequential-impulse solver for contacts (one normal and two friction rows) and ball joints
+    // (three rows). Constraints are greedily graph-colored so no two constraints in a color share
+    // a dynamic body; each color is a batch solved in parallel. Inside a color, constraints are
+    // packed four to a lane group whose rows are stored lane-major in SoA arrays, so a group
+    // gathers its bodies' velocities once and solves each row for four constraints at a time
+    // with packed arithmetic. Accumulated impulses can be read back after solve() and fed into
+    // the next frame's add_* call to warm start.
+    class ContactSolver
+    {
+    public:
+        SolverSettings settings;
+
+        void clear()
+        {
+            _constraints.clear();
+        }
+
+        // normal points from a towards b, as in ContactResult. penetration is the overlap depth,
+        // positive when penetrating, i.e. -ContactResult::distance. warm_impulse holds the normal
+        // and two friction impulses from the previous frame.
+        std::uint32_t add_contact(const std::uint32_t a, const std::uint32_t b, const Vector3& point, const Vector3& normal,
+                                  const real penetration, const real friction, const Vector3& warm_impulse = Vector3())
+        {
+            Constraint c;
+            c.type = ConstraintType::contact;
+            c.a = a;
+            c.b = b;
+            c.point_a = point;
+            c.point_b = point;
+            c.normal = normal;
+            c.penetration = penetration;
+            c.friction = friction;
+            c.warm_impulse = warm_impulse;
+            _constraints.push_back(c);
+            return static_cast<std::uint32_t>(_constraints.size() - 1);
+        }
+
+        // Pins anchor_a (on body a) to anchor_b (on body b), both in world space.
+        std::uint32_t add_ball_joint(const std::uint32_t a, const std::uint32_t b, const Vector3& anchor_a, const Vector3& anchor_b,
+                                     const Vector3& warm_impulse = Vector3())
+        {
+            Constraint c;
+            c.type = ConstraintType::ball_joint;
+            c.a = a;
+            c.b = b;
+            c.point_a = anchor_a;
+            c.point_b = anchor_b;
+            c.warm_impulse = warm_impulse;
+            _constraints.push_back(c);
+            return static_cast<std::uint32_t>(_constraints.size() - 1);
+        }
+
+        [[nodiscard]] std::size_t constraint_count() const
+        {
+            return _constraints.size();
+        }
+
+        [[nodiscard]] std::size_t batch_count() const
+        {
+            return _batch_start.empty() ? 0 : _batch_start.size() - 1;
+        }
+
+        // Accumulated impulses of a constraint after solve(): (normal, tangent1, tangent2) for
+        // contacts, world (x, y, z) for ball joints.
+        [[nodiscard]] Vector3 impulse(const std::uint32_t constraint) const
+        {
+            const std::uint32_t slot = _first_slot[constraint];
+            return Vector3(_impulse[slot], _impulse[slot + lanes], _impulse[slot + 2 * lanes]);
+        }
+
+        void solve(const std::span<SolverBody> bodies, const real dt)
+        {
+            if (_constraints.empty() || dt <= 0) return;
+            color(bodies);
+            build_rows(bodies, dt);
+
+            if (settings.warm_starting)
+                for_each_batch([&](const std::uint32_t group) { solve_group<false>(bodies, group); });
+
+            for (int iteration = 0; iteration < settings.iterations; ++iteration)
+                for_each_batch([&](const std::uint32_t group) { solve_group<true>(bodies, group); });
+        }
+
+    private:
+        enum class ConstraintType : std::uint8_t { contact, ball_joint };
+
+        struct Constraint
+        {
+            ConstraintType type = ConstraintType::contact;
+            std::uint32_t a = 0, b = 0;
+            Vector3 point_a, point_b;
+            Vector3 normal;
+            real penetration = 0;
+            real friction = 0;
+            Vector3 warm_impulse;
+            std::uint32_t color = 0;
+        };
+
+        static constexpr std::uint32_t sequential_color = 64;
+        // Constraints solved side by side in a lane group. Both constraint kinds have three rows,
+        // so a group is three rows of lanes slots each: row k of lane l is slot lanes * k + l.
+        static constexpr std::uint32_t lanes = 4;
+        static constexpr std::uint32_t group_slots = 3 * lanes;
+
+        std::vector<Constraint> _constraints;
+        std::vector<std::uint64_t> _body_colors;
+        std::vector<std::uint32_t> _order;           // Constraints sorted by color
+        std::vector<std::uint32_t> _cursor;          // Scratch for the counting sort into _order
+        std::vector<std::uint32_t> _batch_start;     // Into _order, one entry per color + 1
+        std::vector<std::uint32_t> _batch_groups;    // First lane group of each color, one entry per color + 1
+        std::vector<std::uint32_t> _group_lanes;     // Live lanes per group; the rest are zero rows
+        std::vector<std::uint32_t> _first_slot;      // Row 0 slot per constraint (original index)
+
+        // Constraint rows, SoA, grouped as described at lanes
+        std::vector<std::uint32_t> _row_a, _row_b;
+        std::vector<real> _nx, _ny, _nz;             // Linear Jacobian (applied to b, negated for a)
+        std::vector<real> _ra_x, _ra_y, _ra_z;       // ra x n
+        std::vector<real> _rb_x, _rb_y, _rb_z;       // rb x n
+        std::vector<real> _ia_x, _ia_y, _ia_z;       // Ia (ra x n)
+        std::vector<real> _ib_x, _ib_y, _ib_z;       // Ib (rb x n)
+        std::vector<real> _effective_mass, _target, _lower, _upper, _impulse;
+        std::vector<real> _friction;                 // Nonzero only on friction rows, bounded by row 0 of their lane
+
+        void color(const std::span<const SolverBody> bodies)
+        {
+            _body_colors.assign(bodies.size(), 0);
+            std::uint32_t used_colors = 0;
+            for (Constraint& c : _constraints)
+            {
+                const bool dynamic_a = bodies[c.a].inverse_mass > 0;
+                const bool dynamic_b = bodies[c.b].inverse_mass > 0;
+                const std::uint64_t taken = (dynamic_a ? _body_colors[c.a] : 0) | (dynamic_b ? _body_colors[c.b] : 0);
+                c.color = taken == ~std::uint64_t{0} ? sequential_color : static_cast<std::uint32_t>(std::countr_one(taken));
+                if (c.color < sequential_color)
+                {
+                    if (dynamic_a) _body_colors[c.a] |= std::uint64_t{1} << c.color;
+                    if (dynamic_b) _body_colors[c.b] |= std::uint64_t{1} << c.color;
+                }
+                used_colors = std::max(used_colors, c.color + 1);
+            }
+
+            _batch_start.assign(used_colors + 1, 0);
+            for (const Constraint& c : _constraints)
+                ++_batch_start[c.color + 1];
+            for (std::uint32_t i = 0; i < used_colors; ++i)
+                _batch_start[i + 1] += _batch_start[i];
+
+            _order.resize(_constraints.size());
+            _cursor.assign(_batch_start.begin(), _batch_start.end() - 1);
+            for (std::uint32_t i = 0; i < _constraints.size(); ++i)
+                _order[_cursor[_constraints[i].color]++] = i;
+
+            // The overflow color may share bodies inside, so its groups hold one constraint each
+            _batch_groups.assign(used_colors + 1, 0);
+            for (std::uint32_t color = 0; color < used_colors; ++color)
+            {
+                const std::uint32_t count = _batch_start[color + 1] - _batch_start[color];
+                _batch_groups[color + 1] = _batch_groups[color] + (color == sequential_color ? count : (count + lanes - 1) / lanes);
+            }
+        }
+
+        void build_rows(const std::span<const SolverBody> bodies, const real dt)
+        {
+            const std::uint32_t groups = _batch_groups.back();
+            resize_rows(static_cast<std::size_t>(groups) * group_slots);
+            _group_lanes.resize(groups);
+            _first_slot.resize(_constraints.size());
+            const real inv_dt = static_cast<real>(1.0) / dt;
+
+            for (std::size_t color = 0; color + 1 < _batch_start.size(); ++color)
+            {
+                const std::uint32_t width = color == sequential_color ? 1 : lanes;
+                for (std::uint32_t group = _batch_groups[color]; group < _batch_groups[color + 1]; ++group)
+                {
+                    const std::uint32_t first = _batch_start[color] + (group - _batch_groups[color]) * width;
+                    const std::uint32_t count = std::min(width, _batch_start[color + 1] - first);
+                    _group_lanes[group] = count;
+                    for (std::uint32_t lane = 0; lane < lanes; ++lane)
+                    {
+                        const std::uint32_t slot = group * group_slots + lane;
+                        if (lane < count)
+                            build_constraint_rows(bodies, _order[first + lane], slot, inv_dt);
+                        else
+                            for (std::uint32_t k = 0; k < 3; ++k)
+                                clear_row(slot + k * lanes, _constraints[_order[first]]);
+                    }
+                }
+            }
+
+            if (!settings.warm_starting)
+                std::fill(_impulse.begin(), _impulse.end(), static_cast<real>(0));
+        }
+
+        void build_constraint_rows(const std::span<const SolverBody> bodies, const std::uint32_t index, const std::uint32_t slot, const real inv_dt)
+        {
+            const Constraint& c = _constraints[index];
+            _first_slot[index] = slot;
+
+            const SolverBody& a = bodies[c.a];
+            const SolverBody& b = bodies[c.b];
+            const Vector3 ra = c.point_a - a.position;
+            const Vector3 rb = c.point_b - b.position;
+
+            if (c.type == ConstraintType::contact)
+            {
+                Vector3 t1, t2;
+                tangent_basis(c.normal, t1, t2);
+                const real bias = settings.baumgarte * inv_dt * std::max(c.penetration - settings.slop, static_cast<real>(0));
+
+                set_row(slot, a, b, c, ra, rb, c.normal, bias, 0, std::numeric_limits<real>::max(), c.warm_impulse.x, 0);
+                set_row(slot + lanes, a, b, c, ra, rb, t1, 0, 0, 0, c.warm_impulse.y, c.friction);
+                set_row(slot + 2 * lanes, a, b, c, ra, rb, t2, 0, 0, 0, c.warm_impulse.z, c.friction);
+            }
+            else
+            {
+                const Vector3 error = c.point_a - c.point_b;
+                constexpr real inf = std::numeric_limits<real>::max();
+                set_row(slot, a, b, c, ra, rb, Vector3(1, 0, 0), settings.baumgarte * inv_dt * error.x, -inf, inf, c.warm_impulse.x, 0);
+                set_row(slot + lanes, a, b, c, ra, rb, Vector3(0, 1, 0), settings.baumgarte * inv_dt * error.y, -inf, inf, c.warm_impulse.y, 0);
+                set_row(slot + 2 * lanes, a, b, c, ra, rb, Vector3(0, 0, 1), settings.baumgarte * inv_dt * error.z, -inf, inf, c.warm_impulse.z, 0);
+            }
+        }
+
+        void resize_rows(const std::size_t n)
+        {
+            for (auto* v : {&_row_a, &_row_b})
+                v->resize(n);
+            for (auto* v : {&_nx, &_ny, &_nz, &_ra_x, &_ra_y, &_ra_z, &_rb_x, &_rb_y, &_rb_z,
+                            &_ia_x, &_ia_y, &_ia_z, &_ib_x, &_ib_y, &_ib_z,
+                            &_effective_mass, &_target, &_lower, &_upper, &_impulse, &_friction})
+                v->resize(n);
+        }
+
+        void set_row(const std::uint32_t row, const SolverBody& a, const SolverBody& b, const Constraint& c,
+                     const Vector3& ra, const Vector3& rb, const Vector3& n, const real target,
+                     const real lower, const real upper, const real warm, const real friction)
+        {
+            const Vector3 ra_n = ra % n;
+            const Vector3 rb_n = rb % n;
+            const Vector3 ia = a.inverse_inertia * ra_n;
+            const Vector3 ib = b.inverse_inertia * rb_n;
+            const real k = a.inverse_mass + b.inverse_mass + ra_n * ia + rb_n * ib;
+
+            _row_a[row] = c.a;
+            _row_b[row] = c.b;
+            _nx[row] = n.x; _ny[row] = n.y; _nz[row] = n.z;
+            _ra_x[row] = ra_n.x; _ra_y[row] = ra_n.y; _ra_z[row] = ra_n.z;
+            _rb_x[row] = rb_n.x; _rb_y[row] = rb_n.y; _rb_z[row] = rb_n.z;
+            _ia_x[row] = ia.x; _ia_y[row] = ia.y; _ia_z[row] = ia.z;
+            _ib_x[row] = ib.x; _ib_y[row] = ib.y; _ib_z[row] = ib.z;
+            _effective_mass[row] = k > 0 ? static_cast<real>(1.0) / k : 0;
+            _target[row] = target;
+            _lower[row] = lower;
+            _upper[row] = upper;
+            _impulse[row] = warm;
+            _friction[row] = friction;
+        }
+
+        // Padding lane: an all-zero row, so it always yields a zero impulse. It names the bodies
+        // of the group's first constraint only so the gather reads valid memory; padding lanes
+        // are never scattered back.
+        void clear_row(const std::uint32_t row, const Constraint& first)
+        {
+            _row_a[row] = first.a;
+            _row_b[row] = first.b;
+            for (auto* v : {&_nx, &_ny, &_nz, &_ra_x, &_ra_y, &_ra_z, &_rb_x, &_rb_y, &_rb_z,
+                            &_ia_x, &_ia_y, &_ia_z, &_ib_x, &_ib_y, &_ib_z,
+                            &_effective_mass, &_target, &_lower, &_upper, &_impulse, &_friction})
+                (*v)[row] = 0;
+        }
+
+        // Runs fn(group) over every lane group, one color after another. Colors are independent
+        // inside, so each runs in parallel; the overflow color runs serially.
+        template <typename Fn>
+        void for_each_batch(Fn&& fn)
+        {
+            for (std::size_t color = 0; color + 1 < _batch_groups.size(); ++color)
+            {
+                const std::uint32_t begin = _batch_groups[color];
+                const std::uint32_t end = _batch_groups[color + 1];
+                if (color == sequential_color)
+                {
+                    for (std::uint32_t g = begin; g < end; ++g) fn(g);
+                    continue;
+                }
+                parallel_for(end - begin, 64, [&](const std::size_t first, const std::size_t last) {
+                    for (std::size_t g = first; g < last; ++g)
+                        fn(static_cast<std::uint32_t>(begin + g));
+                });
+            }
+        }
+
+        // Solves (or, for the warm start, only applies) the three rows of every lane in a group.
+        // The lanes' body velocities are gathered once into lane arrays, all row math then runs
+        // across the lanes without branches, and the velocities of live lanes' dynamic bodies are
+        // scattered back at the end. No two lanes share a dynamic body: they are one color.
+        template <bool Solve>
+        void solve_group(const std::span<SolverBody> bodies, const std::uint32_t group)
+        {
+            const std::uint32_t base = group * group_slots;
+            real va[6][lanes], vb[6][lanes], mass_a[lanes], mass_b[lanes];
+            for (std::uint32_t l = 0; l < lanes; ++l)
+            {
+                const SolverBody& a = bodies[_row_a[base + l]];
+                const SolverBody& b = bodies[_row_b[base + l]];
+                va[0][l] = a.linear_velocity.x; va[1][l] = a.linear_velocity.y; va[2][l] = a.linear_velocity.z;
+                va[3][l] = a.angular_velocity.x; va[4][l] = a.angular_velocity.y; va[5][l] = a.angular_velocity.z;
+                vb[0][l] = b.linear_velocity.x; vb[1][l] = b.linear_velocity.y; vb[2][l] = b.linear_velocity.z;
+                vb[3][l] = b.angular_velocity.x; vb[4][l] = b.angular_velocity.y; vb[5][l] = b.angular_velocity.z;
+                mass_a[l] = a.inverse_mass;
+                mass_b[l] = b.inverse_mass;
+            }
+
+            for (std::uint32_t k = 0; k < 3; ++k)
+            {
+                const std::uint32_t row = base + k * lanes;
+                real lambda[lanes];
+                if constexpr (Solve)
+                {
+                    real jv[lanes];
+                    for (std::uint32_t l = 0; l < lanes; ++l)
+                    {
+                        const std::uint32_t r = row + l;
+                        jv[l] = _nx[r] * (vb[0][l] - va[0][l]) + _ny[r] * (vb[1][l] - va[1][l]) + _nz[r] * (vb[2][l] - va[2][l]) +
+                                _rb_x[r] * vb[3][l] + _rb_y[r] * vb[4][l] + _rb_z[r] * vb[5][l] -
+                                _ra_x[r] * va[3][l] - _ra_y[r] * va[4][l] - _ra_z[r] * va[5][l];
+                    }
+                    real accumulated[lanes];
+                    for (std::uint32_t l = 0; l < lanes; ++l)
+                    {
+                        // A friction row widens its zero bounds to +-friction times the lane's
+                        // normal impulse, solved just before; other rows have zero friction
+                        const std::uint32_t r = row + l;
+                        const real limit = _friction[r] * _impulse[base + l];
+                        const real lower = std::min(_lower[r], -limit);
+                        const real upper = std::max(_upper[r], limit);
+                        accumulated[l] = std::min(std::max(_impulse[r] + _effective_mass[r] * (_target[r] - jv[l]), lower), upper);
+                        lambda[l] = accumulated[l] - _impulse[r];
+                    }
+                    // Stored apart from the loads above so the compiler need not prove they do not alias
+                    for (std::uint32_t l = 0; l < lanes; ++l)
+                        _impulse[row + l] = accumulated[l];
+                }
+                else
+                {
+                    for (std::uint32_t l = 0; l < lanes; ++l)
+                        lambda[l] = _impulse[row + l];
+                }
+
+                for (std::uint32_t l = 0; l < lanes; ++l)
+                {
+                    const std::uint32_t r = row + l;
+                    const real la = mass_a[l] * lambda[l], lb = mass_b[l] * lambda[l];
+                    va[0][l] -= _nx[r] * la; va[1][l] -= _ny[r] * la; va[2][l] -= _nz[r] * la;
+                    va[3][l] -= _ia_x[r] * lambda[l]; va[4][l] -= _ia_y[r] * lambda[l]; va[5][l] -= _ia_z[r] * lambda[l];
+                    vb[0][l] += _nx[r] * lb; vb[1][l] += _ny[r] * lb; vb[2][l] += _nz[r] * lb;
+                    vb[3][l] += _ib_x[r] * lambda[l]; vb[4][l] += _ib_y[r] * lambda[l]; vb[5][l] += _ib_z[r] * lambda[l];
+                }
+            }
+
+            for (std::uint32_t l = 0; l < _group_lanes[group]; ++l)
+            {
+                if (mass_a[l] > 0)
+                {
+                    SolverBody& a = bodies[_row_a[base + l]];
+                    a.linear_velocity = Vector3(va[0][l], va[1][l], va[2][l]);
+                    a.angular_velocity = Vector3(va[3][l], va[4][l], va[5][l]);
+                }
+                if (mass_b[l] > 0)
+                {
+                    SolverBody& b = bodies[_row_b[base + l]];
+                    b.linear_velocity = Vector3(vb[0][l], vb[1][l], vb[2][l]);
+                    b.angular_velocity = Vector3(vb[3][l], vb[4][l], vb[5][l]);
+                }
+            }
+        }
+
+        static void tangent_basis(const Vector3& n, Vector3& t1, Vector3& t2)
+        {
+            if (std::abs(n.x) >= static_cast<real>(0.57735))
+                t1 = Vector3(n.y, -n.x, 0);
+            else
+                t1 = Vector3(0, n.z, -n.y);
+            t1.normalize();
+            t2 = n % t1;
+        }
+    };
+}
+
+#endif //LINKIT_CONTACT_SOLVER_H
@@ -0,0 +1,204 @@
+#ifndef LINKIT_CONVEX_SHAPES_H
+#define LINKIT_CONVEX_SHAPES_H
+#include "precision.h"
+#include "vector3.h"
+#include "matrix3.h"
+#include "quaternion.h"
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace linkit
+{
+    // Convex shapes are described in their local frame by a support function on a "core" shape
+    // and a margin. The full shape is the core inflated by the margin, so spheres and capsules
+    // are a point and a segment with a radius, which keeps GJK from iterating on round surfaces.
+
+    class SphereShape
+    {
+    public:
+        real radius;
+
+        explicit SphereShape(const real radius): radius(radius) {}
+
+        [[nodiscard]] Vector3 support(const Vector3&) const
+        {
+            return Vector3();
+        }
+
+        [[nodiscard]] real margin() const
+        {
+            return radius;
+        }
+    };
+
+    // Capsule along the local y axis.
+    class CapsuleShape
+    {
+    public:
+        real half_height;
+        real radius;
+
+        CapsuleShape(const real half_height, const real radius): half_height(half_height), radius(radius) {}
+
+        [[nodiscard]] Vector3 support(const Vector3& dir) const
+        {
+            return Vector3(0, dir.y >= 0 ? half_height : -half_height, 0);
+        }
+
+        [[nodiscard]] real margin() const
+        {
+            return radius;
+        }
+    };
+
+    class BoxShape
+    {
+    public:
+        Vector3 half_extents;
+
+        explicit BoxShape(const Vector3& half_extents): half_extents(half_extents) {}
+
+        [[nodiscard]] Vector3 support(const Vector3& dir) const
+        {
+            return Vector3(
+                dir.x >= 0 ? half_extents.x : -half_extents.x,
+                dir.y >= 0 ? half_extents.y : -half_extents.y,
+                dir.z >= 0 ? half_extents.z : -half_extents.z
+            );
+        }
+
+        [[nodiscard]] real margin() const
+        {
+            return 0;
+        }
+    };
+
+    // Convex hull stored as SoA vertex coordinates. The support search keeps four independent
+    // running maxima so the dot products of four vertices are evaluated side by side.
+    class ConvexHullShape
+    {
+    public:
+        std::vector<real> xs, ys, zs;
+
+        ConvexHullShape() = default;
+
+        explicit ConvexHullShape(const std::span<const Vector3> vertices)
+        {
+            xs.reserve(vertices.size());
+            ys.reserve(vertices.size());
+            zs.reserve(vertices.size());
+            for (const Vector3& v : vertices)
+            {
+                xs.push_back(v.x);
+                ys.push_back(v.y);
+                zs.push_back(v.z);
+            }
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return xs.size();
+        }
+
+        [[nodiscard]] Vector3 vertex(const std::size_t i) const
+        {
+            return Vector3(xs[i], ys[i], zs[i]);
+        }
+
+        [[nodiscard]] std::size_t support_index(const Vector3& dir) const
+        {
+            constexpr std::size_t lanes = 4;
+            const std::size_t n = xs.size();
+            if (n == 0) return 0;
+
+            real best[lanes];
+            std::size_t best_index[lanes];
+            for (std::size_t l = 0; l < lanes; ++l)
+            {
+                best[l] = -std::numeric_limits<real>::max();
+                best_index[l] = 0;
+            }
+
+            std::size_t i = 0;
+            for (; i + lanes <= n; i += lanes)
+            {
+                for (std::size_t l = 0; l < lanes; ++l)
+                {
+                    const real d = xs[i + l] * dir.x + ys[i + l] * dir.y + zs[i + l] * dir.z;
+                    const bool better = d > best[l];
+                    best[l] = better ? d : best[l];
+                    best_index[l] = better ? i + l : best_index[l];
+                }
+            }
+            for (; i < n; ++i)
+            {
+                const real d = xs[i] * dir.x + ys[i] * dir.y + zs[i] * dir.z;
+                if (d > best[0])
+                {
+                    best[0] = d;
+                    best_index[0] = i;
+                }
+            }
+
+            std::size_t result = 0;
+            for (std::size_t l = 1; l < lanes; ++l)
+                if (best[l] > best[result]) result = l;
+            return best_index[result];
+        }
+
+        [[nodiscard]] Vector3 support(const Vector3& dir) const
+        {
+            return xs.empty() ? Vector3() : vertex(support_index(dir));
+        }
+
+        [[nodiscard]] real margin() const
+        {
+            return 0;
+        }
+    };
+
+    // A shape placed in the world. The rotation matrix is cached from the orientation so every
+    // support query costs one transpose multiply into local space and one multiply back out.
+    template <typename Shape>
+    class Collider
+    {
+    public:
+        Shape shape;
+        Vector3 position;
+        Quaternion orientation;
+        Matrix3 rotation;
+
+        explicit Collider(const Shape& shape, const Vector3& position = Vector3(), const Quaternion& orientation = Quaternion())
+            : shape(shape)
+        {
+            set_transform(position, orientation);
+        }
+
+        void set_transform(const Vector3& new_position, const Quaternion& new_orientation)
+        {
+            position = new_position;
+            orientation = new_orientation;
+            rotation = orientation.to_matrix3();
+        }
+
+        [[nodiscard]] Vector3 to_world(const Vector3& local_point) const
+        {
+            return rotation * local_point + position;
+        }
+
+        // Support point of the core shape, returned in local space.
+        [[nodiscard]] Vector3 local_support(const Vector3& world_dir) const
+        {
+            return shape.support(rotation.transform_transpose(world_dir));
+        }
+
+        [[nodiscard]] real margin() const
+        {
+            return shape.margin();
+        }
+    };
+}
+
+#endif //LINKIT_CONVEX_SHAPES_H
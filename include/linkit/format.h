@@ -0,0 +1,324 @@
+#ifndef LINKIT_FORMAT_H
+#define LINKIT_FORMAT_H
+#include "precision.h"
+#include "vector3.h"
+#include "vector4.h"
+#include "matrix3.h"
+#include "matrix4.h"
+#include "quaternion.h"
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include <version>
+#if defined(__cpp_lib_format)
+#include <format>
+#endif
+
+// Allocation-free text conversion of linkit types. Writers use std::to_chars (shortest round-trip
+// representation) and write into caller-provided memory; parsers use std::from_chars. The text
+// layout is "(x, y, z)" for vectors, "(w, x, y, z)" for quaternions and "[[..], [..], ..]" for
+// matrices in row order. Parsers also accept any other mix of whitespace, ',', ';' and brackets
+// between the numbers, so "1 2 3" reads as a Vector3.
+
+namespace linkit
+{
+    namespace detail
+    {
+        inline std::to_chars_result put(char* first, char* last, const std::string_view text)
+        {
+            if (static_cast<std::size_t>(last - first) < text.size())
+                return {last, std::errc::value_too_large};
+            for (const char c : text) *first++ = c;
+            return {first, std::errc()};
+        }
+
+        inline std::to_chars_result put_list(char* first, char* last, const real* values, const std::size_t count,
+                                             const std::string_view open, const std::string_view close)
+        {
+            std::to_chars_result r = put(first, last, open);
+            for (std::size_t i = 0; i < count && r.ec == std::errc(); ++i)
+            {
+                if (i > 0) r = put(r.ptr, last, ", ");
+                if (r.ec == std::errc()) r = std::to_chars(r.ptr, last, values[i]);
+            }
+            if (r.ec == std::errc()) r = put(r.ptr, last, close);
+            return r;
+        }
+
+        inline bool is_separator(const char c)
+        {
+            return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '(' || c == ')' || c == '[' || c == ']';
+        }
+
+        // Reads count numbers separated by any run of separators.
+        inline std::from_chars_result get_list(const char* first, const char* last, real* values, const std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                while (first != last && (is_separator(*first) || *first == '\n' || *first == '\r')) ++first;
+                if (first != last && *first == '+') ++first;
+                const std::from_chars_result r = std::from_chars(first, last, values[i]);
+                if (r.ec != std::errc()) return r;
+                first = r.ptr;
+            }
+            while (first != last && (*first == ')' || *first == ']' || *first == ' ' || *first == '\t')) ++first;
+            return {first, std::errc()};
+        }
+    }
+
+    inline std::to_chars_result to_chars(char* first, char* last, const Vector3& vec)
+    {
+        const real values[3] = {vec.x, vec.y, vec.z};
+        return detail::put_list(first, last, values, 3, "(", ")");
+    }
+
+    inline std::to_chars_result to_chars(char* first, char* last, const Vector4& vec)
+    {
+        const real values[4] = {vec.x, vec.y, vec.z, vec.w};
+        return detail::put_list(first, last, values, 4, "(", ")");
+    }
+
+    inline std::to_chars_result to_chars(char* first, char* last, const Quaternion& q)
+    {
+        const real values[4] = {q.w, q.x, q.y, q.z};
+        return detail::put_list(first, last, values, 4, "(", ")");
+    }
+
+    inline std::to_chars_result to_chars(char* first, char* last, const Matrix3& mat)
+    {
+        std::to_chars_result r = detail::put(first, last, "[");
+        for (int i = 0; i < 3 && r.ec == std::errc(); ++i)
+        {
+            if (i > 0) r = detail::put(r.ptr, last, ", ");
+            if (r.ec == std::errc()) r = detail::put_list(r.ptr, last, mat.m[i], 3, "[", "]");
+        }
+        return r.ec == std::errc() ? detail::put(r.ptr, last, "]") : r;
+    }
+
+    inline std::to_chars_result to_chars(char* first, char* last, const Matrix4& mat)
+    {
+        std::to_chars_result r = detail::put(first, last, "[");
+        for (int i = 0; i < 4 && r.ec == std::errc(); ++i)
+        {
+            if (i > 0) r = detail::put(r.ptr, last, ", ");
+            if (r.ec == std::errc()) r = detail::put_list(r.ptr, last, mat.m[i], 4, "[", "]");
+        }
+        return r.ec == std::errc() ? detail::put(r.ptr, last, "]") : r;
+    }
+
+    inline std::from_chars_result from_chars(const char* first, const char* last, Vector3& vec)
+    {
+        real values[3];
+        const std::from_chars_result r = detail::get_list(first, last, values, 3);
+        if (r.ec == std::errc()) vec = Vector3(values[0], values[1], values[2]);
+        return r;
+    }
+
+    inline std::from_chars_result from_chars(const char* first, const char* last, Vector4& vec)
+    {
+        real values[4];
+        const std::from_chars_result r = detail::get_list(first, last, values, 4);
+        if (r.ec == std::errc()) vec = Vector4(values[0], values[1], values[2], values[3]);
+        return r;
+    }
+
+    inline std::from_chars_result from_chars(const char* first, const char* last, Quaternion& q)
+    {
+        real values[4];
+        const std::from_chars_result r = detail::get_list(first, last, values, 4);
+        if (r.ec == std::errc()) q = Quaternion(values[0], values[1], values[2], values[3]);
+        return r;
+    }
+
+    inline std::from_chars_result from_chars(const char* first, const char* last, Matrix3& mat)
+    {
+        real values[9];
+        const std::from_chars_result r = detail::get_list(first, last, values, 9);
+        if (r.ec == std::errc())
+            for (int i = 0; i < 9; ++i) mat.m[i / 3][i % 3] = values[i];
+        return r;
+    }
+
+    inline std::from_chars_result from_chars(const char* first, const char* last, Matrix4& mat)
+    {
+        real values[16];
+        const std::from_chars_result r = detail::get_list(first, last, values, 16);
+        if (r.ec == std::errc())
+            for (int i = 0; i < 16; ++i) mat.m[i / 4][i % 4] = values[i];
+        return r;
+    }
+
+    // Writes "x<sep>y<sep>z\n" per point into buffer until it is full. Returns the number of
+    // points written; written_bytes receives the bytes used. Only whole lines are written.
+    inline std::size_t write_points(const std::span<char> buffer, const std::span<const Vector3> points,
+                                    std::size_t& written_bytes, const char separator = ' ')
+    {
+        char* out = buffer.data();
+        char* const end = buffer.data() + buffer.size();
+        std::size_t count = 0;
+        for (const Vector3& p : points)
+        {
+            char* cursor = out;
+            const real values[3] = {p.x, p.y, p.z};
+            bool fits = true;
+            for (int i = 0; i < 3 && fits; ++i)
+            {
+                const std::to_chars_result r = std::to_chars(cursor, end, values[i]);
+                fits = r.ec == std::errc() && r.ptr != end;
+                if (fits)
+                {
+                    cursor = r.ptr;
+                    *cursor++ = i < 2 ? separator : '\n';
+                }
+            }
+            if (!fits) break;
+            out = cursor;
+            ++count;
+        }
+        written_bytes = static_cast<std::size_t>(out - buffer.data());
+        return count;
+    }
+
+    // Appends points to out as XYZ (separator ' ') or CSV (separator ',') lines. Reusing the same
+    // string keeps its capacity, so steady-state logging does not allocate.
+    inline void append_points(std::string& out, const std::span<const Vector3> points, const char separator = ' ')
+    {
+        // Shortest round-trip doubles need at most 24 characters
+        constexpr std::size_t max_line = 3 * 25;
+        std::size_t offset = out.size();
+        out.resize(offset + points.size() * max_line);
+        std::size_t written = 0;
+        write_points(std::span<char>(out.data() + offset, out.size() - offset), points, written, separator);
+        out.resize(offset + written);
+    }
+
+    struct PointParseResult
+    {
+        std::size_t points = 0;     // Points appended to the output
+        std::size_t error_line = 0; // 1-based line of the first malformed line, 0 if none
+    };
+
+    // Parses XYZ or CSV point text, one point per line with the coordinates separated by
+    // whitespace, ',' or ';'. Blank lines, '#' comments and a non-numeric header line are skipped;
+    // extra columns after z (normals, colors) are ignored. Parsing stops at the first malformed line.
+    inline PointParseResult parse_points(const std::string_view text, std::vector<Vector3>& out)
+    {
+        PointParseResult result;
+        const char* cursor = text.data();
+        const char* const end = text.data() + text.size();
+        std::size_t line = 0;
+        while (cursor != end)
+        {
+            ++line;
+            const char* line_end = cursor;
+            while (line_end != end && *line_end != '\n') ++line_end;
+            const char* next = line_end == end ? end : line_end + 1;
+            if (line_end != cursor && line_end[-1] == '\r') --line_end;
+
+            const char* first = cursor;
+            while (first != line_end && (*first == ' ' || *first == '\t')) ++first;
+            cursor = next;
+            if (first == line_end || *first == '#') continue;
+
+            Vector3 point;
+            const std::from_chars_result r = from_chars(first, line_end, point);
+            if (r.ec != std::errc())
+            {
+                const bool header = line == 1 && ((*first >= 'a' && *first <= 'z') || (*first >= 'A' && *first <= 'Z') || *first == '"');
+                if (header) continue;
+                result.error_line = line;
+                return result;
+            }
+            out.push_back(point);
+            ++result.points;
+        }
+        return result;
+    }
+}
+
+#if defined(__cpp_lib_format)
+namespace linkit::detail
+{
+    // Formats each component with the spec given to the linkit type, e.g. "{:.3f}".
+    template <typename FormatContext>
+    typename FormatContext::iterator format_list(const std::formatter<real>& component, FormatContext& ctx,
+                                                 const real* values, const std::size_t count,
+                                                 const std::string_view open, const std::string_view close)
+    {
+        ctx.advance_to(std::ranges::copy(open, ctx.out()).out);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (i > 0) ctx.advance_to(std::ranges::copy(std::string_view(", "), ctx.out()).out);
+            ctx.advance_to(component.format(values[i], ctx));
+        }
+        return std::ranges::copy(close, ctx.out()).out;
+    }
+}
+
+template <>
+struct std::formatter<linkit::Vector3> : std::formatter<linkit::real>
+{
+    auto format(const linkit::Vector3& vec, std::format_context& ctx) const
+    {
+        const linkit::real values[3] = {vec.x, vec.y, vec.z};
+        return linkit::detail::format_list(*this, ctx, values, 3, "(", ")");
+    }
+};
+
+template <>
+struct std::formatter<linkit::Vector4> : std::formatter<linkit::real>
+{
+    auto format(const linkit::Vector4& vec, std::format_context& ctx) const
+    {
+        const linkit::real values[4] = {vec.x, vec.y, vec.z, vec.w};
+        return linkit::detail::format_list(*this, ctx, values, 4, "(", ")");
+    }
+};
+
+template <>
+struct std::formatter<linkit::Quaternion> : std::formatter<linkit::real>
+{
+    auto format(const linkit::Quaternion& q, std::format_context& ctx) const
+    {
+        const linkit::real values[4] = {q.w, q.x, q.y, q.z};
+        return linkit::detail::format_list(*this, ctx, values, 4, "(", ")");
+    }
+};
+
+template <>
+struct std::formatter<linkit::Matrix3> : std::formatter<linkit::real>
+{
+    auto format(const linkit::Matrix3& mat, std::format_context& ctx) const
+    {
+        ctx.advance_to(std::ranges::copy(std::string_view("["), ctx.out()).out);
+        for (int i = 0; i < 3; ++i)
+        {
+            if (i > 0) ctx.advance_to(std::ranges::copy(std::string_view(", "), ctx.out()).out);
+            ctx.advance_to(linkit::detail::format_list(*this, ctx, mat.m[i], 3, "[", "]"));
+        }
+        return std::ranges::copy(std::string_view("]"), ctx.out()).out;
+    }
+};
+
+template <>
+struct std::formatter<linkit::Matrix4> : std::formatter<linkit::real>
+{
+    auto format(const linkit::Matrix4& mat, std::format_context& ctx) const
+    {
+        ctx.advance_to(std::ranges::copy(std::string_view("["), ctx.out()).out);
+        for (int i = 0; i < 4; ++i)
+        {
+            if (i > 0) ctx.advance_to(std::ranges::copy(std::string_view(", "), ctx.out()).out);
+            ctx.advance_to(linkit::detail::format_list(*this, ctx, mat.m[i], 4, "[", "]"));
+        }
+        return std::ranges::copy(std::string_view("]"), ctx.out()).out;
+    }
+};
+#endif
+
+#endif //LINKIT_FORMAT_H
@@ -0,0 +1,501 @@
+#ifndef LINKIT_GJK_H
+#define LINKIT_GJK_H
+#include "precision.h"
+#include "vector3.h"
+#include "convex_shapes.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace linkit
+{
+    struct ContactResult
+    {
+        bool intersecting = false;
+        real distance = 0;  // Separation between the surfaces, negative when penetrating
+        Vector3 normal;     // Unit normal pointing from A towards B
+        Vector3 point_a;    // Closest or deepest point on A, world space
+        Vector3 point_b;    // Closest or deepest point on B, world space
+        int iterations = 0;
+    };
+
+    // Simplex kept between frames. The vertices are stored in each shape's local frame so they
+    // stay valid support points after both bodies move, and seed GJK next frame.
+    struct GjkCache
+    {
+        Vector3 local_a[4];
+        Vector3 local_b[4];
+        int count = 0;
+    };
+
+    namespace detail
+    {
+        struct SimplexVertex
+        {
+            Vector3 w;       // a - b
+            Vector3 a, b;    // World space core points
+            Vector3 la, lb;  // Local space core points
+        };
+
+        template <typename ShapeA, typename ShapeB>
+        SimplexVertex minkowski_support(const Collider<ShapeA>& a, const Collider<ShapeB>& b, const Vector3& dir)
+        {
+            SimplexVertex v;
+            v.la = a.local_support(dir);
+            v.lb = b.local_support(dir * -1);
+            v.a = a.to_world(v.la);
+            v.b = b.to_world(v.lb);
+            v.w = v.a - v.b;
+            return v;
+        }
+
+        // Closest point to the origin on triangle abc as barycentric weights (Ericson, RTCD 5.1.5).
+        inline void closest_on_triangle(const Vector3& a, const Vector3& b, const Vector3& c, real bary[3])
+        {
+            const Vector3 ab = b - a, ac = c - a;
+            const real d1 = ab * (a * -1), d2 = ac * (a * -1);
+            if (d1 <= 0 && d2 <= 0) { bary[0] = 1; bary[1] = 0; bary[2] = 0; return; }
+
+            const real d3 = ab * (b * -1), d4 = ac * (b * -1);
+            if (d3 >= 0 && d4 <= d3) { bary[0] = 0; bary[1] = 1; bary[2] = 0; return; }
+
+            const real vc = d1 * d4 - d3 * d2;
+            if (vc <= 0 && d1 >= 0 && d3 <= 0)
+            {
+                const real v = d1 / (d1 - d3);
+                bary[0] = 1 - v; bary[1] = v; bary[2] = 0;
+                return;
+            }
+
+            const real d5 = ab * (c * -1), d6 = ac * (c * -1);
+            if (d6 >= 0 && d5 <= d6) { bary[0] = 0; bary[1] = 0; bary[2] = 1; return; }
+
+            const real vb = d5 * d2 - d1 * d6;
+            if (vb <= 0 && d2 >= 0 && d6 <= 0)
+            {
+                const real w = d2 / (d2 - d6);
+                bary[0] = 1 - w; bary[1] = 0; bary[2] = w;
+                return;
+            }
+
+            const real va = d3 * d6 - d5 * d4;
+            if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+            {
+                const real w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+                bary[0] = 0; bary[1] = 1 - w; bary[2] = w;
+                return;
+            }
+
+            const real sum = va + vb + vc;
+            if (std::abs(sum) < std::numeric_limits<real>::min())
+            {
+                // Degenerate triangle, fall back to the closest vertex
+                const real da = a.magnitude_squared(), db = b.magnitude_squared(), dc = c.magnitude_squared();
+                bary[0] = (da <= db && da <= dc) ? 1 : 0;
+                bary[1] = (bary[0] == 0 && db <= dc) ? 1 : 0;
+                bary[2] = (bary[0] == 0 && bary[1] == 0) ? 1 : 0;
+                return;
+            }
+            const real denom = 1 / sum;
+            bary[1] = vb * denom;
+            bary[2] = vc * denom;
+            bary[0] = 1 - bary[1] - bary[2];
+        }
+
+        // Reduces the simplex to the smallest feature containing the point closest to the origin
+        // and returns that point. Returns false once the origin lies inside a tetrahedron.
+        inline bool reduce_simplex(SimplexVertex simplex[4], int& count, Vector3& closest)
+        {
+            real bary[4] = {1, 0, 0, 0};
+            if (count == 2)
+            {
+                const Vector3 ab = simplex[1].w - simplex[0].w;
+                const real len_sq = ab.magnitude_squared();
+                const real t = len_sq > 0 ? std::clamp(-(simplex[0].w * ab) / len_sq, static_cast<real>(0), static_cast<real>(1)) : 0;
+                bary[0] = 1 - t;
+                bary[1] = t;
+            }
+            else if (count == 3)
+            {
+                closest_on_triangle(simplex[0].w, simplex[1].w, simplex[2].w, bary);
+            }
+            else if (count == 4)
+            {
+                static constexpr int faces[4][4] = {{0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 3, 2, 0}};
+                real best = std::numeric_limits<real>::max();
+                bool inside = true;
+                for (const auto& f : faces)
+                {
+                    const Vector3& a = simplex[f[0]].w;
+                    const Vector3 n = (simplex[f[1]].w - a) % (simplex[f[2]].w - a);
+                    const real side_origin = n * (a * -1);
+                    const real side_opposite = n * (simplex[f[3]].w - a);
+                    if (side_origin * side_opposite > 0) continue;
+                    inside = false;
+
+                    real tri[3];
+                    closest_on_triangle(a, simplex[f[1]].w, simplex[f[2]].w, tri);
+                    const Vector3 p = a * tri[0] + simplex[f[1]].w * tri[1] + simplex[f[2]].w * tri[2];
+                    const real dist_sq = p.magnitude_squared();
+                    if (dist_sq < best)
+                    {
+                        best = dist_sq;
+                        bary[0] = bary[1] = bary[2] = bary[3] = 0;
+                        bary[f[0]] = tri[0];
+                        bary[f[1]] = tri[1];
+                        bary[f[2]] = tri[2];
+                    }
+                }
+                if (inside)
+                {
+                    closest = Vector3();
+                    return false;
+                }
+            }
+
+            closest = Vector3();
+            int kept = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                if (bary[i] <= 0) continue;
+                closest += simplex[i].w * bary[i];
+                simplex[kept++] = simplex[i];
+            }
+            count = kept;
+            return true;
+        }
+
+        // Witness points on both cores for the closest point on the reduced simplex.
+        inline void witness_points(const SimplexVertex simplex[4], const int count, Vector3& point_a, Vector3& point_b)
+        {
+            if (count == 1)
+            {
+                point_a = simplex[0].a;
+                point_b = simplex[0].b;
+                return;
+            }
+            if (count == 2)
+            {
+                const Vector3 ab = simplex[1].w - simplex[0].w;
+                const real len_sq = ab.magnitude_squared();
+                const real t = len_sq > 0 ? std::clamp(-(simplex[0].w * ab) / len_sq, static_cast<real>(0), static_cast<real>(1)) : 0;
+                point_a = simplex[0].a * (1 - t) + simplex[1].a * t;
+                point_b = simplex[0].b * (1 - t) + simplex[1].b * t;
+                return;
+            }
+            real bary[3];
+            closest_on_triangle(simplex[0].w, simplex[1].w, simplex[2].w, bary);
+            point_a = simplex[0].a * bary[0] + simplex[1].a * bary[1] + simplex[2].a * bary[2];
+            point_b = simplex[0].b * bary[0] + simplex[1].b * bary[1] + simplex[2].b * bary[2];
+        }
+
+        // Barycentric weights of the projection of p onto triangle abc.
+        inline void triangle_barycentric(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& p, real bary[3])
+        {
+            const Vector3 v0 = b - a, v1 = c - a, v2 = p - a;
+            const real d00 = v0 * v0, d01 = v0 * v1, d11 = v1 * v1, d20 = v2 * v0, d21 = v2 * v1;
+            const real denom = d00 * d11 - d01 * d01;
+            if (std::abs(denom) < std::numeric_limits<real>::min())
+            {
+                bary[0] = 1; bary[1] = 0; bary[2] = 0;
+                return;
+            }
+            bary[1] = (d11 * d20 - d01 * d21) / denom;
+            bary[2] = (d00 * d21 - d01 * d20) / denom;
+            bary[0] = 1 - bary[1] - bary[2];
+        }
+
+        // Grows a degenerate simplex that touches the origin into a tetrahedron so EPA can start.
+        template <typename ShapeA, typename ShapeB>
+        bool complete_tetrahedron(const Collider<ShapeA>& a, const Collider<ShapeB>& b, SimplexVertex simplex[4], int& count)
+        {
+            static const Vector3 axes[6] = {Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0),
+                                            Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1)};
+            constexpr real tolerance = REAL_EPSILON * REAL_EPSILON;
+
+            if (count == 1)
+            {
+                for (const Vector3& axis : axes)
+                {
+                    const SimplexVertex v = minkowski_support(a, b, axis);
+                    if ((v.w - simplex[0].w).magnitude_squared() > tolerance)
+                    {
+                        simplex[count++] = v;
+                        break;
+                    }
+                }
+            }
+            if (count == 2)
+            {
+                const Vector3 d = simplex[1].w - simplex[0].w;
+                for (const Vector3& axis : axes)
+                {
+                    const Vector3 perp = d % axis;
+                    if (perp.magnitude_squared() <= tolerance) continue;
+                    const SimplexVertex v = minkowski_support(a, b, perp);
+                    if (((v.w - simplex[0].w) % d).magnitude_squared() > tolerance)
+                    {
+                        simplex[count++] = v;
+                        break;
+                    }
+                }
+            }
+            if (count == 3)
+            {
+                const Vector3 n = (simplex[1].w - simplex[0].w) % (simplex[2].w - simplex[0].w);
+                SimplexVertex v = minkowski_support(a, b, n);
+                if (std::abs(n * (v.w - simplex[0].w)) <= tolerance)
+                    v = minkowski_support(a, b, n * -1);
+                if (std::abs(n * (v.w - simplex[0].w)) > tolerance)
+                    simplex[count++] = v;
+            }
+            return count == 4;
+        }
+
+        // Expanding polytope algorithm on the core Minkowski difference. Storage is fixed so the
+        // narrow phase never allocates.
+        template <typename ShapeA, typename ShapeB>
+        bool epa(const Collider<ShapeA>& a, const Collider<ShapeB>& b, const SimplexVertex tetra[4], ContactResult& result)
+        {
+            constexpr int max_vertices = 64;
+            constexpr int max_faces = 128;
+            constexpr int max_edges = 96;
+            constexpr int max_iterations = 48;
+            constexpr real tolerance = static_cast<real>(1e-9);
+
+            struct Face
+            {
+                int v[3];
+                Vector3 normal;
+                real distance;
+            };
+
+            SimplexVertex vertices[max_vertices];
+            Face faces[max_faces];
+            int vertex_count = 4;
+            int face_count = 0;
+            std::copy(tetra, tetra + 4, vertices);
+            const Vector3 interior = (tetra[0].w + tetra[1].w + tetra[2].w + tetra[3].w) * static_cast<real>(0.25);
+
+            auto add_face = [&](const int i0, const int i1, const int i2) {
+                if (face_count >= max_faces) return false;
+                Face& f = faces[face_count];
+                f.v[0] = i0; f.v[1] = i1; f.v[2] = i2;
+                f.normal = (vertices[i1].w - vertices[i0].w) % (vertices[i2].w - vertices[i0].w);
+                const real len = f.normal.magnitude();
+                if (len <= std::numeric_limits<real>::min())
+                {
+                    // Keep slivers so the polytope stays closed, but never pick them as closest
+                    f.normal = Vector3();
+                    f.distance = std::numeric_limits<real>::max();
+                    ++face_count;
+                    return true;
+                }
+                f.normal *= 1 / len;
+                f.distance = f.normal * vertices[i0].w;
+                // Orient against an interior point rather than the origin, which may lie on the face
+                if (f.normal * (vertices[i0].w - interior) < 0)
+                {
+                    std::swap(f.v[1], f.v[2]);
+                    f.normal *= -1;
+                    f.distance = -f.distance;
+                }
+                ++face_count;
+                return true;
+            };
+
+            add_face(0, 1, 2);
+            add_face(0, 3, 1);
+            add_face(0, 2, 3);
+            add_face(1, 3, 2);
+            if (face_count < 4) return false;
+
+            int best = 0;
+            for (int iteration = 0; iteration < max_iterations; ++iteration)
+            {
+                best = 0;
+                for (int i = 1; i < face_count; ++i)
+                    if (faces[i].distance < faces[best].distance) best = i;
+
+                const Face closest = faces[best];
+                const SimplexVertex support = minkowski_support(a, b, closest.normal);
+                if (support.w * closest.normal - closest.distance < tolerance || vertex_count >= max_vertices)
+                    break;
+
+                const int new_index = vertex_count;
+                vertices[vertex_count++] = support;
+
+                // Remove every face that sees the new vertex and collect the horizon. Faces nearly
+                // coplanar with the vertex are kept, otherwise flat regions of the Minkowski
+                // difference (box against box) can yield a disconnected visible set.
+                const real visible_tolerance = tolerance * std::max(static_cast<real>(1), support.w.magnitude());
+                int edges[max_edges][2];
+                int edge_count = 0;
+                bool overflow = false;
+                for (int i = 0; i < face_count;)
+                {
+                    if (faces[i].normal * (support.w - vertices[faces[i].v[0]].w) <= visible_tolerance)
+                    {
+                        ++i;
+                        continue;
+                    }
+                    for (int e = 0; e < 3; ++e)
+                    {
+                        const int from = faces[i].v[e];
+                        const int to = faces[i].v[(e + 1) % 3];
+                        bool shared = false;
+                        for (int k = 0; k < edge_count; ++k)
+                        {
+                            if (edges[k][0] == to && edges[k][1] == from)
+                            {
+                                edges[k][0] = edges[edge_count - 1][0];
+                                edges[k][1] = edges[edge_count - 1][1];
+                                --edge_count;
+                                shared = true;
+                                break;
+                            }
+                        }
+                        if (!shared)
+                        {
+                            if (edge_count >= max_edges) { overflow = true; break; }
+                            edges[edge_count][0] = from;
+                            edges[edge_count][1] = to;
+                            ++edge_count;
+                        }
+                    }
+                    faces[i] = faces[--face_count];
+                    if (overflow) break;
+                }
+                if (overflow) return false;
+
+                for (int e = 0; e < edge_count; ++e)
+                    if (!add_face(edges[e][0], edges[e][1], new_index)) return false;
+                if (face_count == 0) return false;
+            }
+
+            best = 0;
+            for (int i = 1; i < face_count; ++i)
+                if (faces[i].distance < faces[best].distance) best = i;
+            const Face& f = faces[best];
+
+            real bary[3];
+            triangle_barycentric(vertices[f.v[0]].w, vertices[f.v[1]].w, vertices[f.v[2]].w, f.normal * f.distance, bary);
+            const Vector3 core_a = vertices[f.v[0]].a * bary[0] + vertices[f.v[1]].a * bary[1] + vertices[f.v[2]].a * bary[2];
+            const Vector3 core_b = vertices[f.v[0]].b * bary[0] + vertices[f.v[1]].b * bary[1] + vertices[f.v[2]].b * bary[2];
+
+            result.intersecting = true;
+            result.normal = f.normal;
+            result.distance = -(f.distance + a.margin() + b.margin());
+            result.point_a = core_a + f.normal * a.margin();
+            result.point_b = core_b - f.normal * b.margin();
+            return true;
+        }
+    }
+
+    // GJK distance between two convex colliders, falling back to EPA for the penetration depth
+    // when the cores overlap. Pass the same cache every frame for a pair to warm-start from the
+    // previous simplex.
+    template <typename ShapeA, typename ShapeB>
+    ContactResult collide(const Collider<ShapeA>& a, const Collider<ShapeB>& b, GjkCache* cache = nullptr)
+    {
+        constexpr int max_iterations = 64;
+        constexpr real relative_tolerance = static_cast<real>(1e-10);
+        constexpr real touch_tolerance = REAL_EPSILON * REAL_EPSILON;
+
+        detail::SimplexVertex simplex[4];
+        int count = 0;
+        if (cache != nullptr && cache->count > 0)
+        {
+            for (int i = 0; i < cache->count; ++i)
+            {
+                detail::SimplexVertex& v = simplex[count++];
+                v.la = cache->local_a[i];
+                v.lb = cache->local_b[i];
+                v.a = a.to_world(v.la);
+                v.b = b.to_world(v.lb);
+                v.w = v.a - v.b;
+            }
+        }
+        else
+        {
+            Vector3 dir = b.position - a.position;
+            if (dir.magnitude_squared() < touch_tolerance) dir = Vector3(1, 0, 0);
+            simplex[count++] = detail::minkowski_support(a, b, dir * -1);
+        }
+
+        ContactResult result;
+        Vector3 closest;
+        bool overlap = false;
+        for (; result.iterations < max_iterations; ++result.iterations)
+        {
+            if (!detail::reduce_simplex(simplex, count, closest))
+            {
+                overlap = true;
+                break;
+            }
+
+            const real dist_sq = closest.magnitude_squared();
+            if (dist_sq < touch_tolerance)
+            {
+                overlap = true;
+                break;
+            }
+
+            const detail::SimplexVertex support = detail::minkowski_support(a, b, closest * -1);
+            if (dist_sq - closest * support.w <= relative_tolerance * dist_sq)
+                break;
+
+            bool duplicate = false;
+            for (int i = 0; i < count; ++i)
+                duplicate = duplicate || (simplex[i].w - support.w).magnitude_squared() < touch_tolerance;
+            if (duplicate)
+                break;
+            simplex[count++] = support;
+        }
+
+        if (cache != nullptr)
+        {
+            cache->count = count;
+            for (int i = 0; i < count; ++i)
+            {
+                cache->local_a[i] = simplex[i].la;
+                cache->local_b[i] = simplex[i].lb;
+            }
+        }
+
+        const real margins = a.margin() + b.margin();
+        if (!overlap)
+        {
+            Vector3 core_a, core_b;
+            detail::witness_points(simplex, count, core_a, core_b);
+            const real core_distance = closest.magnitude();
+            result.normal = closest * (-1 / core_distance);
+            result.distance = core_distance - margins;
+            result.intersecting = result.distance <= 0;
+            result.point_a = core_a + result.normal * a.margin();
+            result.point_b = core_b - result.normal * b.margin();
+            return result;
+        }
+
+        if (detail::complete_tetrahedron(a, b, simplex, count) && detail::epa(a, b, simplex, result))
+            return result;
+
+        // Cores touch in a degenerate configuration (e.g. coincident sphere centers)
+        Vector3 core_a, core_b;
+        detail::witness_points(simplex, std::min(count, 3), core_a, core_b);
+        result.intersecting = true;
+        result.normal = Vector3(0, 1, 0);
+        result.distance = -margins;
+        result.point_a = core_a + result.normal * a.margin();
+        result.point_b = core_b - result.normal * b.margin();
+        return result;
+    }
+
+    template <typename ShapeA, typename ShapeB>
+    bool intersects(const Collider<ShapeA>& a, const Collider<ShapeB>& b, GjkCache* cache = nullptr)
+    {
+        return collide(a, b, cache).intersecting;
+    }
+}
+
+#endif //LINKIT_GJK_H
@@ -0,0 +1,241 @@
+#ifndef LINKIT_GPU_STAGING_H
+#define LINKIT_GPU_STAGING_H
+#include "precision.h"
+#include "vector3.h"
+#include "matrix3.h"
+#include "matrix4.h"
+#include "quaternion.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#if defined(__SSE__) || defined(_M_X64)
+#include <immintrin.h>
+#define LINKIT_STREAMING_STORES 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#define LINKIT_STAGING_SSE2 1
+#endif
+
+// Bulk conversion of linkit types into float32 GPU staging buffers in std140/std430 layout:
+//  - Matrix4:    mat4, 16 floats in column-major order
+//  - Matrix3:    mat3, three columns padded to vec4 (12 floats)
+//  - Vector3:    vec4 with a caller-chosen w (the array stride of vec3 in both layouts), or
+//                packed xyz for vertex streams
+//  - Quaternion: vec4 as (x, y, z, w)
+// Each element is converted into an aligned block on the stack and then copied out. With SSE2
+// and real = double the conversion narrows two values per _mm_cvtpd_ps and the matrices are
+// transposed in registers; otherwise, and for packed xyz, it is one static_cast per value. With StoreMode::streaming the copy uses non-temporal stores so a large
+// upload does not evict the working set from cache; it falls back to regular stores when the
+// target has none or the destination is not 16-byte aligned.
+
+namespace linkit
+{
+    enum class StoreMode
+    {
+        regular,
+        streaming
+    };
+
+    namespace detail
+    {
+        template <std::size_t N>
+        inline void store_floats(float* dst, const float (&block)[N], const bool streaming)
+        {
+#if defined(LINKIT_STREAMING_STORES)
+            if (streaming && N % 4 == 0 && reinterpret_cast<std::uintptr_t>(dst) % 16 == 0)
+            {
+                for (std::size_t i = 0; i < N; i += 4)
+                    _mm_stream_ps(dst + i, _mm_load_ps(block + i));
+                return;
+            }
+#else
+            (void)streaming;
+#endif
+            std::copy(block, block + N, dst);
+        }
+
+        // Non-temporal stores are weakly ordered; fence before the chunk is reported done.
+        inline void finish_stores(const bool streaming)
+        {
+#if defined(LINKIT_STREAMING_STORES)
+            if (streaming) _mm_sfence();
+#else
+            (void)streaming;
+#endif
+        }
+
+#if defined(LINKIT_STAGING_SSE2)
+        // Loads are templates so they are only instantiated when real is double.
+        template <typename T>
+        __m128d load_two(const T* p)
+        {
+            return _mm_loadu_pd(p);
+        }
+
+        template <typename T>
+        __m128d load_one(const T* p)
+        {
+            return _mm_load_sd(p);
+        }
+
+        // Four float32 lanes (lo[0], lo[1], hi[0], hi[1]).
+        inline __m128 narrow(const __m128d lo, const __m128d hi)
+        {
+            return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+        }
+#endif
+
+        // Column c of mat in block[c * 4 .. c * 4 + 3].
+        inline void convert(const Matrix4& mat, float (&block)[16])
+        {
+#if defined(LINKIT_STAGING_SSE2)
+            if constexpr (std::is_same_v<real, double>)
+            {
+                __m128 c0 = narrow(load_two(mat.m[0]), load_two(mat.m[0] + 2));
+                __m128 c1 = narrow(load_two(mat.m[1]), load_two(mat.m[1] + 2));
+                __m128 c2 = narrow(load_two(mat.m[2]), load_two(mat.m[2] + 2));
+                __m128 c3 = narrow(load_two(mat.m[3]), load_two(mat.m[3] + 2));
+                _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+                _mm_storeu_ps(block, c0);
+                _mm_storeu_ps(block + 4, c1);
+                _mm_storeu_ps(block + 8, c2);
+                _mm_storeu_ps(block + 12, c3);
+                return;
+            }
+#endif
+            for (int c = 0; c < 4; ++c)
+                for (int r = 0; r < 4; ++r)
+                    block[c * 4 + r] = static_cast<float>(mat.m[r][c]);
+        }
+
+        // Column c of mat in block[c * 4 .. c * 4 + 2], padded with a zero.
+        inline void convert(const Matrix3& mat, float (&block)[12])
+        {
+#if defined(LINKIT_STAGING_SSE2)
+            if constexpr (std::is_same_v<real, double>)
+            {
+                __m128 c0 = narrow(load_two(mat.m[0]), load_one(mat.m[0] + 2));
+                __m128 c1 = narrow(load_two(mat.m[1]), load_one(mat.m[1] + 2));
+                __m128 c2 = narrow(load_two(mat.m[2]), load_one(mat.m[2] + 2));
+                __m128 c3 = _mm_setzero_ps();
+                _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+                _mm_storeu_ps(block, c0);
+                _mm_storeu_ps(block + 4, c1);
+                _mm_storeu_ps(block + 8, c2);
+                return;
+            }
+#endif
+            for (int c = 0; c < 3; ++c)
+            {
+                for (int r = 0; r < 3; ++r)
+                    block[c * 4 + r] = static_cast<float>(mat.m[r][c]);
+                block[c * 4 + 3] = 0.0f;
+            }
+        }
+
+        inline void convert(const Vector3& vec, const float w, float (&block)[4])
+        {
+#if defined(LINKIT_STAGING_SSE2)
+            if constexpr (std::is_same_v<real, double>)
+            {
+                const __m128 xyz = narrow(load_two(&vec.x), load_one(&vec.z));
+                _mm_storeu_ps(block, _mm_movelh_ps(xyz, _mm_unpackhi_ps(xyz, _mm_set1_ps(w))));
+                return;
+            }
+#endif
+            block[0] = static_cast<float>(vec.x);
+            block[1] = static_cast<float>(vec.y);
+            block[2] = static_cast<float>(vec.z);
+            block[3] = w;
+        }
+
+        // (x, y, z, w), the vec4 order.
+        inline void convert(const Quaternion& q, float (&block)[4])
+        {
+#if defined(LINKIT_STAGING_SSE2)
+            if constexpr (std::is_same_v<real, double>)
+            {
+                const __m128 wxyz = narrow(load_two(&q.w), load_two(&q.y));
+                _mm_storeu_ps(block, _mm_shuffle_ps(wxyz, wxyz, _MM_SHUFFLE(0, 3, 2, 1)));
+                return;
+            }
+#endif
+            block[0] = static_cast<float>(q.x);
+            block[1] = static_cast<float>(q.y);
+            block[2] = static_cast<float>(q.z);
+            block[3] = static_cast<float>(q.w);
+        }
+
+        // Runs fn(i, dst) for each element that fits in out, stride floats apart.
+        template <typename Fn>
+        std::size_t stage(const std::size_t count, const std::span<float> out, const std::size_t stride, const StoreMode mode, Fn&& fn)
+        {
+            const std::size_t n = std::min(count, out.size() / stride);
+            const bool streaming = mode == StoreMode::streaming;
+            parallel_for(n, 4096, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                    fn(i, out.data() + i * stride, streaming);
+                finish_stores(streaming);
+            });
+            return n;
+        }
+    }
+
+    // Each function returns the number of elements written, limited by the size of out.
+
+    inline std::size_t stage_matrices(const std::span<const Matrix4> matrices, const std::span<float> out,
+                                      const StoreMode mode = StoreMode::regular)
+    {
+        return detail::stage(matrices.size(), out, 16, mode, [&](const std::size_t i, float* dst, const bool streaming) {
+            alignas(16) float block[16];
+            detail::convert(matrices[i], block);
+            detail::store_floats(dst, block, streaming);
+        });
+    }
+
+    inline std::size_t stage_matrices(const std::span<const Matrix3> matrices, const std::span<float> out,
+                                      const StoreMode mode = StoreMode::regular)
+    {
+        return detail::stage(matrices.size(), out, 12, mode, [&](const std::size_t i, float* dst, const bool streaming) {
+            alignas(16) float block[12];
+            detail::convert(matrices[i], block);
+            detail::store_floats(dst, block, streaming);
+        });
+    }
+
+    inline std::size_t stage_vectors(const std::span<const Vector3> vectors, const std::span<float> out,
+                                     const float w = 0.0f, const StoreMode mode = StoreMode::regular)
+    {
+        return detail::stage(vectors.size(), out, 4, mode, [&](const std::size_t i, float* dst, const bool streaming) {
+            alignas(16) float block[4];
+            detail::convert(vectors[i], w, block);
+            detail::store_floats(dst, block, streaming);
+        });
+    }
+
+    // Tightly packed xyz triples, e.g. for a vertex buffer. Always uses regular stores.
+    inline std::size_t stage_vectors_packed(const std::span<const Vector3> vectors, const std::span<float> out)
+    {
+        return detail::stage(vectors.size(), out, 3, StoreMode::regular, [&](const std::size_t i, float* dst, bool) {
+            const Vector3& vec = vectors[i];
+            dst[0] = static_cast<float>(vec.x);
+            dst[1] = static_cast<float>(vec.y);
+            dst[2] = static_cast<float>(vec.z);
+        });
+    }
+
+    inline std::size_t stage_quaternions(const std::span<const Quaternion> quaternions, const std::span<float> out,
+                                         const StoreMode mode = StoreMode::regular)
+    {
+        return detail::stage(quaternions.size(), out, 4, mode, [&](const std::size_t i, float* dst, const bool streaming) {
+            alignas(16) float block[4];
+            detail::convert(quaternions[i], block);
+            detail::store_floats(dst, block, streaming);
+        });
+    }
+}
+
+#endif //LINKIT_GPU_STAGING_H
@@ -0,0 +1,332 @@
+#ifndef LINKIT_ICP_H
+#define LINKIT_ICP_H
+#include "precision.h"
+#include "vector3.h"
+#include "matrix3.h"
+#include "matrix4.h"
+#include "quaternion.h"
+#include "kdtree.h"
+#include "morton.h"
+#include "aabb.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace linkit
+{
+    struct IcpSettings
+    {
+        int max_iterations = 50;
+        // Stop once the mean squared correspondence distance improves by less than this fraction
+        real relative_tolerance = static_cast<real>(1e-6);
+        // Correspondences farther apart than this are ignored
+        real max_correspondence_distance = std::numeric_limits<real>::max();
+    };
+
+    struct IcpResult
+    {
+        Quaternion rotation;     // Maps source points onto the target: target ~ rotation * source + translation
+        Vector3 translation;
+        real rms_error = 0;      // Over the correspondences of the last iteration
+        std::size_t correspondences = 0;
+        int iterations = 0;
+        bool converged = false;
+
+        [[nodiscard]] Matrix4 transform() const
+        {
+            return Matrix4::object_transform_matrix(translation, rotation, Vector3(1, 1, 1));
+        }
+    };
+
+    namespace detail
+    {
+        // Sums over matched pairs, taken relative to a reference point near the clouds so that
+        // clouds far from the origin do not lose precision in the products.
+        struct CovarianceSums
+        {
+            real count = 0;
+            real sum_error = 0;
+            real p[3] = {};
+            real q[3] = {};
+            real pq[3][3] = {};
+
+            void add(const CovarianceSums& other)
+            {
+                count += other.count;
+                sum_error += other.sum_error;
+                for (int i = 0; i < 3; ++i)
+                {
+                    p[i] += other.p[i];
+                    q[i] += other.q[i];
+                    for (int j = 0; j < 3; ++j)
+                        pq[i][j] += other.pq[i][j];
+                }
+            }
+        };
+
+        // Eigenvector of the largest eigenvalue of a symmetric 4x4 matrix, by cyclic Jacobi rotations.
+        inline void largest_eigenvector4(real a[4][4], real out[4])
+        {
+            real v[4][4] = {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}};
+            for (int sweep = 0; sweep < 32; ++sweep)
+            {
+                real off = 0, diag = 0;
+                for (int i = 0; i < 4; ++i)
+                {
+                    diag += a[i][i] * a[i][i];
+                    for (int j = i + 1; j < 4; ++j)
+                        off += a[i][j] * a[i][j];
+                }
+                if (off <= std::numeric_limits<real>::epsilon() * std::numeric_limits<real>::epsilon() * diag) break;
+
+                for (int p = 0; p < 3; ++p)
+                    for (int q = p + 1; q < 4; ++q)
+                    {
+                        if (a[p][q] == 0) continue;
+                        const real theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+                        const real t = (theta >= 0 ? 1 : -1) / (std::abs(theta) + real_sqrt(theta * theta + 1));
+                        const real c = 1 / real_sqrt(t * t + 1);
+                        const real s = t * c;
+                        for (int k = 0; k < 4; ++k)
+                        {
+                            const real akp = a[k][p], akq = a[k][q];
+                            a[k][p] = c * akp - s * akq;
+                            a[k][q] = s * akp + c * akq;
+                        }
+                        for (int k = 0; k < 4; ++k)
+                        {
+                            const real apk = a[p][k], aqk = a[q][k];
+                            a[p][k] = c * apk - s * aqk;
+                            a[q][k] = s * apk + c * aqk;
+                        }
+                        for (int k = 0; k < 4; ++k)
+                        {
+                            const real vkp = v[k][p], vkq = v[k][q];
+                            v[k][p] = c * vkp - s * vkq;
+                            v[k][q] = s * vkp + c * vkq;
+                        }
+                    }
+            }
+
+            int best = 0;
+            for (int i = 1; i < 4; ++i)
+                if (a[i][i] > a[best][best]) best = i;
+            for (int k = 0; k < 4; ++k)
+                out[k] = v[k][best];
+        }
+
+        // Horn's closed-form absolute orientation: the rotation best mapping centered p onto
+        // centered q is the dominant eigenvector of a 4x4 matrix built from their covariance.
+        inline Quaternion horn_rotation(const real s[3][3])
+        {
+            const real sxx = s[0][0], sxy = s[0][1], sxz = s[0][2];
+            const real syx = s[1][0], syy = s[1][1], syz = s[1][2];
+            const real szx = s[2][0], szy = s[2][1], szz = s[2][2];
+            real n[4][4] = {
+                {sxx + syy + szz, syz - szy, szx - sxz, sxy - syx},
+                {syz - szy, sxx - syy - szz, sxy + syx, szx + sxz},
+                {szx - sxz, sxy + syx, -sxx + syy - szz, syz + szy},
+                {sxy - syx, szx + sxz, syz + szy, -sxx - syy + szz}};
+            real e[4];
+            largest_eigenvector4(n, e);
+            Quaternion q(e[0], e[1], e[2], e[3]);
+            q.normalize();
+            return q;
+        }
+    }
+
+    // Rigid point-to-point ICP. The target is indexed once in a KdTree; every iteration moves the
+    // source by the current estimate, finds nearest target points with a batched parallel query,
+    // accumulates the cross-covariance in per-chunk 4-lane sums, and solves the incremental
+    // rotation in closed form with Horn's quaternion method. Iteration stops when the error
+    // stops improving. Keep one instance per target to reuse the tree and buffers.
+    class IcpRegistration
+    {
+    public:
+        IcpRegistration() = default;
+
+        explicit IcpRegistration(const std::span<const Vector3> target)
+        {
+            set_target(target);
+        }
+
+        void set_target(const std::span<const Vector3> target)
+        {
+            _target.assign(target.begin(), target.end());
+            _tree.build(_target);
+            _reference = Vector3();
+            for (const Vector3& p : _target) _reference += p;
+            if (!_target.empty()) _reference *= static_cast<real>(1.0) / static_cast<real>(_target.size());
+        }
+
+        // Aligns source to the target, starting from initial.
+        IcpResult align(const std::span<const Vector3> source, const IcpSettings& settings = {}, const IcpResult& initial = {})
+        {
+            IcpResult result = initial;
+            result.converged = false;
+            result.iterations = 0;
+            const std::size_t n = source.size();
+            if (n == 0 || _target.empty()) return result;
+
+            _moved.resize(n);
+            _matches.resize(n);
+            compute_order(source);
+            const real max_distance_sq = settings.max_correspondence_distance >= std::numeric_limits<real>::max()
+                ? std::numeric_limits<real>::max()
+                : settings.max_correspondence_distance * settings.max_correspondence_distance;
+
+            real previous_error = std::numeric_limits<real>::max();
+            for (int iteration = 0; iteration < settings.max_iterations; ++iteration)
+            {
+                const Matrix3 rotation = result.rotation.to_matrix3();
+                parallel_for(n, 8192, [&](const std::size_t begin, const std::size_t end) {
+                    for (std::size_t i = begin; i < end; ++i)
+                        _moved[i] = rotation * source[i] + result.translation;
+                });
+                // Points move little between iterations, so the distance to the previous match
+                // bounds the search and prunes most of the tree. Points are visited in Morton
+                // order so consecutive searches share cached tree nodes.
+                parallel_for(n, 1024, [&](const std::size_t begin, const std::size_t end) {
+                    for (std::size_t k = begin; k < end; ++k)
+                    {
+                        const std::uint32_t i = _order[k];
+                        const std::uint32_t previous = iteration == 0 ? KdTree::none : _matches[i].index;
+                        if (previous == KdTree::none)
+                        {
+                            _matches[i] = _tree.nearest(_moved[i], max_distance_sq);
+                            continue;
+                        }
+                        const real previous_sq = (_target[previous] - _moved[i]).magnitude_squared();
+                        const KdNeighbor found = _tree.nearest(_moved[i], std::min(previous_sq, max_distance_sq));
+                        if (found.index != KdTree::none)
+                            _matches[i] = found;
+                        else
+                            _matches[i] = previous_sq <= max_distance_sq ? KdNeighbor{previous, previous_sq} : KdNeighbor{KdTree::none, 0};
+                    }
+                });
+
+                const detail::CovarianceSums sums = accumulate();
+                result.iterations = iteration + 1;
+                result.correspondences = static_cast<std::size_t>(sums.count);
+                if (sums.count < 3) break;
+
+                const real error = sums.sum_error / sums.count;
+                result.rms_error = real_sqrt(error);
+
+                // Centered covariance of the moved source against the matched target points
+                const real inv_count = static_cast<real>(1.0) / sums.count;
+                real mean_p[3], mean_q[3], covariance[3][3];
+                for (int i = 0; i < 3; ++i)
+                {
+                    mean_p[i] = sums.p[i] * inv_count;
+                    mean_q[i] = sums.q[i] * inv_count;
+                }
+                for (int i = 0; i < 3; ++i)
+                    for (int j = 0; j < 3; ++j)
+                        covariance[i][j] = sums.pq[i][j] - sums.count * mean_p[i] * mean_q[j];
+
+                // Incremental transform: target ~ delta * moved + delta_t, composed onto the estimate
+                const Quaternion delta = detail::horn_rotation(covariance);
+                const Vector3 source_centroid = Vector3(mean_p[0], mean_p[1], mean_p[2]) + _reference;
+                const Vector3 target_centroid = Vector3(mean_q[0], mean_q[1], mean_q[2]) + _reference;
+                const Vector3 delta_t = target_centroid - delta.rotate(source_centroid);
+                result.rotation = delta * result.rotation;
+                result.rotation.normalize();
+                result.translation = delta.rotate(result.translation) + delta_t;
+
+                if (previous_error - error <= settings.relative_tolerance * previous_error)
+                {
+                    result.converged = true;
+                    break;
+                }
+                previous_error = error;
+            }
+            return result;
+        }
+
+    private:
+        KdTree _tree;
+        std::vector<Vector3> _target;
+        std::vector<Vector3> _moved;
+        std::vector<KdNeighbor> _matches;
+        std::vector<detail::CovarianceSums> _partial;
+        std::vector<std::uint32_t> _codes;
+        std::vector<std::uint32_t> _order;
+        RadixSorter<std::uint32_t> _sorter;
+        Vector3 _reference; // Target centroid
+
+        // A rigid motion keeps neighbors together, so the source's Morton order stays coherent
+        // for the moved points in every iteration.
+        void compute_order(const std::span<const Vector3> source)
+        {
+            AABB bounds = AABB::empty();
+            for (const Vector3& p : source) bounds.expand(p);
+            _codes.resize(source.size());
+            morton_codes<std::uint32_t>(source, bounds, _codes);
+            const std::span<const std::uint32_t> permutation = _sorter.sort(_codes);
+            _order.assign(permutation.begin(), permutation.end());
+        }
+
+        detail::CovarianceSums accumulate()
+        {
+            constexpr std::size_t lanes = 4;
+            const std::size_t n = _moved.size();
+            const std::size_t chunks = parallel_chunk_count(n, 16384);
+            _partial.assign(chunks, {});
+
+            parallel_for_chunks(n, chunks, [&](const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+                // Lane-major accumulators: each lane sums every fourth pair, so the loop body is
+                // independent across lanes and vectorizes
+                real count[lanes] = {}, error[lanes] = {};
+                real p[3][lanes] = {}, q[3][lanes] = {}, pq[3][3][lanes] = {};
+                for (std::size_t base = begin; base < end; base += lanes)
+                {
+                    for (std::size_t l = 0; l < lanes; ++l)
+                    {
+                        const std::size_t i = base + l;
+                        const bool valid = i < end && _matches[i].index != KdTree::none;
+                        const real w = valid ? 1 : 0;
+                        const Vector3 a = valid ? _moved[i] - _reference : Vector3();
+                        const Vector3 b = valid ? _target[_matches[i].index] - _reference : Vector3();
+                        const real pa[3] = {a.x, a.y, a.z}, qb[3] = {b.x, b.y, b.z};
+                        count[l] += w;
+                        error[l] += valid ? _matches[i].distance_sq : 0;
+                        for (int r = 0; r < 3; ++r)
+                        {
+                            p[r][l] += pa[r];
+                            q[r][l] += qb[r];
+                            for (int c = 0; c < 3; ++c)
+                                pq[r][c][l] += pa[r] * qb[c];
+                        }
+                    }
+                }
+
+                detail::CovarianceSums& out = _partial[chunk];
+                for (std::size_t l = 0; l < lanes; ++l)
+                {
+                    out.count += count[l];
+                    out.sum_error += error[l];
+                    for (int r = 0; r < 3; ++r)
+                    {
+                        out.p[r] += p[r][l];
+                        out.q[r] += q[r][l];
+                        for (int c = 0; c < 3; ++c)
+                            out.pq[r][c] += pq[r][c][l];
+                    }
+                }
+            });
+
+            detail::CovarianceSums total;
+            for (const detail::CovarianceSums& part : _partial)
+                total.add(part);
+            return total;
+        }
+    };
+}
+
+#endif //LINKIT_ICP_H
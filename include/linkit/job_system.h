@@ -0,0 +1,302 @@
+#ifndef LINKIT_JOB_SYSTEM_H
+#define LINKIT_JOB_SYSTEM_H
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace linkit
+{
+    class JobSystem;
+
+    namespace detail
+    {
+        // Identifies the worker deque of the current thread.
+        struct JobWorkerSlot
+        {
+            const JobSystem* system = nullptr;
+            std::size_t index = 0;
+        };
+    }
+
+    // A unit of work. A job runs once every dependency has finished and is itself finished once
+    // its function and every job split off from it (see JobSystem::parallel_for) have returned.
+    class Job : public std::enable_shared_from_this<Job>
+    {
+    public:
+        explicit Job(std::function<void()> fn): _fn(std::move(fn)) {}
+
+        [[nodiscard]] bool done() const
+        {
+            return _done.load(std::memory_order_acquire);
+        }
+
+    private:
+        friend class JobSystem;
+
+        std::function<void()> _fn;
+        std::shared_ptr<Job> _parent;
+        std::atomic<int> _pending{1};    // Unfinished dependencies, plus one until submitted
+        std::atomic<int> _unfinished{1}; // The job itself plus split-off children
+        std::atomic<bool> _done{false};
+        std::mutex _mutex;               // Guards _continuations against a concurrent finish
+        std::vector<std::shared_ptr<Job>> _continuations;
+    };
+
+    using JobHandle = std::shared_ptr<Job>;
+
+    // Work-stealing job scheduler. Each worker owns a deque: it pushes and pops work at the back
+    // and idle workers steal from the front of the others. Threads that are not workers (the main
+    // thread, or the threads of a pool this system is embedded in) share one extra deque and can
+    // execute jobs with run_one() or worker_loop(); wait() also runs jobs instead of blocking.
+    class JobSystem
+    {
+    public:
+        // worker_threads may be 0 to only run jobs on threads that call wait(), run_one() or worker_loop().
+        explicit JobSystem(const std::size_t worker_threads = default_worker_count())
+            : _queues(worker_threads + 1)
+        {
+            _workers.reserve(worker_threads);
+            for (std::size_t i = 0; i < worker_threads; ++i)
+                _workers.emplace_back([this, i](const std::stop_token& stop) {
+                    t_worker.system = this;
+                    t_worker.index = i;
+                    worker_loop(stop);
+                });
+        }
+
+        ~JobSystem()
+        {
+            for (std::jthread& worker : _workers)
+                worker.request_stop();
+            wake_all();
+            for (std::jthread& worker : _workers)
+                worker.join();
+        }
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        [[nodiscard]] std::size_t worker_count() const
+        {
+            return _workers.size();
+        }
+
+        // Creates a job that does not run until submit() is called.
+        static JobHandle create(std::function<void()> fn)
+        {
+            return std::make_shared<Job>(std::move(fn));
+        }
+
+        // Makes job wait for dependency. Must be called before job is submitted.
+        static void depends_on(const JobHandle& job, const JobHandle& dependency)
+        {
+            std::lock_guard lock(dependency->_mutex);
+            if (dependency->done()) return;
+            job->_pending.fetch_add(1, std::memory_order_relaxed);
+            dependency->_continuations.push_back(job);
+        }
+
+        void submit(const JobHandle& job)
+        {
+            if (job->_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                push(job);
+        }
+
+        // Creates, links and submits a job in one call.
+        JobHandle schedule(std::function<void()> fn, const std::initializer_list<JobHandle> dependencies = {})
+        {
+            JobHandle job = create(std::move(fn));
+            for (const JobHandle& dependency : dependencies)
+                if (dependency) depends_on(job, dependency);
+            submit(job);
+            return job;
+        }
+
+        // Job that finishes after fn(begin, end) has covered [0, count). The range is split in
+        // halves on demand: the running job keeps the front half and pushes the back half where
+        // idle workers can steal it, down to a grain chosen from count and the worker count.
+        template <typename Fn>
+        JobHandle parallel_for(const std::size_t count, const std::size_t min_chunk, Fn fn,
+                               const std::initializer_list<JobHandle> dependencies = {})
+        {
+            const std::size_t threads = worker_count() + 1;
+            const std::size_t grain = std::max<std::size_t>({min_chunk, count / (threads * 8), 1});
+            auto shared_fn = std::make_shared<Fn>(std::move(fn));
+
+            JobHandle root = create(nullptr);
+            root->_fn = [this, root_ptr = root.get(), shared_fn, count, grain] {
+                run_split(root_ptr, shared_fn, 0, count, grain);
+            };
+            for (const JobHandle& dependency : dependencies)
+                if (dependency) depends_on(root, dependency);
+            submit(root);
+            return root;
+        }
+
+        // Runs other jobs on the calling thread until job has finished.
+        void wait(const JobHandle& job)
+        {
+            while (!job->done())
+            {
+                if (!run_one())
+                    std::this_thread::yield();
+            }
+        }
+
+        // Executes one ready job on the calling thread. Returns false if none was found.
+        bool run_one()
+        {
+            JobHandle job = find_job(own_queue());
+            if (!job) return false;
+            execute(job);
+            return true;
+        }
+
+        // Loop for an external thread lent to this scheduler, e.g. by an existing thread pool.
+        void worker_loop(const std::stop_token& stop)
+        {
+            while (!stop.stop_requested())
+            {
+                const std::uint32_t epoch = _epoch.load(std::memory_order_acquire);
+                if (run_one()) continue;
+                if (stop.stop_requested()) break;
+                _sleeping.fetch_add(1, std::memory_order_acq_rel);
+                _epoch.wait(epoch, std::memory_order_acquire);
+                _sleeping.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+
+        static std::size_t default_worker_count()
+        {
+            const unsigned count = std::thread::hardware_concurrency();
+            return count > 1 ? count - 1 : 0;
+        }
+
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<JobHandle> jobs;
+        };
+
+        static inline thread_local detail::JobWorkerSlot t_worker;
+
+        std::vector<Queue> _queues; // One per worker, the last shared by non-worker threads
+        std::atomic<std::uint32_t> _epoch{0};
+        std::atomic<std::uint32_t> _sleeping{0};
+        std::vector<std::jthread> _workers; // Declared last so workers stop before the queues go away
+
+        [[nodiscard]] std::size_t own_queue() const
+        {
+            return t_worker.system == this ? t_worker.index : _queues.size() - 1;
+        }
+
+        void push(const JobHandle& job)
+        {
+            Queue& queue = _queues[own_queue()];
+            {
+                std::lock_guard lock(queue.mutex);
+                queue.jobs.push_back(job);
+            }
+            _epoch.fetch_add(1, std::memory_order_release);
+            if (_sleeping.load(std::memory_order_acquire) > 0)
+                _epoch.notify_one();
+        }
+
+        void wake_all()
+        {
+            _epoch.fetch_add(1, std::memory_order_release);
+            _epoch.notify_all();
+        }
+
+        JobHandle find_job(const std::size_t own)
+        {
+            {
+                Queue& queue = _queues[own];
+                std::lock_guard lock(queue.mutex);
+                if (!queue.jobs.empty())
+                {
+                    JobHandle job = std::move(queue.jobs.back());
+                    queue.jobs.pop_back();
+                    return job;
+                }
+            }
+            for (std::size_t offset = 1; offset < _queues.size(); ++offset)
+            {
+                Queue& victim = _queues[(own + offset) % _queues.size()];
+                std::unique_lock lock(victim.mutex, std::try_to_lock);
+                if (!lock.owns_lock() || victim.jobs.empty()) continue;
+                JobHandle job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+                return job;
+            }
+            return nullptr;
+        }
+
+        void execute(const JobHandle& job)
+        {
+            if (job->_fn)
+            {
+                job->_fn();
+                job->_fn = nullptr; // Release captures before continuations run
+            }
+            finish(job.get());
+        }
+
+        void finish(Job* job)
+        {
+            if (job->_unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+            std::vector<JobHandle> continuations;
+            {
+                std::lock_guard lock(job->_mutex);
+                job->_done.store(true, std::memory_order_release);
+                continuations.swap(job->_continuations);
+            }
+            for (const JobHandle& continuation : continuations)
+                submit(continuation);
+
+            JobHandle parent = std::move(job->_parent);
+            if (parent) finish(parent.get());
+        }
+
+        template <typename Fn>
+        void run_split(Job* root, const std::shared_ptr<Fn>& fn, const std::size_t begin, std::size_t end, const std::size_t grain)
+        {
+            while (end - begin > grain)
+            {
+                const std::size_t mid = begin + (end - begin) / 2;
+                const std::size_t child_end = end;
+                root->_unfinished.fetch_add(1, std::memory_order_relaxed);
+
+                JobHandle child = create(nullptr);
+                child->_fn = [this, root, fn, mid, child_end, grain] {
+                    run_split(root, fn, mid, child_end, grain);
+                };
+                child->_pending.store(0, std::memory_order_relaxed);
+                child->_parent = root->shared_from_this();
+                push(child);
+                end = mid;
+            }
+            (*fn)(begin, end);
+        }
+    };
+
+    // Scheduler shared by the batch kernels in this library.
+    inline JobSystem& default_job_system()
+    {
+        static JobSystem system;
+        return system;
+    }
+}
+
+#endif //LINKIT_JOB_SYSTEM_H
@@ -0,0 +1,268 @@
+#ifndef LINKIT_KDTREE_H
+#define LINKIT_KDTREE_H
+#include "precision.h"
+#include "vector3.h"
+#include "aabb.h"
+#include "parallel.h"
+#include "job_system.h"
+#include "morton.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace linkit
+{
+    struct KdNeighbor
+    {
+        std::uint32_t index;  // Index into the point array passed to KdTree::build()
+        real distance_sq;
+    };
+
+    // Static k-d tree over a Vector3 array. The tree is implicit: points are reordered so that
+    // every node covers a contiguous range [begin, end) with its splitting point at the middle
+    // and its children on either side, down to leaves of at most leaf_size points. A node is
+    // just its splitting point with the axis packed alongside, 32 bytes, so each step of a
+    // descent touches one cache line and a leaf is a short contiguous scan. Construction splits
+    // at the median along the longest side of the node's box and builds subtrees as parallel jobs.
+    class KdTree
+    {
+    public:
+        static constexpr std::size_t leaf_size = 8;
+
+        KdTree() = default;
+
+        explicit KdTree(const std::span<const Vector3> points)
+        {
+            build(points);
+        }
+
+        void build(const std::span<const Vector3> points)
+        {
+            const std::size_t n = points.size();
+            _nodes.resize(n);
+            AABB bounds = AABB::empty();
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                _nodes[i] = Node{{points[i].x, points[i].y, points[i].z}, static_cast<std::uint32_t>(i), 0};
+                bounds.expand(points[i]);
+            }
+            build_range(0, n, bounds);
+            _bounds = bounds;
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return _nodes.size();
+        }
+
+        // Closest point within sqrt(max_distance_sq). Returns index none if there is none.
+        [[nodiscard]] KdNeighbor nearest(const Vector3& point, const real max_distance_sq = std::numeric_limits<real>::max()) const
+        {
+            KdNeighbor best{none, max_distance_sq};
+            search(point, max_distance_sq, [&](const std::uint32_t slot, const real dist_sq) {
+                if (dist_sq < best.distance_sq) best = {_nodes[slot].index, dist_sq};
+                return best.distance_sq;
+            });
+            return best;
+        }
+
+        // The up to out.size() nearest points, closest first. Returns how many were found.
+        std::size_t knn(const Vector3& point, const std::span<KdNeighbor> out,
+                        const real max_distance_sq = std::numeric_limits<real>::max()) const
+        {
+            const std::size_t k = out.size();
+            if (k == 0) return 0;
+            std::size_t count = 0;
+            search(point, max_distance_sq, [&](const std::uint32_t slot, const real dist_sq) {
+                if (count == k && dist_sq >= out[k - 1].distance_sq) return out[k - 1].distance_sq;
+                // Insertion into the sorted candidate list
+                std::size_t i = count < k ? count++ : k - 1;
+                while (i > 0 && out[i - 1].distance_sq > dist_sq)
+                {
+                    out[i] = out[i - 1];
+                    --i;
+                }
+                out[i] = {_nodes[slot].index, dist_sq};
+                return count == k ? out[k - 1].distance_sq : max_distance_sq;
+            });
+            return count;
+        }
+
+        // Appends every point closer than radius to out, in no particular order.
+        void radius(const Vector3& point, const real radius, std::vector<KdNeighbor>& out) const
+        {
+            const real radius_sq = radius * radius;
+            search(point, radius_sq, [&](const std::uint32_t slot, const real dist_sq) {
+                if (dist_sq < radius_sq) out.push_back({_nodes[slot].index, dist_sq});
+                return radius_sq;
+            });
+        }
+
+        // Batched queries on the default job system. Large batches are visited in Morton order of
+        // the query points so that consecutive searches walk the same part of the tree and hit
+        // cache; results are still written in query order.
+
+        void nearest(const std::span<const Vector3> queries, const std::span<KdNeighbor> out,
+                     const real max_distance_sq = std::numeric_limits<real>::max()) const
+        {
+            const std::size_t count = std::min(queries.size(), out.size());
+            const std::vector<std::uint32_t> order = query_order(queries.first(count));
+            parallel_for(count, 256, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const std::uint32_t q = order[i];
+                    out[q] = nearest(queries[q], max_distance_sq);
+                }
+            });
+        }
+
+        // out holds k entries per query and counts one entry per query.
+        void knn(const std::span<const Vector3> queries, const std::size_t k, const std::span<KdNeighbor> out,
+                 const std::span<std::uint32_t> counts, const real max_distance_sq = std::numeric_limits<real>::max()) const
+        {
+            const std::size_t count = k == 0 ? 0 : std::min({queries.size(), out.size() / k, counts.size()});
+            const std::vector<std::uint32_t> order = query_order(queries.first(count));
+            parallel_for(count, 128, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const std::uint32_t q = order[i];
+                    counts[q] = static_cast<std::uint32_t>(knn(queries[q], out.subspan(q * k, k), max_distance_sq));
+                }
+            });
+        }
+
+        // Neighbors of query q are results[offsets[q], offsets[q + 1]).
+        void radius(const std::span<const Vector3> queries, const real radius, std::vector<std::uint32_t>& offsets,
+                    std::vector<KdNeighbor>& results) const
+        {
+            const std::vector<std::uint32_t> order = query_order(queries);
+            parallel_collect(queries.size(), 256, offsets, results, [&](const std::size_t i, std::vector<KdNeighbor>& out) {
+                const std::uint32_t q = order[i];
+                this->radius(queries[q], radius, out);
+                return q;
+            });
+        }
+
+        static constexpr std::uint32_t none = 0xffffffffu;
+
+    private:
+        struct Node
+        {
+            real p[3];
+            std::uint32_t index;
+            std::uint32_t axis; // Split axis; meaningful for inner nodes only
+        };
+
+        std::vector<Node> _nodes;
+        AABB _bounds = AABB::empty();
+
+        [[nodiscard]] std::vector<std::uint32_t> query_order(const std::span<const Vector3> queries) const
+        {
+            std::vector<std::uint32_t> order(queries.size());
+            if (queries.size() < 4096)
+            {
+                for (std::size_t i = 0; i < order.size(); ++i)
+                    order[i] = static_cast<std::uint32_t>(i);
+                return order;
+            }
+            std::vector<std::uint32_t> codes(queries.size());
+            morton_codes<std::uint32_t>(queries, _bounds, codes);
+            RadixSorter<std::uint32_t> sorter;
+            const std::span<const std::uint32_t> permutation = sorter.sort(codes);
+            std::copy(permutation.begin(), permutation.end(), order.begin());
+            return order;
+        }
+
+        void build_range(const std::size_t begin, const std::size_t end, const AABB& bounds)
+        {
+            if (end - begin <= leaf_size) return;
+
+            const Vector3 size = bounds.max - bounds.min;
+            const int axis = size.x >= size.y && size.x >= size.z ? 0 : size.y >= size.z ? 1 : 2;
+            const std::size_t mid = begin + (end - begin) / 2;
+            std::nth_element(_nodes.begin() + static_cast<std::ptrdiff_t>(begin), _nodes.begin() + static_cast<std::ptrdiff_t>(mid),
+                             _nodes.begin() + static_cast<std::ptrdiff_t>(end),
+                             [axis](const Node& a, const Node& b) { return a.p[axis] < b.p[axis]; });
+            _nodes[mid].axis = static_cast<std::uint32_t>(axis);
+
+            const real split = _nodes[mid].p[axis];
+            AABB left = bounds, right = bounds;
+            if (axis == 0) { left.max.x = split; right.min.x = split; }
+            else if (axis == 1) { left.max.y = split; right.min.y = split; }
+            else { left.max.z = split; right.min.z = split; }
+
+            if (end - begin < 32768)
+            {
+                build_range(begin, mid, left);
+                build_range(mid + 1, end, right);
+                return;
+            }
+            JobSystem& jobs = default_job_system();
+            const JobHandle job = jobs.schedule([&, begin, mid, left] { build_range(begin, mid, left); });
+            build_range(mid + 1, end, right);
+            jobs.wait(job);
+        }
+
+        // Depth-first search visiting nearer children first. visit(slot, distance_sq) is called
+        // for candidate points and returns the current pruning bound.
+        template <typename Visit>
+        void search(const Vector3& point, real bound, Visit&& visit) const
+        {
+            struct Range
+            {
+                std::uint32_t begin, end;
+                real distance_sq; // Lower bound on the distance to anything in the range
+            };
+            Range stack[64];
+            int top = 0;
+            stack[top++] = {0, static_cast<std::uint32_t>(_nodes.size()), 0};
+            const real q[3] = {point.x, point.y, point.z};
+
+            while (top > 0)
+            {
+                const Range range = stack[--top];
+                if (range.distance_sq > bound) continue;
+
+                if (range.end - range.begin <= leaf_size)
+                {
+                    for (std::uint32_t slot = range.begin; slot < range.end; ++slot)
+                    {
+                        const Node& node = _nodes[slot];
+                        const real dx = node.p[0] - q[0];
+                        const real dy = node.p[1] - q[1];
+                        const real dz = node.p[2] - q[2];
+                        const real dist_sq = dx * dx + dy * dy + dz * dz;
+                        if (dist_sq <= bound) bound = visit(slot, dist_sq);
+                    }
+                    continue;
+                }
+
+                const std::uint32_t mid = range.begin + (range.end - range.begin) / 2;
+                const Node& node = _nodes[mid];
+                const real diff = q[node.axis] - node.p[node.axis];
+
+                const Vector3 offset(node.p[0] - q[0], node.p[1] - q[1], node.p[2] - q[2]);
+                const real dist_sq = offset.magnitude_squared();
+                if (dist_sq <= bound) bound = visit(mid, dist_sq);
+
+                const Range left{range.begin, mid, diff > 0 ? std::max(range.distance_sq, diff * diff) : range.distance_sq};
+                const Range right{mid + 1, range.end, diff <= 0 ? std::max(range.distance_sq, diff * diff) : range.distance_sq};
+                // Push the far side first so the near side is searched first
+                if (diff > 0)
+                {
+                    stack[top++] = left;
+                    stack[top++] = right;
+                }
+                else
+                {
+                    stack[top++] = right;
+                    stack[top++] = left;
+                }
+            }
+        }
+    };
+}
+
+#endif //LINKIT_KDTREE_H
@@ -0,0 +1,549 @@
+#ifndef LINKIT_LOOSE_OCTREE_H
+#define LINKIT_LOOSE_OCTREE_H
+#include "precision.h"
+#include "vector3.h"
+#include "vector4.h"
+#include "matrix4.h"
+#include "aabb.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace linkit
+{
+    // Plane normal * p + distance = 0, with the normal pointing to the inside.
+    struct Plane
+    {
+        Vector3 normal;
+        real distance = 0;
+
+        [[nodiscard]] real signed_distance(const Vector3& point) const
+        {
+            return normal * point + distance;
+        }
+    };
+
+    struct Frustum
+    {
+        Plane planes[6]; // left, right, bottom, top, near, far
+
+        // Planes of the clip volume of a view-projection matrix (column vectors, clip = m * p),
+        // normalized, for the matrix's clip depth convention as in project_points.
+        [[nodiscard]] static Frustum from_matrix(const Matrix4& m, const DepthRange depth_range = DepthRange::negative_one_to_one)
+        {
+            const auto row = [&m](const int i) { return Vector4(m.m[i][0], m.m[i][1], m.m[i][2], m.m[i][3]); };
+            const Vector4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+            const Vector4 low = depth_range == DepthRange::negative_one_to_one ? r3 + r2 : r2;
+            const bool reversed = depth_range == DepthRange::reversed_zero_to_one;
+            const Vector4 raw[6] = {
+                r3 + r0, r3 - r0, r3 + r1, r3 - r1,
+                reversed ? r3 - r2 : low, reversed ? low : r3 - r2
+            };
+            Frustum frustum;
+            for (int i = 0; i < 6; ++i)
+            {
+                const Vector3 normal(raw[i].x, raw[i].y, raw[i].z);
+                const real length = normal.magnitude();
+                const real inv = length > 0 ? static_cast<real>(1.0) / length : 0;
+                frustum.planes[i] = Plane{normal * inv, raw[i].w * inv};
+            }
+            return frustum;
+        }
+
+        [[nodiscard]] bool intersects(const Vector3& center, const real radius) const
+        {
+            for (const Plane& plane : planes)
+                if (plane.signed_distance(center) < -radius) return false;
+            return true;
+        }
+    };
+
+    // Half-line origin + t * direction for t in [0, max_distance]. Distances are in units of
+    // |direction|, so they are world distances when direction is normalized.
+    struct Ray
+    {
+        Vector3 origin;
+        Vector3 direction;
+        real max_distance = std::numeric_limits<real>::max();
+    };
+
+    struct OctreeHit
+    {
+        std::uint32_t object;
+        real distance;
+    };
+
+    // Loose octree of spheres for scenes where most objects move every frame. Each node's loose
+    // bounds are its cell scaled by looseness (2 by default) about the cell center. An object is
+    // inserted at the deepest level where its radius is at most (looseness - 1) / 4 of the cell
+    // size, in the cell holding its center, so it can drift by that much again (a quarter cell at
+    // looseness 2) before it leaves the node's loose bounds. Until then move() only updates the
+    // stored sphere, in O(1); after that it relocates the object in O(depth).
+    //
+    // Nodes come from a pool in blocks of eight siblings, and blocks are recycled when a subtree
+    // empties. Objects are linked into their node in place, so insertion and removal never
+    // allocate once the pools have grown. Objects whose center leaves the world bounds are
+    // kept in the root and are still found by every query.
+    class LooseOctree
+    {
+    public:
+        static constexpr std::uint32_t none = 0xffffffffu;
+
+        explicit LooseOctree(const AABB& world, const int max_depth = 8, const real looseness = 2)
+            : _max_depth(std::clamp(max_depth, 0, 20)), _looseness(std::max(looseness, static_cast<real>(1)))
+        {
+            const Vector3 half = world.half_extents();
+            _root_half = std::max({half.x, half.y, half.z, static_cast<real>(REAL_EPSILON)});
+            _nodes.push_back(Node{world.center(), _root_half, none, none, none, 0, 0, 0});
+        }
+
+        // Adds a sphere and returns its handle. Handles of removed objects are reused.
+        std::uint32_t insert(const Vector3& center, const real radius)
+        {
+            std::uint32_t id;
+            if (_free_object != none)
+            {
+                id = _free_object;
+                _free_object = _objects[id].next;
+            }
+            else
+            {
+                id = static_cast<std::uint32_t>(_objects.size());
+                _objects.emplace_back();
+            }
+            Object& object = _objects[id];
+            object.center = center;
+            object.radius = radius;
+            object.alive = true;
+            link(id, place(center, radius));
+            ++_size;
+            return id;
+        }
+
+        void remove(const std::uint32_t id)
+        {
+            if (id >= _objects.size() || !_objects[id].alive) return;
+            unlink(id);
+            _objects[id].alive = false;
+            _objects[id].next = _free_object;
+            _free_object = id;
+            --_size;
+        }
+
+        // Updates an object's sphere. Returns true if it had to be relocated to another node.
+        // Removed or unknown ids are ignored.
+        bool move(const std::uint32_t id, const Vector3& center, const real radius)
+        {
+            if (id >= _objects.size() || !_objects[id].alive) return false;
+            Object& object = _objects[id];
+            object.center = center;
+            object.radius = radius;
+            if (fits(object.node, center, radius)) return false;
+            unlink(id);
+            link(id, place(center, radius));
+            return true;
+        }
+
+        // Batched move. The in-place updates run on the default job system; only the objects
+        // that left their node's loose bounds are relocated afterwards, serially. Returns the
+        // number of relocations. Removed or unknown ids are ignored, as in move(id, ...). ids
+        // must not repeat: the updates of a repeated id would race.
+        std::size_t move(const std::span<const std::uint32_t> ids, const std::span<const Vector3> centers,
+                         const std::span<const real> radii)
+        {
+            const std::size_t count = std::min({ids.size(), centers.size(), radii.size()});
+            const std::size_t chunks = parallel_chunk_count(count, 4096);
+            std::vector<std::vector<std::uint32_t>> misfits(chunks);
+            parallel_for_chunks(count, chunks, [&](const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    if (ids[i] >= _objects.size() || !_objects[ids[i]].alive) continue;
+                    Object& object = _objects[ids[i]];
+                    object.center = centers[i];
+                    object.radius = radii[i];
+                    if (!fits(object.node, centers[i], radii[i])) misfits[chunk].push_back(ids[i]);
+                }
+            });
+            std::size_t relocated = 0;
+            for (const std::vector<std::uint32_t>& list : misfits)
+                for (const std::uint32_t id : list)
+                {
+                    unlink(id);
+                    link(id, place(_objects[id].center, _objects[id].radius));
+                    ++relocated;
+                }
+            return relocated;
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return _size;
+        }
+
+        [[nodiscard]] Vector3 center(const std::uint32_t id) const
+        {
+            return _objects[id].center;
+        }
+
+        [[nodiscard]] real radius(const std::uint32_t id) const
+        {
+            return _objects[id].radius;
+        }
+
+        // Nodes in use, root included.
+        [[nodiscard]] std::size_t node_count() const
+        {
+            return _nodes.size() - _free_blocks.size() * 8;
+        }
+
+        // Appends every object whose sphere overlaps the query sphere.
+        void query_sphere(const Vector3& center, const real radius, std::vector<std::uint32_t>& out) const
+        {
+            traverse(
+                [&](const Node& node, bool&) {
+                    const real extent = node.half * _looseness;
+                    const AABB box = AABB::from_center_extents(node.center, Vector3(extent, extent, extent));
+                    return distance_sq_to_box(center, box) <= radius * radius;
+                },
+                [&](const std::uint32_t id, const bool) {
+                    const Object& object = _objects[id];
+                    const real reach = radius + object.radius;
+                    if ((object.center - center).magnitude_squared() <= reach * reach) out.push_back(id);
+                });
+        }
+
+        // Appends every object whose sphere is at least partly inside the frustum. Subtrees whose
+        // loose bounds are entirely inside are taken without testing their objects.
+        void query_frustum(const Frustum& frustum, std::vector<std::uint32_t>& out) const
+        {
+            traverse(
+                [&](const Node& node, bool& inside) {
+                    const real extent = node.half * _looseness;
+                    bool all_inside = true;
+                    for (const Plane& plane : frustum.planes)
+                    {
+                        const real reach = extent * (std::abs(plane.normal.x) + std::abs(plane.normal.y) + std::abs(plane.normal.z));
+                        const real d = plane.signed_distance(node.center);
+                        if (d < -reach) return false;
+                        if (d < reach) all_inside = false;
+                    }
+                    inside = all_inside;
+                    return true;
+                },
+                [&](const std::uint32_t id, const bool inside) {
+                    const Object& object = _objects[id];
+                    if (inside || frustum.intersects(object.center, object.radius)) out.push_back(id);
+                });
+        }
+
+        // Nearest object hit by the ray, or object none. Children are visited front to back and
+        // pruned against the closest hit so far.
+        [[nodiscard]] OctreeHit raycast(const Ray& ray) const
+        {
+            OctreeHit best{none, ray.max_distance};
+            const Vector3 inv(inverse(ray.direction.x), inverse(ray.direction.y), inverse(ray.direction.z));
+            const real dir_sq = ray.direction.magnitude_squared();
+            if (!(dir_sq > 0)) return best;
+
+            struct Entry
+            {
+                std::uint32_t node;
+                real t;
+            };
+            Entry stack[8 * 21 + 1];
+            int top = 0;
+            // The root is always searched: it also holds the objects outside the world bounds
+            stack[top++] = {0, 0};
+
+            while (top > 0)
+            {
+                const Entry entry = stack[--top];
+                if (entry.t > best.distance) continue;
+                const Node& node = _nodes[entry.node];
+
+                for (std::uint32_t id = node.first_object; id != none; id = _objects[id].next)
+                {
+                    const Object& object = _objects[id];
+                    const real t = ray_sphere(ray, dir_sq, object.center, object.radius);
+                    if (t >= 0 && t <= best.distance) best = {id, t};
+                }
+                if (node.first_child == none) continue;
+
+                // Insert hit children sorted farthest first, so the nearest is popped first
+                const int first = top;
+                for (std::uint32_t c = 0; c < 8; ++c)
+                {
+                    const std::uint32_t child = node.first_child + c;
+                    real t;
+                    if (_nodes[child].subtree_count == 0 || !slab(ray.origin, inv, _nodes[child], best.distance, t)) continue;
+                    int i = top++;
+                    while (i > first && stack[i - 1].t < t)
+                    {
+                        stack[i] = stack[i - 1];
+                        --i;
+                    }
+                    stack[i] = {child, t};
+                }
+            }
+            return best;
+        }
+
+        // Batched queries on the default job system. Results of query q are
+        // results[offsets[q], offsets[q + 1]).
+
+        void query_sphere(const std::span<const Vector3> centers, const std::span<const real> radii,
+                          std::vector<std::uint32_t>& offsets, std::vector<std::uint32_t>& results) const
+        {
+            const std::size_t count = std::min(centers.size(), radii.size());
+            parallel_collect(count, 64, offsets, results, [&](const std::size_t q, std::vector<std::uint32_t>& out) {
+                query_sphere(centers[q], radii[q], out);
+                return q;
+            });
+        }
+
+        void query_frustum(const std::span<const Frustum> frusta, std::vector<std::uint32_t>& offsets,
+                           std::vector<std::uint32_t>& results) const
+        {
+            parallel_collect(frusta.size(), 1, offsets, results, [&](const std::size_t q, std::vector<std::uint32_t>& out) {
+                query_frustum(frusta[q], out);
+                return q;
+            });
+        }
+
+        void raycast(const std::span<const Ray> rays, const std::span<OctreeHit> hits) const
+        {
+            const std::size_t count = std::min(rays.size(), hits.size());
+            parallel_for(count, 128, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                    hits[i] = raycast(rays[i]);
+            });
+        }
+
+    private:
+        struct Node
+        {
+            Vector3 center;
+            real half;                   // Half size of the tight cell
+            std::uint32_t parent;
+            std::uint32_t first_child;   // Eight siblings from here on, or none
+            std::uint32_t first_object;  // Intrusive list through Object::next
+            std::uint32_t object_count;
+            std::uint32_t subtree_count; // Objects in this node and below
+            std::uint32_t depth;
+        };
+
+        struct Object
+        {
+            Vector3 center;
+            real radius = 0;
+            std::uint32_t node = none;
+            std::uint32_t next = none;
+            std::uint32_t prev = none;
+            bool alive = false;
+        };
+
+        std::vector<Node> _nodes;
+        std::vector<std::uint32_t> _free_blocks;
+        std::vector<Object> _objects;
+        std::uint32_t _free_object = none;
+        std::size_t _size = 0;
+        int _max_depth;
+        real _looseness;
+        real _root_half;
+
+        static real inverse(const real v)
+        {
+            return v != 0 ? static_cast<real>(1.0) / v : std::numeric_limits<real>::infinity();
+        }
+
+        static real distance_sq_to_box(const Vector3& p, const AABB& box)
+        {
+            const real dx = std::max({box.min.x - p.x, static_cast<real>(0), p.x - box.max.x});
+            const real dy = std::max({box.min.y - p.y, static_cast<real>(0), p.y - box.max.y});
+            const real dz = std::max({box.min.z - p.z, static_cast<real>(0), p.z - box.max.z});
+            return dx * dx + dy * dy + dz * dz;
+        }
+
+        // Entry distance of the ray into the node's loose bounds, if below max_t.
+        bool slab(const Vector3& origin, const Vector3& inv, const Node& node, const real max_t, real& t_enter) const
+        {
+            const real extent = node.half * _looseness;
+            real t0 = 0, t1 = max_t;
+            const real o[3] = {origin.x, origin.y, origin.z};
+            const real d[3] = {inv.x, inv.y, inv.z};
+            const real c[3] = {node.center.x, node.center.y, node.center.z};
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                real a = (c[axis] - extent - o[axis]) * d[axis];
+                real b = (c[axis] + extent - o[axis]) * d[axis];
+                if (std::isnan(a) || std::isnan(b))
+                {
+                    // Ray parallel to the slab and on its boundary plane
+                    if (o[axis] < c[axis] - extent || o[axis] > c[axis] + extent) return false;
+                    continue;
+                }
+                if (a > b) std::swap(a, b);
+                t0 = std::max(t0, a);
+                t1 = std::min(t1, b);
+                if (t0 > t1) return false;
+            }
+            t_enter = t0;
+            return true;
+        }
+
+        // First t >= 0 at which the ray touches the sphere, 0 if it starts inside, -1 if never.
+        static real ray_sphere(const Ray& ray, const real dir_sq, const Vector3& center, const real radius)
+        {
+            const Vector3 offset = ray.origin - center;
+            const real c = offset.magnitude_squared() - radius * radius;
+            if (c <= 0) return 0;
+            const real b = offset * ray.direction;
+            if (b >= 0) return -1;
+            const real disc = b * b - dir_sq * c;
+            if (disc < 0) return -1;
+            return (-b - real_sqrt(disc)) / dir_sq;
+        }
+
+        // True if the sphere may stay in node: it is still inside the node's loose bounds.
+        bool fits(const std::uint32_t node_index, const Vector3& center, const real radius) const
+        {
+            const Node& node = _nodes[node_index];
+            if (node_index == 0) return depth_for(radius) == 0 || !inside_world(center);
+            const real reach = node.half * _looseness - radius;
+            const Vector3 d = center - node.center;
+            return std::abs(d.x) <= reach && std::abs(d.y) <= reach && std::abs(d.z) <= reach;
+        }
+
+        bool inside_world(const Vector3& center) const
+        {
+            const Vector3 d = center - _nodes[0].center;
+            return std::abs(d.x) <= _root_half && std::abs(d.y) <= _root_half && std::abs(d.z) <= _root_half;
+        }
+
+        // Deepest level where radius is at most (looseness - 1) / 2 of the cell half size.
+        std::uint32_t depth_for(const real radius) const
+        {
+            std::uint32_t depth = 0;
+            real limit = _root_half * (_looseness - 1) * static_cast<real>(0.25);
+            while (depth < static_cast<std::uint32_t>(_max_depth) && radius <= limit)
+            {
+                ++depth;
+                limit *= static_cast<real>(0.5);
+            }
+            return depth;
+        }
+
+        // Finds, creating nodes as needed, the node an object with this sphere belongs in.
+        std::uint32_t place(const Vector3& center, const real radius)
+        {
+            if (!inside_world(center)) return 0;
+            const std::uint32_t depth = depth_for(radius);
+            std::uint32_t index = 0;
+            while (_nodes[index].depth < depth)
+            {
+                if (_nodes[index].first_child == none) split(index);
+                const Node& node = _nodes[index];
+                const std::uint32_t octant = (center.x >= node.center.x ? 1u : 0u) | (center.y >= node.center.y ? 2u : 0u) |
+                                             (center.z >= node.center.z ? 4u : 0u);
+                index = node.first_child + octant;
+            }
+            return index;
+        }
+
+        void split(const std::uint32_t index)
+        {
+            std::uint32_t block;
+            if (!_free_blocks.empty())
+            {
+                block = _free_blocks.back();
+                _free_blocks.pop_back();
+            }
+            else
+            {
+                block = static_cast<std::uint32_t>(_nodes.size());
+                _nodes.resize(_nodes.size() + 8);
+            }
+            const Node parent = _nodes[index];
+            const real half = parent.half * static_cast<real>(0.5);
+            for (std::uint32_t c = 0; c < 8; ++c)
+            {
+                const Vector3 offset((c & 1) ? half : -half, (c & 2) ? half : -half, (c & 4) ? half : -half);
+                _nodes[block + c] = Node{parent.center + offset, half, index, none, none, 0, 0, parent.depth + 1};
+            }
+            _nodes[index].first_child = block;
+        }
+
+        void link(const std::uint32_t id, const std::uint32_t node_index)
+        {
+            Object& object = _objects[id];
+            Node& node = _nodes[node_index];
+            object.node = node_index;
+            object.prev = none;
+            object.next = node.first_object;
+            if (node.first_object != none) _objects[node.first_object].prev = id;
+            node.first_object = id;
+            ++node.object_count;
+            for (std::uint32_t n = node_index; n != none; n = _nodes[n].parent)
+                ++_nodes[n].subtree_count;
+        }
+
+        void unlink(const std::uint32_t id)
+        {
+            Object& object = _objects[id];
+            Node& node = _nodes[object.node];
+            if (object.prev != none) _objects[object.prev].next = object.next;
+            else node.first_object = object.next;
+            if (object.next != none) _objects[object.next].prev = object.prev;
+            --node.object_count;
+
+            // Walk up, recycling child blocks whose subtrees have emptied
+            for (std::uint32_t n = object.node; n != none; n = _nodes[n].parent)
+            {
+                Node& current = _nodes[n];
+                --current.subtree_count;
+                if (current.first_child != none && current.subtree_count == current.object_count)
+                {
+                    _free_blocks.push_back(current.first_child);
+                    current.first_child = none;
+                }
+            }
+            object.node = none;
+        }
+
+        // Depth-first traversal. enter(node, inside) decides whether to descend and may set inside
+        // when the whole subtree passes the query; visit(object, inside) is called per object.
+        template <typename Enter, typename Visit>
+        void traverse(Enter&& enter, Visit&& visit) const
+        {
+            struct Entry
+            {
+                std::uint32_t node;
+                bool inside;
+            };
+            Entry stack[8 * 21 + 1];
+            int top = 0;
+            stack[top++] = {0, false};
+            while (top > 0)
+            {
+                const Entry entry = stack[--top];
+                const Node& node = _nodes[entry.node];
+                if (node.subtree_count == 0) continue;
+                bool inside = entry.inside;
+                // The root always passes: it also holds the objects outside the world bounds
+                if (!inside && entry.node != 0 && !enter(node, inside)) continue;
+
+                for (std::uint32_t id = node.first_object; id != none; id = _objects[id].next)
+                    visit(id, inside);
+                if (node.first_child != none)
+                    for (std::uint32_t c = 0; c < 8; ++c)
+                        stack[top++] = {node.first_child + c, inside};
+            }
+        }
+    };
+}
+
+#endif //LINKIT_LOOSE_OCTREE_H
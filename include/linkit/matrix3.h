@@ -84,6 +84,15 @@ namespace linkit
             );
         }
 
+        // Multiplies by the transpose without forming it. For rotations this is the inverse transform.
+        [[nodiscard]] Vector3 transform_transpose(const Vector3 &other) const {
+            return Vector3(
+                m[0][0] * other.x + m[1][0] * other.y + m[2][0] * other.z,
+                m[0][1] * other.x + m[1][1] * other.y + m[2][1] * other.z,
+                m[0][2] * other.x + m[1][2] * other.y + m[2][2] * other.z
+            );
+        }
+
         // Matrix-Scalar operations
         Matrix3 operator+(const real scalar) const {
             Matrix3 result;
@@ -165,9 +174,10 @@ namespace linkit
                    m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
         }
 
-        void invert() {
+        // Returns false and leaves the matrix unchanged when it is singular.
+        bool invert() {
             const real det = determinant();
-            if (std::abs(det) < REAL_EPSILON) return; // Cannot invert
+            if (std::abs(det) < REAL_EPSILON) return false; // Cannot invert
 
             const real inv_det = static_cast<real>(1.0) / det;
             Matrix3 result;
@@ -183,6 +193,7 @@ namespace linkit
             result.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv_det;
 
             *this = result;
+            return true;
         }
 
         [[nodiscard]] Matrix3 inverse() const {
@@ -191,6 +202,20 @@ namespace linkit
             return result;
         }
 
+        // Solves (*this) * x = b by Cramer's rule without forming the inverse. Returns false and
+        // leaves x untouched when the matrix is singular.
+        bool solve(const Vector3& b, Vector3& x) const {
+            const Vector3 r0(m[0][0], m[0][1], m[0][2]);
+            const Vector3 r1(m[1][0], m[1][1], m[1][2]);
+            const Vector3 r2(m[2][0], m[2][1], m[2][2]);
+            const Vector3 c0 = r1 % r2;
+            const real det = r0 * c0;
+            if (std::abs(det) < REAL_EPSILON) return false;
+
+            x = (c0 * b.x + (r2 % r0) * b.y + (r0 % r1) * b.z) * (static_cast<real>(1.0) / det);
+            return true;
+        }
+
         void transpose() {
             real temp;
             temp = m[0][1]; m[0][1] = m[1][0]; m[1][0] = temp;
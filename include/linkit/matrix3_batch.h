@@ -0,0 +1,402 @@
+#ifndef LINKIT_MATRIX3_BATCH_H
+#define LINKIT_MATRIX3_BATCH_H
+#include "precision.h"
+#include "vector3.h"
+#include "matrix3.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define LINKIT_MATRIX3_BATCH_SSE2 1
+#endif
+
+namespace linkit
+{
+    enum class SolveStatus : std::uint8_t
+    {
+        ok,
+        singular,
+        not_positive_definite
+    };
+
+    // Batched 3x3 kernels. Two matrices at a time are transposed into pairs of lanes (one SSE2
+    // register per matrix entry, unpacked row by row from the two matrices), so every cofactor,
+    // the determinant and the reciprocal are computed for both at once and the singular case is
+    // a lane mask rather than a branch. Targets without SSE2, and builds with real = float, run
+    // the same code on two-element arrays. At two lanes the transposes and register copies cost
+    // about what the paired arithmetic saves, so on one thread this runs at roughly the speed of
+    // calling Matrix3::solve() or invert() per element. A matrix is singular when |det| <
+    // REAL_EPSILON with the determinant expanded as in Matrix3::invert() and solve(), so both
+    // APIs agree on an input.
+    namespace detail
+    {
+        constexpr std::size_t matrix_lanes = 2;
+
+        // Two lanes of a scalar T. The SSE2 specialization is only used when real is double;
+        // with real = float, or without SSE2, the lanes are a plain array.
+        template <typename T>
+        struct LanePair
+        {
+            T v[2];
+        };
+
+        template <typename T>
+        inline LanePair<T> operator+(const LanePair<T> a, const LanePair<T> b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1]}}; }
+        template <typename T>
+        inline LanePair<T> operator-(const LanePair<T> a, const LanePair<T> b) { return {{a.v[0] - b.v[0], a.v[1] - b.v[1]}}; }
+        template <typename T>
+        inline LanePair<T> operator*(const LanePair<T> a, const LanePair<T> b) { return {{a.v[0] * b.v[0], a.v[1] * b.v[1]}}; }
+
+#if defined(LINKIT_MATRIX3_BATCH_SSE2)
+        template <>
+        struct LanePair<double>
+        {
+            __m128d v;
+        };
+
+        inline LanePair<double> operator+(const LanePair<double> a, const LanePair<double> b) { return {_mm_add_pd(a.v, b.v)}; }
+        inline LanePair<double> operator-(const LanePair<double> a, const LanePair<double> b) { return {_mm_sub_pd(a.v, b.v)}; }
+        inline LanePair<double> operator*(const LanePair<double> a, const LanePair<double> b) { return {_mm_mul_pd(a.v, b.v)}; }
+
+        // Lanes (a[0], b[0]) and (a[1], b[1]) of two consecutive values, and (a[0], b[0]) of one.
+        // Templates so the double loads are only instantiated when real is double.
+        template <typename T>
+        inline void unpack_two(const T* a, const T* b, LanePair<double>& first, LanePair<double>& second)
+        {
+            const __m128d ra = _mm_loadu_pd(a), rb = _mm_loadu_pd(b);
+            first = {_mm_unpacklo_pd(ra, rb)};
+            second = {_mm_unpackhi_pd(ra, rb)};
+        }
+
+        template <typename T>
+        inline LanePair<double> unpack_one(const T* a, const T* b)
+        {
+            return {_mm_loadh_pd(_mm_load_sd(a), b)};
+        }
+
+        template <typename T>
+        inline void pack_two(const LanePair<double> first, const LanePair<double> second, T* a, T* b)
+        {
+            _mm_storeu_pd(a, _mm_unpacklo_pd(first.v, second.v));
+            _mm_storeu_pd(b, _mm_unpackhi_pd(first.v, second.v));
+        }
+
+        template <typename T>
+        inline void pack_one(const LanePair<double> lanes, T* a, T* b)
+        {
+            _mm_storel_pd(a, lanes.v);
+            _mm_storeh_pd(b, lanes.v);
+        }
+
+        // Bit l is set where lane l of det is singular (|det| < REAL_EPSILON); 1 / det there is
+        // replaced by 1 / 1 so the lane stays finite.
+        inline int guarded_reciprocal(const LanePair<double> det, LanePair<double>& inv_det)
+        {
+            const __m128d one = _mm_set1_pd(1.0);
+            const __m128d singular = _mm_cmplt_pd(_mm_andnot_pd(_mm_set1_pd(-0.0), det.v), _mm_set1_pd(REAL_EPSILON));
+            inv_det = {_mm_div_pd(one, _mm_or_pd(_mm_and_pd(singular, one), _mm_andnot_pd(singular, det.v)))};
+            return _mm_movemask_pd(singular);
+        }
+
+        // Bit l is set where lane l of value is greater than zero.
+        inline int positive_mask(const LanePair<double> value)
+        {
+            return _mm_movemask_pd(_mm_cmpgt_pd(value.v, _mm_setzero_pd()));
+        }
+#endif
+
+        template <typename T>
+        inline int guarded_reciprocal(const LanePair<T> det, LanePair<T>& inv_det)
+        {
+            int mask = 0;
+            for (int l = 0; l < 2; ++l)
+            {
+                const bool singular = std::abs(det.v[l]) < REAL_EPSILON;
+                inv_det.v[l] = static_cast<T>(1.0) / (singular ? static_cast<T>(1.0) : det.v[l]);
+                mask |= singular ? 1 << l : 0;
+            }
+            return mask;
+        }
+
+        template <typename T>
+        inline int positive_mask(const LanePair<T> value)
+        {
+            return (value.v[0] > 0 ? 1 : 0) | (value.v[1] > 0 ? 2 : 0);
+        }
+
+        // Both lanes of the nine entries of a and b, row by row.
+        template <typename T>
+        inline void load_pairs(const Matrix3& a, const Matrix3& b, LanePair<T> out[9])
+        {
+#if defined(LINKIT_MATRIX3_BATCH_SSE2)
+            if constexpr (std::is_same_v<T, double>)
+            {
+                unpack_two<T>(a.m[0], b.m[0], out[0], out[1]);
+                out[2] = unpack_one<T>(a.m[0] + 2, b.m[0] + 2);
+                unpack_two<T>(a.m[1], b.m[1], out[3], out[4]);
+                out[5] = unpack_one<T>(a.m[1] + 2, b.m[1] + 2);
+                unpack_two<T>(a.m[2], b.m[2], out[6], out[7]);
+                out[8] = unpack_one<T>(a.m[2] + 2, b.m[2] + 2);
+            }
+            else
+#endif
+            {
+                for (int k = 0; k < 9; ++k)
+                    out[k] = {{a.m[k / 3][k % 3], b.m[k / 3][k % 3]}};
+            }
+        }
+
+        template <typename T>
+        inline void store_pairs(const LanePair<T> in[9], Matrix3& a, Matrix3& b)
+        {
+#if defined(LINKIT_MATRIX3_BATCH_SSE2)
+            if constexpr (std::is_same_v<T, double>)
+            {
+                pack_two<T>(in[0], in[1], a.m[0], b.m[0]);
+                pack_one<T>(in[2], a.m[0] + 2, b.m[0] + 2);
+                pack_two<T>(in[3], in[4], a.m[1], b.m[1]);
+                pack_one<T>(in[5], a.m[1] + 2, b.m[1] + 2);
+                pack_two<T>(in[6], in[7], a.m[2], b.m[2]);
+                pack_one<T>(in[8], a.m[2] + 2, b.m[2] + 2);
+            }
+            else
+#endif
+            {
+                for (int k = 0; k < 9; ++k)
+                {
+                    a.m[k / 3][k % 3] = in[k].v[0];
+                    b.m[k / 3][k % 3] = in[k].v[1];
+                }
+            }
+        }
+
+        template <typename T>
+        inline void load_pairs(const Vector3& a, const Vector3& b, LanePair<T> out[3])
+        {
+#if defined(LINKIT_MATRIX3_BATCH_SSE2)
+            if constexpr (std::is_same_v<T, double>)
+            {
+                unpack_two<T>(&a.x, &b.x, out[0], out[1]);
+                out[2] = unpack_one<T>(&a.z, &b.z);
+            }
+            else
+#endif
+            {
+                out[0] = {{a.x, b.x}};
+                out[1] = {{a.y, b.y}};
+                out[2] = {{a.z, b.z}};
+            }
+        }
+
+        template <typename T>
+        inline void store_pairs(const LanePair<T> in[3], Vector3& a, Vector3& b)
+        {
+#if defined(LINKIT_MATRIX3_BATCH_SSE2)
+            if constexpr (std::is_same_v<T, double>)
+            {
+                pack_two<T>(in[0], in[1], &a.x, &b.x);
+                pack_one<T>(in[2], &a.z, &b.z);
+            }
+            else
+#endif
+            {
+                a = Vector3(in[0].v[0], in[1].v[0], in[2].v[0]);
+                b = Vector3(in[0].v[1], in[1].v[1], in[2].v[1]);
+            }
+        }
+
+        using RealLanes = LanePair<real>;
+
+        // Adjugate (row-major, adj[3 * i + j]) and determinant of both lanes.
+        inline void adjugate_pairs(const RealLanes a[9], RealLanes adj[9], RealLanes& det)
+        {
+            adj[0] = a[4] * a[8] - a[5] * a[7];
+            adj[1] = a[2] * a[7] - a[1] * a[8];
+            adj[2] = a[1] * a[5] - a[2] * a[4];
+            adj[3] = a[5] * a[6] - a[3] * a[8];
+            adj[4] = a[0] * a[8] - a[2] * a[6];
+            adj[5] = a[2] * a[3] - a[0] * a[5];
+            adj[6] = a[3] * a[7] - a[4] * a[6];
+            adj[7] = a[1] * a[6] - a[0] * a[7];
+            adj[8] = a[0] * a[4] - a[1] * a[3];
+            det = a[0] * adj[0] + a[1] * adj[3] + a[2] * adj[6];
+        }
+
+        // Stores the solutions of the lanes not set in skip; skipped lanes keep their
+        // right-hand side. Skips are rare, so only they take the per-lane path.
+        inline void store_lanes(const RealLanes x[3], Vector3* rhs, const int skip)
+        {
+            if (skip == 0)
+            {
+                store_pairs(x, rhs[0], rhs[1]);
+                return;
+            }
+            Vector3 lanes[2];
+            store_pairs(x, lanes[0], lanes[1]);
+            for (std::size_t l = 0; l < matrix_lanes; ++l)
+                if (!((skip >> l) & 1)) rhs[l] = lanes[l];
+        }
+
+        // u x v for both lanes.
+        inline void cross_pairs(const RealLanes u[3], const RealLanes v[3], RealLanes out[3])
+        {
+            out[0] = u[1] * v[2] - u[2] * v[1];
+            out[1] = u[2] * v[0] - u[0] * v[2];
+            out[2] = u[0] * v[1] - u[1] * v[0];
+        }
+
+        // The columns of the adjugate are the cross products of the rows, so x is accumulated
+        // one column at a time instead of forming all nine cofactors: with SSE2 the full
+        // adjugate, the matrix and b do not fit in the sixteen registers at once.
+        inline void solve_lanes(const Matrix3* matrices, Vector3* rhs, SolveStatus* status)
+        {
+            RealLanes a[9], b[3], column[3], x[3], det, inv_det;
+            load_pairs(matrices[0], matrices[1], a);
+            load_pairs(rhs[0], rhs[1], b);
+            cross_pairs(a + 3, a + 6, column);
+            det = a[0] * column[0] + a[1] * column[1] + a[2] * column[2];
+            x[0] = column[0] * b[0];
+            x[1] = column[1] * b[0];
+            x[2] = column[2] * b[0];
+            cross_pairs(a + 6, a, column);
+            x[0] = x[0] + column[0] * b[1];
+            x[1] = x[1] + column[1] * b[1];
+            x[2] = x[2] + column[2] * b[1];
+            cross_pairs(a, a + 3, column);
+            const int singular = guarded_reciprocal(det, inv_det);
+            x[0] = (x[0] + column[0] * b[2]) * inv_det;
+            x[1] = (x[1] + column[1] * b[2]) * inv_det;
+            x[2] = (x[2] + column[2] * b[2]) * inv_det;
+
+            store_lanes(x, rhs, singular);
+            for (std::size_t l = 0; l < matrix_lanes; ++l)
+                status[l] = (singular >> l) & 1 ? SolveStatus::singular : SolveStatus::ok;
+        }
+
+        inline void invert_lanes(const Matrix3* matrices, Matrix3* inverses, SolveStatus* status)
+        {
+            RealLanes a[9], adj[9], det, inv_det;
+            load_pairs(matrices[0], matrices[1], a);
+            adjugate_pairs(a, adj, det);
+            const int singular = guarded_reciprocal(det, inv_det);
+            adj[0] = adj[0] * inv_det;
+            adj[1] = adj[1] * inv_det;
+            adj[2] = adj[2] * inv_det;
+            adj[3] = adj[3] * inv_det;
+            adj[4] = adj[4] * inv_det;
+            adj[5] = adj[5] * inv_det;
+            adj[6] = adj[6] * inv_det;
+            adj[7] = adj[7] * inv_det;
+            adj[8] = adj[8] * inv_det;
+
+            if (singular == 0)
+                store_pairs(adj, inverses[0], inverses[1]);
+            else
+            {
+                Matrix3 lanes[2];
+                store_pairs(adj, lanes[0], lanes[1]);
+                for (std::size_t l = 0; l < matrix_lanes; ++l)
+                    inverses[l] = (singular >> l) & 1 ? matrices[l] : lanes[l];
+            }
+            for (std::size_t l = 0; l < matrix_lanes; ++l)
+                status[l] = (singular >> l) & 1 ? SolveStatus::singular : SolveStatus::ok;
+        }
+
+        // The adjugate of a symmetric matrix is symmetric, so the six cofactors of the lower
+        // triangle are enough; c[5] and det are also the leading minors Sylvester's criterion
+        // needs for positive definiteness.
+        inline void solve_spd_lanes(const Matrix3* matrices, Vector3* rhs, SolveStatus* status)
+        {
+            RealLanes a[9], c[6], b[3], det, inv_det;
+            load_pairs(matrices[0], matrices[1], a);
+            load_pairs(rhs[0], rhs[1], b);
+            c[0] = a[4] * a[8] - a[7] * a[7];
+            c[1] = a[7] * a[6] - a[3] * a[8];
+            c[2] = a[3] * a[7] - a[4] * a[6];
+            c[3] = a[0] * a[8] - a[6] * a[6];
+            c[4] = a[6] * a[3] - a[0] * a[7];
+            c[5] = a[0] * a[4] - a[3] * a[3];
+            det = a[0] * c[0] + a[3] * c[1] + a[6] * c[2];
+            const int singular = guarded_reciprocal(det, inv_det);
+            const int positive = positive_mask(a[0]) & positive_mask(c[5]) & positive_mask(det);
+
+            RealLanes x[3];
+            x[0] = (c[0] * b[0] + c[1] * b[1] + c[2] * b[2]) * inv_det;
+            x[1] = (c[1] * b[0] + c[3] * b[1] + c[4] * b[2]) * inv_det;
+            x[2] = (c[2] * b[0] + c[4] * b[1] + c[5] * b[2]) * inv_det;
+
+            store_lanes(x, rhs, singular | (positive ^ 3));
+            for (std::size_t l = 0; l < matrix_lanes; ++l)
+            {
+                const bool is_positive = (positive >> l) & 1, is_singular = (singular >> l) & 1;
+                status[l] = !is_positive ? SolveStatus::not_positive_definite : is_singular ? SolveStatus::singular : SolveStatus::ok;
+            }
+        }
+
+        // Runs kernel over whole lane groups in [begin, end) in place, and over a tail through
+        // identity-padded copies. Callers pass the lane functions wrapped in lambdas: a plain
+        // function reference is called indirectly for every pair instead of being inlined.
+        template <typename Output, typename Kernel>
+        void for_each_lane_group(const std::span<const Matrix3> matrices, const std::span<Output> outputs, const std::span<SolveStatus> status,
+                                 const std::size_t begin, const std::size_t end, Kernel&& kernel)
+        {
+            std::size_t first = begin;
+            for (; first + matrix_lanes <= end; first += matrix_lanes)
+                kernel(matrices.data() + first, outputs.data() + first, status.data() + first);
+            if (first == end) return;
+
+            const std::size_t n = end - first;
+            Matrix3 padded[matrix_lanes];
+            Output padded_out[matrix_lanes];
+            SolveStatus padded_status[matrix_lanes];
+            std::copy_n(matrices.data() + first, n, padded);
+            std::copy_n(outputs.data() + first, n, padded_out);
+            kernel(padded, padded_out, padded_status);
+            std::copy_n(padded_out, n, outputs.data() + first);
+            std::copy_n(padded_status, n, status.data() + first);
+        }
+    }
+
+    // Solves matrices[i] * x = rhs[i] for every i, overwriting rhs[i] with x. Singular systems
+    // keep their right-hand side and report SolveStatus::singular.
+    inline void solve(const std::span<const Matrix3> matrices, const std::span<Vector3> rhs, const std::span<SolveStatus> status)
+    {
+        const std::size_t count = std::min({matrices.size(), rhs.size(), status.size()});
+        parallel_for(count, 4096, [&](const std::size_t begin, const std::size_t end) {
+            detail::for_each_lane_group(matrices, rhs, status, begin, end, [](const Matrix3* m, Vector3* out, SolveStatus* st) {
+                detail::solve_lanes(m, out, st);
+            });
+        });
+    }
+
+    // Writes the inverse of matrices[i] into inverses[i]. Singular matrices are copied unchanged.
+    inline void invert(const std::span<const Matrix3> matrices, const std::span<Matrix3> inverses, const std::span<SolveStatus> status)
+    {
+        const std::size_t count = std::min({matrices.size(), inverses.size(), status.size()});
+        parallel_for(count, 4096, [&](const std::size_t begin, const std::size_t end) {
+            detail::for_each_lane_group(matrices, inverses, status, begin, end, [](const Matrix3* m, Matrix3* out, SolveStatus* st) {
+                detail::invert_lanes(m, out, st);
+            });
+        });
+    }
+
+    // Symmetric positive-definite fast path: reads only the lower triangle and solves with six
+    // cofactors instead of nine. Matrices with a non-positive leading minor keep their
+    // right-hand side and report SolveStatus::not_positive_definite; positive definite ones
+    // with det < REAL_EPSILON report SolveStatus::singular, as in solve().
+    inline void solve_spd(const std::span<const Matrix3> matrices, const std::span<Vector3> rhs, const std::span<SolveStatus> status)
+    {
+        const std::size_t count = std::min({matrices.size(), rhs.size(), status.size()});
+        parallel_for(count, 4096, [&](const std::size_t begin, const std::size_t end) {
+            detail::for_each_lane_group(matrices, rhs, status, begin, end, [](const Matrix3* m, Vector3* out, SolveStatus* st) {
+                detail::solve_spd_lanes(m, out, st);
+            });
+        });
+    }
+}
+
+#endif //LINKIT_MATRIX3_BATCH_H
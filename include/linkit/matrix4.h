@@ -3,6 +3,7 @@
 #include "precision.h"
 #include "vector4.h"
 #include "vector3.h"
+#include <cstdint>
 #include <string>
 #include <cmath> // For std::abs, sin, cos
 
@@ -10,6 +11,15 @@
 
 namespace linkit
 {
+    // Clip-space depth convention of a projection matrix: negative_one_to_one for
+    // Matrix4::perspective / orthographic, reversed_zero_to_one for their reversed-Z forms.
+    enum class DepthRange : std::uint8_t
+    {
+        negative_one_to_one,
+        zero_to_one,
+        reversed_zero_to_one
+    };
+
     class Matrix4
     {
     public:
@@ -76,6 +86,72 @@ namespace linkit
             return result;
         }
 
+        // Right-handed view matrix: the camera at eye looks down its -z axis towards target, with
+        // up (which only must not be parallel to the view direction) giving the +y side.
+        static Matrix4 look_at(const Vector3& eye, const Vector3& target, const Vector3& up) {
+            const Vector3 f = (target - eye).normalized();
+            const Vector3 s = (f % up).normalized();
+            const Vector3 u = s % f;
+            Matrix4 result;
+            result.m[0][0] = s.x;  result.m[0][1] = s.y;  result.m[0][2] = s.z;  result.m[0][3] = -(s * eye);
+            result.m[1][0] = u.x;  result.m[1][1] = u.y;  result.m[1][2] = u.z;  result.m[1][3] = -(u * eye);
+            result.m[2][0] = -f.x; result.m[2][1] = -f.y; result.m[2][2] = -f.z; result.m[2][3] = f * eye;
+            return result;
+        }
+
+        // Projections of view space (looking down -z) to clip space, fov_y in radians. These map
+        // depth to [-1, 1]; the reversed-Z forms below map the near plane to 1 and the far plane
+        // to 0 of a [0, 1] range, which evens out floating-point depth precision over distance.
+        static Matrix4 perspective(const real fov_y, const real aspect, const real z_near, const real z_far) {
+            const real f = static_cast<real>(1.0) / real_tan(fov_y * static_cast<real>(0.5));
+            const real depth = static_cast<real>(1.0) / (z_near - z_far);
+            Matrix4 result;
+            result.m[0][0] = f / aspect;
+            result.m[1][1] = f;
+            result.m[2][2] = (z_far + z_near) * depth;
+            result.m[2][3] = static_cast<real>(2.0) * z_far * z_near * depth;
+            result.m[3][2] = -1;
+            result.m[3][3] = 0;
+            return result;
+        }
+
+        // z_far may be infinity.
+        static Matrix4 perspective_reversed_z(const real fov_y, const real aspect, const real z_near, const real z_far) {
+            const real f = static_cast<real>(1.0) / real_tan(fov_y * static_cast<real>(0.5));
+            Matrix4 result;
+            result.m[0][0] = f / aspect;
+            result.m[1][1] = f;
+            if (std::isinf(z_far)) {
+                result.m[2][2] = 0;
+                result.m[2][3] = z_near;
+            } else {
+                const real depth = static_cast<real>(1.0) / (z_far - z_near);
+                result.m[2][2] = z_near * depth;
+                result.m[2][3] = z_far * z_near * depth;
+            }
+            result.m[3][2] = -1;
+            result.m[3][3] = 0;
+            return result;
+        }
+
+        static Matrix4 orthographic(const real left, const real right, const real bottom, const real top, const real z_near, const real z_far) {
+            Matrix4 result;
+            result.m[0][0] = static_cast<real>(2.0) / (right - left);
+            result.m[0][3] = -(right + left) / (right - left);
+            result.m[1][1] = static_cast<real>(2.0) / (top - bottom);
+            result.m[1][3] = -(top + bottom) / (top - bottom);
+            result.m[2][2] = static_cast<real>(-2.0) / (z_far - z_near);
+            result.m[2][3] = -(z_far + z_near) / (z_far - z_near);
+            return result;
+        }
+
+        static Matrix4 orthographic_reversed_z(const real left, const real right, const real bottom, const real top, const real z_near, const real z_far) {
+            Matrix4 result = orthographic(left, right, bottom, top, z_near, z_far);
+            result.m[2][2] = static_cast<real>(1.0) / (z_far - z_near);
+            result.m[2][3] = z_far / (z_far - z_near);
+            return result;
+        }
+
         // Matrix-Matrix multiplication
         Matrix4 operator*(const Matrix4& other) const {
             Matrix4 result;
@@ -0,0 +1,251 @@
+#ifndef LINKIT_MESH_NORMALS_H
+#define LINKIT_MESH_NORMALS_H
+#include "precision.h"
+#include "vector3.h"
+#include "vector4.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace linkit
+{
+    enum class NormalWeighting
+    {
+        area,  // Each face contributes its unnormalized normal, proportional to its area
+        angle  // Each face contributes its unit normal scaled by the corner angle at the vertex
+    };
+
+    struct TexCoord
+    {
+        real u, v;
+    };
+
+    namespace detail
+    {
+        inline Vector3 unit_or_zero(const Vector3& vec)
+        {
+            const real length_sq = vec.magnitude_squared();
+            return length_sq > 0 ? vec * (static_cast<real>(1.0) / real_sqrt(length_sq)) : Vector3();
+        }
+
+        // Interior angle between two edges leaving a corner.
+        inline real corner_angle(const Vector3& e1, const Vector3& e2)
+        {
+            const real denominator = real_sqrt(e1.magnitude_squared() * e2.magnitude_squared());
+            if (denominator <= 0) return 0;
+            return real_acos(std::clamp((e1 * e2) / denominator, static_cast<real>(-1), static_cast<real>(1)));
+        }
+    }
+
+    // Vertex normals and tangents for an indexed triangle mesh. Per-vertex sums are computed
+    // without atomics: a first pass writes one contribution per triangle corner, and a second
+    // pass lets every vertex gather its own corners through a vertex-to-corner table. The table
+    // depends only on the index buffer, so a deforming mesh builds it once with set_topology()
+    // and then calls compute_normals() every frame. Summation order is fixed, so the output does
+    // not depend on thread timing.
+    class MeshNormals
+    {
+    public:
+        MeshNormals() = default;
+
+        MeshNormals(const std::span<const std::uint32_t> indices, const std::size_t vertex_count)
+        {
+            set_topology(indices, vertex_count);
+        }
+
+        void set_topology(const std::span<const std::uint32_t> indices, const std::size_t vertex_count)
+        {
+            const std::size_t corners = indices.size() - indices.size() % 3;
+            _indices.assign(indices.begin(), indices.begin() + static_cast<std::ptrdiff_t>(corners));
+            _vertex_start.assign(vertex_count + 1, 0);
+            _vertex_corners.resize(corners);
+            _contribution.resize(corners);
+
+            parallel_for(corners, 16384, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t c = begin; c < end; ++c)
+                    if (_indices[c] < vertex_count)
+                        std::atomic_ref(_vertex_start[_indices[c] + 1]).fetch_add(1, std::memory_order_relaxed);
+            });
+            for (std::size_t v = 0; v < vertex_count; ++v)
+                _vertex_start[v + 1] += _vertex_start[v];
+
+            std::vector<std::uint32_t> cursor(_vertex_start.begin(), _vertex_start.end() - 1);
+            parallel_for(corners, 16384, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t c = begin; c < end; ++c)
+                    if (_indices[c] < vertex_count)
+                    {
+                        const std::uint32_t slot = std::atomic_ref(cursor[_indices[c]]).fetch_add(1, std::memory_order_relaxed);
+                        _vertex_corners[slot] = static_cast<std::uint32_t>(c);
+                    }
+            });
+            _vertex_corners.resize(_vertex_start[vertex_count]);
+
+            // Fix the per-vertex order so sums are reproducible
+            parallel_for(vertex_count, 16384, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t v = begin; v < end; ++v)
+                    std::sort(_vertex_corners.begin() + _vertex_start[v], _vertex_corners.begin() + _vertex_start[v + 1]);
+            });
+        }
+
+        [[nodiscard]] std::size_t vertex_count() const
+        {
+            return _vertex_start.empty() ? 0 : _vertex_start.size() - 1;
+        }
+
+        [[nodiscard]] std::size_t triangle_count() const
+        {
+            return _indices.size() / 3;
+        }
+
+        // Writes a unit normal for every vertex. Vertices not used by any non-degenerate triangle get a zero normal.
+        // Returns false without writing anything if the topology has an index outside its vertex count
+        // or positions holds fewer than vertex_count() entries.
+        bool compute_normals(const std::span<const Vector3> positions, const std::span<Vector3> normals,
+                             const NormalWeighting weighting = NormalWeighting::area)
+        {
+            const std::size_t vertices = std::min({vertex_count(), positions.size(), normals.size()});
+            if (!indices_valid(positions.size())) return false;
+
+            parallel_for(triangle_count(), 8192, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t t = begin; t < end; ++t)
+                {
+                    const Vector3& p0 = positions[_indices[3 * t]];
+                    const Vector3& p1 = positions[_indices[3 * t + 1]];
+                    const Vector3& p2 = positions[_indices[3 * t + 2]];
+                    const Vector3 e01 = p1 - p0, e12 = p2 - p1, e20 = p0 - p2;
+                    const Vector3 face = e01 % (p2 - p0);
+
+                    if (weighting == NormalWeighting::area)
+                    {
+                        _contribution[3 * t] = _contribution[3 * t + 1] = _contribution[3 * t + 2] = face;
+                        continue;
+                    }
+                    const Vector3 unit = detail::unit_or_zero(face);
+                    _contribution[3 * t] = unit * detail::corner_angle(e01, e20 * -1);
+                    _contribution[3 * t + 1] = unit * detail::corner_angle(e12, e01 * -1);
+                    _contribution[3 * t + 2] = unit * detail::corner_angle(e20, e12 * -1);
+                }
+            });
+
+            parallel_for(vertices, 8192, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t v = begin; v < end; ++v)
+                {
+                    Vector3 sum;
+                    for (std::uint32_t k = _vertex_start[v]; k < _vertex_start[v + 1]; ++k)
+                        sum += _contribution[_vertex_corners[k]];
+                    normals[v] = detail::unit_or_zero(sum);
+                }
+            });
+            return true;
+        }
+
+        // Writes MikkTSpace-style tangents: xyz is the unit tangent along increasing u, made
+        // orthogonal to the vertex normal, and w = +-1 is the bitangent sign, so that
+        // bitangent = w * (normal % tangent). Each face's tangent frame is projected onto the
+        // vertex's tangent plane and weighted by the corner angle, as MikkTSpace does. Vertices
+        // are not split, so UV seams and mirrored islands must already use separate vertices.
+        // Returns false without writing anything under the same conditions as compute_normals(),
+        // checked against the shortest of positions, normals and uvs.
+        bool compute_tangents(const std::span<const Vector3> positions, const std::span<const Vector3> normals,
+                              const std::span<const TexCoord> uvs, const std::span<Vector4> tangents)
+        {
+            const std::size_t vertices = std::min({vertex_count(), positions.size(), normals.size(), uvs.size(), tangents.size()});
+            if (!indices_valid(std::min({positions.size(), normals.size(), uvs.size()}))) return false;
+
+            _bitangent_contribution.resize(_contribution.size());
+            parallel_for(triangle_count(), 8192, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t t = begin; t < end; ++t)
+                {
+                    const std::uint32_t i[3] = {_indices[3 * t], _indices[3 * t + 1], _indices[3 * t + 2]};
+                    const Vector3 e1 = positions[i[1]] - positions[i[0]];
+                    const Vector3 e2 = positions[i[2]] - positions[i[0]];
+                    const real du1 = uvs[i[1]].u - uvs[i[0]].u, dv1 = uvs[i[1]].v - uvs[i[0]].v;
+                    const real du2 = uvs[i[2]].u - uvs[i[0]].u, dv2 = uvs[i[2]].v - uvs[i[0]].v;
+
+                    // Orientation-preserving solve; the determinant's sign only affects handedness
+                    const real det = du1 * dv2 - du2 * dv1;
+                    const real sign = det < 0 ? static_cast<real>(-1) : static_cast<real>(1);
+                    const Vector3 face_tangent = (e1 * dv2 - e2 * dv1) * sign;
+                    const Vector3 face_bitangent = (e2 * du1 - e1 * du2) * sign;
+                    const bool degenerate = det == 0;
+
+                    for (int corner = 0; corner < 3; ++corner)
+                    {
+                        const std::size_t c = 3 * t + corner;
+                        if (degenerate)
+                        {
+                            _contribution[c] = Vector3();
+                            _bitangent_contribution[c] = Vector3();
+                            continue;
+                        }
+                        const Vector3& n = normals[i[corner]];
+                        const Vector3& p = positions[i[corner]];
+                        const real angle = detail::corner_angle(positions[i[(corner + 1) % 3]] - p, positions[i[(corner + 2) % 3]] - p);
+                        const Vector3 tangent = detail::unit_or_zero(face_tangent - n * (n * face_tangent));
+                        const Vector3 bitangent = detail::unit_or_zero(face_bitangent - n * (n * face_bitangent));
+                        _contribution[c] = tangent * angle;
+                        _bitangent_contribution[c] = bitangent * angle;
+                    }
+                }
+            });
+
+            parallel_for(vertices, 8192, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t v = begin; v < end; ++v)
+                {
+                    Vector3 tangent, bitangent;
+                    for (std::uint32_t k = _vertex_start[v]; k < _vertex_start[v + 1]; ++k)
+                    {
+                        tangent += _contribution[_vertex_corners[k]];
+                        bitangent += _bitangent_contribution[_vertex_corners[k]];
+                    }
+
+                    const Vector3& n = normals[v];
+                    tangent = detail::unit_or_zero(tangent - n * (n * tangent));
+                    if (tangent.magnitude_squared() == 0)
+                    {
+                        // No usable UV gradient: any unit vector in the tangent plane
+                        const Vector3 axis = std::abs(n.x) < static_cast<real>(0.9) ? Vector3(1, 0, 0) : Vector3(0, 1, 0);
+                        tangent = detail::unit_or_zero(axis - n * (n * axis));
+                    }
+                    const real handedness = ((n % tangent) * bitangent) < 0 ? static_cast<real>(-1) : static_cast<real>(1);
+                    tangents[v] = Vector4(tangent.x, tangent.y, tangent.z, handedness);
+                }
+            });
+            return true;
+        }
+
+    private:
+        std::vector<std::uint32_t> _indices;
+        std::vector<std::uint32_t> _vertex_start;   // Vertex v owns corners [_vertex_start[v], _vertex_start[v + 1])
+        std::vector<std::uint32_t> _vertex_corners; // Corner indices grouped by vertex
+        std::vector<Vector3> _contribution;         // One value per triangle corner
+        std::vector<Vector3> _bitangent_contribution;
+
+        [[nodiscard]] bool indices_valid(const std::size_t vertex_limit) const
+        {
+            return vertex_count() <= vertex_limit && _vertex_corners.size() == _indices.size();
+        }
+    };
+
+    // One-shot helpers for meshes whose topology is not reused; they return false on an index
+    // outside positions, as the MeshNormals members do.
+    inline bool compute_normals(const std::span<const Vector3> positions, const std::span<const std::uint32_t> indices,
+                                const std::span<Vector3> normals, const NormalWeighting weighting = NormalWeighting::area)
+    {
+        MeshNormals mesh(indices, positions.size());
+        return mesh.compute_normals(positions, normals, weighting);
+    }
+
+    inline bool compute_tangents(const std::span<const Vector3> positions, const std::span<const Vector3> normals,
+                                 const std::span<const TexCoord> uvs, const std::span<const std::uint32_t> indices,
+                                 const std::span<Vector4> tangents)
+    {
+        MeshNormals mesh(indices, positions.size());
+        return mesh.compute_tangents(positions, normals, uvs, tangents);
+    }
+}
+
+#endif //LINKIT_MESH_NORMALS_H
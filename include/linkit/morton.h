@@ -0,0 +1,261 @@
+#ifndef LINKIT_MORTON_H
+#define LINKIT_MORTON_H
+#include "precision.h"
+#include "vector3.h"
+#include "aabb.h"
+#include "parallel.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace linkit
+{
+    // Spreads the low 10 bits of v so that there are two zero bits between each of them.
+    inline std::uint32_t morton_spread10(std::uint32_t v)
+    {
+        v &= 0x000003ffu;
+        v = (v | (v << 16)) & 0x030000ffu;
+        v = (v | (v << 8)) & 0x0300f00fu;
+        v = (v | (v << 4)) & 0x030c30c3u;
+        v = (v | (v << 2)) & 0x09249249u;
+        return v;
+    }
+
+    // Spreads the low 21 bits of v so that there are two zero bits between each of them.
+    inline std::uint64_t morton_spread21(std::uint64_t v)
+    {
+        v &= 0x1fffffull;
+        v = (v | (v << 32)) & 0x001f00000000ffffull;
+        v = (v | (v << 16)) & 0x001f0000ff0000ffull;
+        v = (v | (v << 8)) & 0x100f00f00f00f00full;
+        v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+        v = (v | (v << 2)) & 0x1249249249249249ull;
+        return v;
+    }
+
+    // Gathers every third bit of v, starting at bit 0, into the low 21 bits; inverts morton_spread21().
+    inline std::uint64_t morton_compact21(std::uint64_t v)
+    {
+        v &= 0x1249249249249249ull;
+        v = (v | (v >> 2)) & 0x10c30c30c30c30c3ull;
+        v = (v | (v >> 4)) & 0x100f00f00f00f00full;
+        v = (v | (v >> 8)) & 0x001f0000ff0000ffull;
+        v = (v | (v >> 16)) & 0x001f00000000ffffull;
+        v = (v | (v >> 32)) & 0x1fffffull;
+        return v;
+    }
+
+    // 30-bit Morton code from three 10-bit cell coordinates.
+    inline std::uint32_t morton_encode30(const std::uint32_t x, const std::uint32_t y, const std::uint32_t z)
+    {
+        return morton_spread10(x) | (morton_spread10(y) << 1) | (morton_spread10(z) << 2);
+    }
+
+    // 63-bit Morton code from three 21-bit cell coordinates.
+    inline std::uint64_t morton_encode63(const std::uint64_t x, const std::uint64_t y, const std::uint64_t z)
+    {
+        return morton_spread21(x) | (morton_spread21(y) << 1) | (morton_spread21(z) << 2);
+    }
+
+    // Cell coordinates of a 63-bit Morton code.
+    inline void morton_decode63(const std::uint64_t code, std::uint64_t& x, std::uint64_t& y, std::uint64_t& z)
+    {
+        x = morton_compact21(code);
+        y = morton_compact21(code >> 1);
+        z = morton_compact21(code >> 2);
+    }
+
+    // Morton codes of positions quantized inside bounds. Key is std::uint32_t for 30-bit codes or
+    // std::uint64_t for 63-bit codes. The loop is branch-free shifts and masks over a block of
+    // positions so the compiler can vectorize the bit interleaving.
+    template <typename Key>
+    void morton_codes(const std::span<const Vector3> positions, const AABB& bounds, const std::span<Key> out)
+    {
+        static_assert(std::is_same_v<Key, std::uint32_t> || std::is_same_v<Key, std::uint64_t>,
+                      "Morton keys are 30-bit (uint32_t) or 63-bit (uint64_t)");
+        constexpr int bits = std::is_same_v<Key, std::uint32_t> ? 10 : 21;
+        constexpr real max_cell = static_cast<real>((1u << bits) - 1);
+
+        const Vector3 extent = bounds.max - bounds.min;
+        const real sx = extent.x > 0 ? max_cell / extent.x : 0;
+        const real sy = extent.y > 0 ? max_cell / extent.y : 0;
+        const real sz = extent.z > 0 ? max_cell / extent.z : 0;
+        const real ox = bounds.min.x, oy = bounds.min.y, oz = bounds.min.z;
+
+        const std::size_t count = std::min(positions.size(), out.size());
+        parallel_for(count, 16384, [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const auto x = static_cast<Key>(std::clamp((positions[i].x - ox) * sx, static_cast<real>(0), max_cell));
+                const auto y = static_cast<Key>(std::clamp((positions[i].y - oy) * sy, static_cast<real>(0), max_cell));
+                const auto z = static_cast<Key>(std::clamp((positions[i].z - oz) * sz, static_cast<real>(0), max_cell));
+                if constexpr (bits == 10)
+                    out[i] = morton_encode30(x, y, z);
+                else
+                    out[i] = morton_encode63(x, y, z);
+            }
+        });
+    }
+
+    // Parallel least-significant-digit radix sort over 8-bit digits. Produces the permutation
+    // that sorts the keys (stable), keeping its buffers between calls so sorting every frame does
+    // not allocate. Passes where every key shares the same digit are skipped, so 30-bit codes
+    // cost at most four passes.
+    template <typename Key>
+    class RadixSorter
+    {
+    public:
+        // Returns permutation p with keys[p[0]] <= keys[p[1]] <= ...
+        std::span<const std::uint32_t> sort(const std::span<const Key> keys)
+        {
+            const std::size_t n = keys.size();
+            _keys.assign(keys.begin(), keys.end());
+            _keys_tmp.resize(n);
+            _index.resize(n);
+            _index_tmp.resize(n);
+            for (std::size_t i = 0; i < n; ++i)
+                _index[i] = static_cast<std::uint32_t>(i);
+            if (n < 2) return _index;
+
+            const std::size_t chunks = parallel_chunk_count(n, 65536);
+            _histograms.resize(chunks);
+
+            for (int shift = 0; shift < static_cast<int>(sizeof(Key) * 8); shift += 8)
+            {
+                parallel_for_chunks(n, chunks, [&](const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+                    auto& histogram = _histograms[chunk];
+                    histogram.fill(0);
+                    for (std::size_t i = begin; i < end; ++i)
+                        ++histogram[(_keys[i] >> shift) & 0xff];
+                });
+
+                // Exclusive prefix over (digit, chunk) keeps the sort stable across chunks
+                std::uint32_t running = 0;
+                bool trivial = false;
+                for (int digit = 0; digit < 256; ++digit)
+                {
+                    std::uint32_t digit_total = 0;
+                    for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+                    {
+                        const std::uint32_t c = _histograms[chunk][digit];
+                        _histograms[chunk][digit] = running;
+                        running += c;
+                        digit_total += c;
+                    }
+                    if (digit_total == n) trivial = true;
+                }
+                if (trivial) continue;
+
+                parallel_for_chunks(n, chunks, [&](const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+                    auto& offsets = _histograms[chunk];
+                    for (std::size_t i = begin; i < end; ++i)
+                    {
+                        const std::uint32_t slot = offsets[(_keys[i] >> shift) & 0xff]++;
+                        _keys_tmp[slot] = _keys[i];
+                        _index_tmp[slot] = _index[i];
+                    }
+                });
+                _keys.swap(_keys_tmp);
+                _index.swap(_index_tmp);
+            }
+            return _index;
+        }
+
+        [[nodiscard]] std::span<const std::uint32_t> permutation() const
+        {
+            return _index;
+        }
+
+        [[nodiscard]] std::span<const Key> sorted_keys() const
+        {
+            return _keys;
+        }
+
+    private:
+        std::vector<Key> _keys, _keys_tmp;
+        std::vector<std::uint32_t> _index, _index_tmp;
+        std::vector<std::array<std::uint32_t, 256>> _histograms;
+    };
+
+    // Gathers data into permutation order (data[i] = old data[permutation[i]]) through scratch.
+    // Returns false, leaving data unchanged, if data holds fewer than permutation.size() entries.
+    template <typename T>
+    [[nodiscard]] bool reorder(const std::span<T> data, const std::span<const std::uint32_t> permutation, std::vector<T>& scratch)
+    {
+        if (data.size() < permutation.size()) return false;
+        scratch.resize(permutation.size());
+        parallel_for(permutation.size(), 16384, [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                scratch[i] = data[permutation[i]];
+        });
+        std::copy(scratch.begin(), scratch.end(), data.begin());
+        return true;
+    }
+
+    // Reorders any number of arrays of trivially copyable elements by the same permutation,
+    // sharing one caller-owned byte buffer as scratch. Returns false, reordering none of them,
+    // if any array is shorter than the permutation.
+    template <typename... T>
+    [[nodiscard]] bool reorder_all(const std::span<const std::uint32_t> permutation, std::vector<std::byte>& scratch, const std::span<T>... arrays)
+    {
+        static_assert((std::is_trivially_copyable_v<T> && ...), "reorder_all copies elements bytewise");
+        if (((arrays.size() < permutation.size()) || ...)) return false;
+        const auto reorder_bytes = [&]<typename U>(const std::span<U> data) {
+            scratch.resize(permutation.size() * sizeof(U));
+            std::byte* const out = scratch.data();
+            parallel_for(permutation.size(), 16384, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                    std::memcpy(out + i * sizeof(U), &data[permutation[i]], sizeof(U));
+            });
+            std::memcpy(data.data(), out, permutation.size() * sizeof(U));
+        };
+        (reorder_bytes(arrays), ...);
+        return true;
+    }
+
+    // Sorts a position array (and any companion arrays) into Morton order. Keeping one instance
+    // alive between frames reuses its code, sort and scratch buffers. Companions must hold at
+    // least positions.size() trivially copyable entries; if one is shorter, reorder() returns
+    // false and leaves every array unchanged.
+    template <typename Key = std::uint32_t>
+    class MortonOrder
+    {
+    public:
+        template <typename... Companions>
+        [[nodiscard]] bool reorder(const std::span<Vector3> positions, const std::span<Companions>... companions)
+        {
+            if (((companions.size() < positions.size()) || ...)) return false;
+            AABB bounds = AABB::empty();
+            for (const Vector3& p : positions)
+                bounds.expand(p);
+
+            _codes.resize(positions.size());
+            morton_codes<Key>(positions, bounds, _codes);
+            const std::span<const std::uint32_t> permutation = _sorter.sort(_codes);
+            return reorder_all(permutation, _scratch, positions, companions...);
+        }
+
+        // Slot i of the reordered arrays held element permutation()[i] before the last reorder().
+        [[nodiscard]] std::span<const std::uint32_t> permutation() const
+        {
+            return _sorter.permutation();
+        }
+
+        [[nodiscard]] std::span<const Key> sorted_codes() const
+        {
+            return _sorter.sorted_keys();
+        }
+
+    private:
+        std::vector<Key> _codes;
+        RadixSorter<Key> _sorter;
+        std::vector<std::byte> _scratch;
+    };
+}
+
+#endif //LINKIT_MORTON_H
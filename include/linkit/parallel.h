@@ -0,0 +1,110 @@
+#ifndef LINKIT_PARALLEL_H
+#define LINKIT_PARALLEL_H
+#include "job_system.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace linkit
+{
+    // Threads available to the batch kernels: the workers of default_job_system() plus the caller.
+    inline std::size_t hardware_threads()
+    {
+        return default_job_system().worker_count() + 1;
+    }
+
+    // Number of chunks parallel_for_chunks() should split count items into so that no chunk is smaller than min_chunk.
+    inline std::size_t parallel_chunk_count(const std::size_t count, const std::size_t min_chunk)
+    {
+        const std::size_t by_size = (count + std::max<std::size_t>(min_chunk, 1) - 1) / std::max<std::size_t>(min_chunk, 1);
+        return std::max<std::size_t>(std::min(hardware_threads(), by_size), 1);
+    }
+
+    // Runs fn(chunk, begin, end) for each of `chunks` contiguous slices of [0, count) on the
+    // default job system and waits for all of them. The calling thread takes the first slice.
+    // Useful when each chunk owns a partial result buffer.
+    template <typename Fn>
+    void parallel_for_chunks(const std::size_t count, const std::size_t chunks, Fn&& fn)
+    {
+        if (count == 0) return;
+        if (chunks <= 1)
+        {
+            fn(std::size_t{0}, std::size_t{0}, count);
+            return;
+        }
+
+        JobSystem& jobs = default_job_system();
+        const std::size_t step = (count + chunks - 1) / chunks;
+        std::vector<JobHandle> pending;
+        pending.reserve(chunks - 1);
+        for (std::size_t chunk = 1; chunk < chunks; ++chunk)
+        {
+            const std::size_t begin = std::min(chunk * step, count);
+            const std::size_t end = std::min(begin + step, count);
+            if (begin == end) break;
+            pending.push_back(jobs.schedule([&fn, chunk, begin, end] { fn(chunk, begin, end); }));
+        }
+        fn(std::size_t{0}, std::size_t{0}, std::min(step, count));
+        for (const JobHandle& job : pending)
+            jobs.wait(job);
+    }
+
+    // Runs fn(begin, end) over slices of [0, count) on the default job system and waits. Slices
+    // are split adaptively, never below min_chunk items.
+    template <typename Fn>
+    void parallel_for(const std::size_t count, const std::size_t min_chunk, Fn&& fn)
+    {
+        if (count == 0) return;
+        if (hardware_threads() == 1 || count <= min_chunk)
+        {
+            fn(std::size_t{0}, count);
+            return;
+        }
+
+        JobSystem& jobs = default_job_system();
+        jobs.wait(jobs.parallel_for(count, min_chunk, [&fn](const std::size_t begin, const std::size_t end) { fn(begin, end); }));
+    }
+
+    // Runs count queries with a variable number of results each on the default job system and
+    // packs the results so those of item q are results[offsets[q], offsets[q + 1]). fn(i, out)
+    // runs the i-th query, appends its results to out and returns the item q it belongs to,
+    // which lets callers visit the items in any order (e.g. sorted for locality). Each chunk
+    // collects into its own buffer; the buffers are copied into place once the offsets are known.
+    template <typename Result, typename Fn>
+    void parallel_collect(const std::size_t count, const std::size_t min_chunk, std::vector<std::uint32_t>& offsets,
+                          std::vector<Result>& results, Fn&& fn)
+    {
+        struct Segment
+        {
+            std::uint32_t item, begin;
+        };
+
+        offsets.assign(count + 1, 0);
+        const std::size_t chunks = parallel_chunk_count(count, min_chunk);
+        std::vector<std::vector<Result>> partial(chunks);
+        std::vector<std::vector<Segment>> segments(chunks);
+        parallel_for_chunks(count, chunks, [&](const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const auto before = static_cast<std::uint32_t>(partial[chunk].size());
+                const auto item = static_cast<std::uint32_t>(fn(i, partial[chunk]));
+                segments[chunk].push_back({item, before});
+                offsets[item + 1] = static_cast<std::uint32_t>(partial[chunk].size()) - before;
+            }
+        });
+        for (std::size_t q = 0; q < count; ++q)
+            offsets[q + 1] += offsets[q];
+
+        results.resize(offsets[count]);
+        parallel_for_chunks(count, chunks, [&](const std::size_t chunk, std::size_t, std::size_t) {
+            for (const Segment& segment : segments[chunk])
+            {
+                const std::uint32_t length = offsets[segment.item + 1] - offsets[segment.item];
+                std::copy_n(partial[chunk].begin() + segment.begin, length, results.begin() + offsets[segment.item]);
+            }
+        });
+    }
+}
+
+#endif //LINKIT_PARALLEL_H
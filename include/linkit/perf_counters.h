@@ -0,0 +1,221 @@
+#ifndef LINKIT_PERF_COUNTERS_H
+#define LINKIT_PERF_COUNTERS_H
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#define LINKIT_HAS_PERF_EVENT 1
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#define LINKIT_HAS_PERF_EVENT 0
+#endif
+
+namespace linkit
+{
+    enum class PerfEvent : std::uint8_t
+    {
+        cycles,
+        instructions,
+        l1d_misses,
+        llc_misses,
+        branch_misses
+    };
+
+    constexpr std::size_t perf_event_count = 5;
+
+    // Counter totals of one measurement, normalized per element. A counter the kernel or the
+    // hardware does not provide is reported as unavailable rather than zero.
+    struct PerfReport
+    {
+        std::size_t elements = 0;
+        double seconds = 0;
+        std::array<double, perf_event_count> per_element{};
+        std::array<bool, perf_event_count> available{};
+
+        [[nodiscard]] double nanoseconds_per_element() const
+        {
+            return elements > 0 ? seconds * 1e9 / static_cast<double>(elements) : 0;
+        }
+
+        [[nodiscard]] bool has(const PerfEvent event) const
+        {
+            return available[static_cast<std::size_t>(event)];
+        }
+
+        [[nodiscard]] double operator[](const PerfEvent event) const
+        {
+            return per_element[static_cast<std::size_t>(event)];
+        }
+
+        // Instructions per cycle, or 0 if either counter is missing.
+        [[nodiscard]] double ipc() const
+        {
+            const double cycles = (*this)[PerfEvent::cycles];
+            return has(PerfEvent::cycles) && has(PerfEvent::instructions) && cycles > 0 ? (*this)[PerfEvent::instructions] / cycles : 0;
+        }
+
+        [[nodiscard]] std::string to_string() const
+        {
+            char buffer[256];
+            int length = std::snprintf(buffer, sizeof(buffer), "%.3f ns/elem", nanoseconds_per_element());
+            const auto field = [&](const PerfEvent event, const char* name) {
+                if (has(event) && length < static_cast<int>(sizeof(buffer)))
+                    length += std::snprintf(buffer + length, sizeof(buffer) - length, "  %s %.3f", name, (*this)[event]);
+            };
+            field(PerfEvent::cycles, "cycles");
+            field(PerfEvent::instructions, "instr");
+            if (ipc() > 0 && length < static_cast<int>(sizeof(buffer)))
+                length += std::snprintf(buffer + length, sizeof(buffer) - length, "  ipc %.2f", ipc());
+            field(PerfEvent::l1d_misses, "l1d-miss");
+            field(PerfEvent::llc_misses, "llc-miss");
+            field(PerfEvent::branch_misses, "br-miss");
+            return std::string(buffer);
+        }
+    };
+
+    // Hardware counters for the calling thread through Linux perf_event_open. Each counter is
+    // opened on its own, user space only, so whatever subset the CPU, the hypervisor and
+    // kernel.perf_event_paranoid allow is still reported; elsewhere, or when nothing can be
+    // opened, only wall time is measured. Counters follow the calling thread only: work that
+    // parallel_for() hands to job system workers is not counted, so profile batches no larger
+    // than the kernel's inline chunk size or the figures only cover the caller's share.
+    class PerfCounters
+    {
+    public:
+        // With enable set to false only wall time is measured.
+        explicit PerfCounters(const bool enable = true)
+        {
+            _fds.fill(-1);
+#if LINKIT_HAS_PERF_EVENT
+            if (!enable) return;
+            const auto cache_event = [](const std::uint64_t cache, const std::uint64_t op, const std::uint64_t result) {
+                return cache | (op << 8) | (result << 16);
+            };
+            const std::array<std::pair<std::uint32_t, std::uint64_t>, perf_event_count> configs = {{
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            }};
+            for (std::size_t i = 0; i < perf_event_count; ++i)
+            {
+                perf_event_attr attr{};
+                attr.size = sizeof(attr);
+                attr.type = configs[i].first;
+                attr.config = configs[i].second;
+                attr.disabled = 1;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                _fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            }
+#else
+            (void)enable;
+#endif
+        }
+
+        ~PerfCounters()
+        {
+#if LINKIT_HAS_PERF_EVENT
+            for (const int fd : _fds)
+                if (fd >= 0) close(fd);
+#endif
+        }
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        // True if at least one hardware counter could be opened.
+        [[nodiscard]] bool available() const
+        {
+            for (const int fd : _fds)
+                if (fd >= 0) return true;
+            return false;
+        }
+
+        [[nodiscard]] bool available(const PerfEvent event) const
+        {
+            return _fds[static_cast<std::size_t>(event)] >= 0;
+        }
+
+        void start()
+        {
+#if LINKIT_HAS_PERF_EVENT
+            for (const int fd : _fds)
+            {
+                if (fd < 0) continue;
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+            _start = std::chrono::steady_clock::now();
+        }
+
+        void stop()
+        {
+            const auto end = std::chrono::steady_clock::now();
+#if LINKIT_HAS_PERF_EVENT
+            for (const int fd : _fds)
+                if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+            _seconds = std::chrono::duration<double>(end - _start).count();
+            _valid.fill(false);
+#if LINKIT_HAS_PERF_EVENT
+            for (std::size_t i = 0; i < perf_event_count; ++i)
+            {
+                if (_fds[i] < 0) continue;
+                // value, time enabled, time running; scale up if the counter was multiplexed
+                std::uint64_t data[3] = {};
+                if (read(_fds[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0) continue;
+                _values[i] = static_cast<double>(data[0]) * (static_cast<double>(data[1]) / static_cast<double>(data[2]));
+                _valid[i] = true;
+            }
+#endif
+        }
+
+        // The last start()/stop() interval divided over elements.
+        [[nodiscard]] PerfReport report(const std::size_t elements) const
+        {
+            PerfReport result;
+            result.elements = elements;
+            result.seconds = _seconds;
+            const double scale = elements > 0 ? 1.0 / static_cast<double>(elements) : 0;
+            for (std::size_t i = 0; i < perf_event_count; ++i)
+            {
+                result.available[i] = _valid[i];
+                result.per_element[i] = _valid[i] ? _values[i] * scale : 0;
+            }
+            return result;
+        }
+
+    private:
+        std::array<int, perf_event_count> _fds{};
+        std::array<double, perf_event_count> _values{};
+        std::array<bool, perf_event_count> _valid{};
+        std::chrono::steady_clock::time_point _start{};
+        double _seconds = 0;
+    };
+
+    // Runs kernel() once to warm caches, then `repetitions` more times under the counters, and
+    // reports per element with elements counted per repetition.
+    template <typename Kernel>
+    PerfReport profile(PerfCounters& counters, const std::size_t elements, Kernel&& kernel, const std::size_t repetitions = 1)
+    {
+        kernel();
+        counters.start();
+        for (std::size_t i = 0; i < repetitions; ++i)
+            kernel();
+        counters.stop();
+        return counters.report(elements * repetitions);
+    }
+}
+
+#endif //LINKIT_PERF_COUNTERS_H
@@ -0,0 +1,387 @@
+#ifndef LINKIT_POINT_FILTERS_H
+#define LINKIT_POINT_FILTERS_H
+#include "precision.h"
+#include "vector3.h"
+#include "parallel.h"
+#include "morton.h"
+#include "kdtree.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define LINKIT_FILTERS_SSE2 1
+#endif
+
+namespace linkit
+{
+#if defined(LINKIT_FILTERS_SSE2)
+    namespace detail
+    {
+        // Loads are templates so they are only instantiated when real is double.
+        template <typename T>
+        __m128d load_xy(const T* x)
+        {
+            return _mm_loadu_pd(x);
+        }
+
+        template <typename T>
+        __m128d load_z_pair(const T* lo, const T* hi)
+        {
+            return _mm_loadh_pd(_mm_load_sd(lo), hi);
+        }
+    }
+#endif
+
+    // Voxel-grid downsampling that replaces all points falling in one cubic voxel by their
+    // centroid. Points are fed in chunks of any size through add(), so the working memory is one
+    // chunk's keys plus one accumulator per occupied voxel, independent of the input length.
+    //
+    // Each chunk is quantized to voxel coordinates packed as 63-bit Morton keys and radix sorted;
+    // runs of equal keys are then summed in parallel slices, four points at a time into
+    // independent accumulators (x and y packed in one SSE2 register when real is double), and
+    // only the per-run sums are merged into an open-addressing table of voxels. Sums are taken relative to the voxel's corner, so centroids far from
+    // origin keep the precision of the offsets within a voxel. Voxel coordinates are kept in 21
+    // bits per axis around origin, i.e. +-2^20 voxels; points beyond that are clamped into the
+    // outermost voxels. Points with a NaN or infinite coordinate are skipped.
+    class VoxelGridFilter
+    {
+    public:
+        explicit VoxelGridFilter(const real voxel_size, const Vector3& origin = Vector3())
+            : _size(voxel_size), _inv_size(static_cast<real>(1.0) / voxel_size), _origin(origin)
+        {
+            _table.assign(1024, Cell{});
+        }
+
+        void add(const std::span<const Vector3> points)
+        {
+            const std::size_t n = points.size();
+            if (n == 0) return;
+
+            _keys.resize(n);
+            parallel_for(n, 16384, [&](const std::size_t begin, const std::size_t end) {
+                constexpr real bias = static_cast<real>(1 << 20);
+                constexpr real top = static_cast<real>((1 << 21) - 1);
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const Vector3& p = points[i];
+                    if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z))
+                    {
+                        _keys[i] = skipped;
+                        continue;
+                    }
+                    const Vector3 local = (p - _origin) * _inv_size;
+                    const auto cell = [&](const real v) {
+                        return static_cast<std::uint64_t>(std::clamp(std::floor(v) + bias, static_cast<real>(0), top));
+                    };
+                    _keys[i] = morton_encode63(cell(local.x), cell(local.y), cell(local.z));
+                }
+            });
+            const std::span<const std::uint32_t> order = _sorter.sort(_keys);
+            const std::span<const std::uint64_t> sorted = _sorter.sorted_keys();
+
+            // Slice boundaries moved forward to the next run start so no run spans two slices
+            const std::size_t chunks = parallel_chunk_count(n, 16384);
+            _runs.resize(chunks);
+            parallel_for_chunks(n, chunks, [&](const std::size_t chunk, std::size_t begin, std::size_t end) {
+                while (begin > 0 && begin < n && sorted[begin] == sorted[begin - 1]) ++begin;
+                while (end < n && sorted[end] == sorted[end - 1]) ++end;
+                std::vector<Cell>& runs = _runs[chunk];
+                runs.clear();
+                for (std::size_t i = begin; i < end;)
+                {
+                    // Skipped points sort last, so their run ends the chunk
+                    if (sorted[i] == skipped) break;
+                    std::size_t j = i + 1;
+                    while (j < end && sorted[j] == sorted[i]) ++j;
+                    runs.push_back(sum_run(points, order.subspan(i, j - i), sorted[i], corner(sorted[i])));
+                    i = j;
+                }
+            });
+            for (const std::vector<Cell>& runs : _runs)
+                for (const Cell& run : runs)
+                    merge(run);
+        }
+
+        // Number of occupied voxels so far.
+        [[nodiscard]] std::size_t voxel_count() const
+        {
+            return _occupied;
+        }
+
+        // Appends one centroid per occupied voxel, in Morton order of the voxels, which keeps
+        // neighbouring output points close in memory. The accumulated state is kept, so more
+        // chunks may still be added and the result taken again.
+        void centroids(std::vector<Vector3>& out) const
+        {
+            std::vector<const Cell*> cells;
+            cells.reserve(_occupied);
+            for (const Cell& cell : _table)
+                if (cell.count > 0) cells.push_back(&cell);
+            std::sort(cells.begin(), cells.end(), [](const Cell* a, const Cell* b) { return a->key < b->key; });
+            const std::size_t first = out.size();
+            out.resize(first + cells.size());
+            parallel_for(cells.size(), 16384, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const Cell& cell = *cells[i];
+                    out[first + i] = corner(cell.key) + Vector3(cell.sum[0], cell.sum[1], cell.sum[2]) * (static_cast<real>(1.0) / static_cast<real>(cell.count));
+                }
+            });
+        }
+
+        void clear()
+        {
+            _table.assign(1024, Cell{});
+            _occupied = 0;
+        }
+
+    private:
+        // Key of a non-finite point; above every 63-bit Morton key
+        static constexpr std::uint64_t skipped = ~std::uint64_t{0};
+
+        struct Cell
+        {
+            std::uint64_t key = 0;
+            std::uint64_t count = 0; // 0 marks an empty slot
+            real sum[3] = {};        // Relative to the voxel's corner
+        };
+
+        real _size;
+        real _inv_size;
+        Vector3 _origin;
+        std::vector<Cell> _table;
+        std::size_t _occupied = 0;
+        std::vector<std::uint64_t> _keys;
+        RadixSorter<std::uint64_t> _sorter;
+        std::vector<std::vector<Cell>> _runs;
+
+        // Minimum corner of the voxel a key stands for.
+        [[nodiscard]] Vector3 corner(const std::uint64_t key) const
+        {
+            constexpr real bias = static_cast<real>(1 << 20);
+            std::uint64_t x, y, z;
+            morton_decode63(key, x, y, z);
+            return _origin + Vector3(static_cast<real>(x) - bias, static_cast<real>(y) - bias, static_cast<real>(z) - bias) * _size;
+        }
+
+        static Cell sum_run(const std::span<const Vector3> points, const std::span<const std::uint32_t> run, const std::uint64_t key,
+                            const Vector3& corner)
+        {
+            Cell cell;
+            cell.key = key;
+            cell.count = run.size();
+#if defined(LINKIT_FILTERS_SSE2)
+            if constexpr (std::is_same_v<real, double>)
+            {
+                // Same lanes and order as the scalar loop below, so the sums are bit-identical:
+                // xy<l> holds lane l's x and y, z01 and z23 the z of lanes 0-1 and 2-3
+                const __m128d corner_xy = _mm_set_pd(corner.y, corner.x);
+                const __m128d corner_z = _mm_set1_pd(corner.z);
+                __m128d xy0 = _mm_setzero_pd(), xy1 = xy0, xy2 = xy0, xy3 = xy0, z01 = xy0, z23 = xy0;
+                std::size_t i = 0;
+                for (; i + 4 <= run.size(); i += 4)
+                {
+                    const Vector3& a = points[run[i]];
+                    const Vector3& b = points[run[i + 1]];
+                    const Vector3& c = points[run[i + 2]];
+                    const Vector3& d = points[run[i + 3]];
+                    xy0 = _mm_add_pd(xy0, _mm_sub_pd(detail::load_xy(&a.x), corner_xy));
+                    xy1 = _mm_add_pd(xy1, _mm_sub_pd(detail::load_xy(&b.x), corner_xy));
+                    xy2 = _mm_add_pd(xy2, _mm_sub_pd(detail::load_xy(&c.x), corner_xy));
+                    xy3 = _mm_add_pd(xy3, _mm_sub_pd(detail::load_xy(&d.x), corner_xy));
+                    z01 = _mm_add_pd(z01, _mm_sub_pd(detail::load_z_pair(&a.z, &b.z), corner_z));
+                    z23 = _mm_add_pd(z23, _mm_sub_pd(detail::load_z_pair(&c.z, &d.z), corner_z));
+                }
+                for (; i < run.size(); ++i)
+                {
+                    const Vector3& p = points[run[i]];
+                    xy0 = _mm_add_pd(xy0, _mm_sub_pd(detail::load_xy(&p.x), corner_xy));
+                    z01 = _mm_add_sd(z01, _mm_sub_sd(detail::load_z_pair(&p.z, &p.z), corner_z));
+                }
+                const __m128d xy = _mm_add_pd(_mm_add_pd(xy0, xy1), _mm_add_pd(xy2, xy3));
+                cell.sum[0] = _mm_cvtsd_f64(xy);
+                cell.sum[1] = _mm_cvtsd_f64(_mm_unpackhi_pd(xy, xy));
+                const __m128d z = _mm_add_pd(_mm_unpacklo_pd(z01, z23), _mm_unpackhi_pd(z01, z23));
+                cell.sum[2] = _mm_cvtsd_f64(_mm_add_sd(z, _mm_unpackhi_pd(z, z)));
+            }
+            else
+#endif
+            {
+                // Four interleaved accumulators per axis keep the additions independent
+                real x[4] = {}, y[4] = {}, z[4] = {};
+                std::size_t i = 0;
+                for (; i + 4 <= run.size(); i += 4)
+                    for (std::size_t l = 0; l < 4; ++l)
+                    {
+                        const Vector3& p = points[run[i + l]];
+                        x[l] += p.x - corner.x;
+                        y[l] += p.y - corner.y;
+                        z[l] += p.z - corner.z;
+                    }
+                for (; i < run.size(); ++i)
+                {
+                    const Vector3& p = points[run[i]];
+                    x[0] += p.x - corner.x;
+                    y[0] += p.y - corner.y;
+                    z[0] += p.z - corner.z;
+                }
+                cell.sum[0] = (x[0] + x[1]) + (x[2] + x[3]);
+                cell.sum[1] = (y[0] + y[1]) + (y[2] + y[3]);
+                cell.sum[2] = (z[0] + z[1]) + (z[2] + z[3]);
+            }
+            return cell;
+        }
+
+        static std::size_t slot_of(const std::uint64_t key, const std::size_t mask)
+        {
+            std::uint64_t h = key * 0x9e3779b97f4a7c15ull;
+            h ^= h >> 29;
+            return static_cast<std::size_t>(h) & mask;
+        }
+
+        void merge(const Cell& run)
+        {
+            if ((_occupied + 1) * 2 > _table.size()) grow();
+            const std::size_t mask = _table.size() - 1;
+            for (std::size_t slot = slot_of(run.key, mask);; slot = (slot + 1) & mask)
+            {
+                Cell& cell = _table[slot];
+                if (cell.count == 0)
+                {
+                    cell = run;
+                    ++_occupied;
+                    return;
+                }
+                if (cell.key == run.key)
+                {
+                    cell.count += run.count;
+                    for (int k = 0; k < 3; ++k) cell.sum[k] += run.sum[k];
+                    return;
+                }
+            }
+        }
+
+        void grow()
+        {
+            std::vector<Cell> old(_table.size() * 2);
+            old.swap(_table);
+            const std::size_t mask = _table.size() - 1;
+            for (const Cell& cell : old)
+            {
+                if (cell.count == 0) continue;
+                std::size_t slot = slot_of(cell.key, mask);
+                while (_table[slot].count != 0) slot = (slot + 1) & mask;
+                _table[slot] = cell;
+            }
+        }
+    };
+
+    // Downsamples points in one call; see VoxelGridFilter for the streaming form.
+    inline void voxel_downsample(const std::span<const Vector3> points, const real voxel_size, std::vector<Vector3>& out,
+                                 const std::size_t chunk_size = 1 << 20)
+    {
+        VoxelGridFilter filter(voxel_size);
+        for (std::size_t first = 0; first < points.size(); first += chunk_size)
+            filter.add(points.subspan(first, std::min(chunk_size, points.size() - first)));
+        filter.centroids(out);
+    }
+
+    struct OutlierFilterSettings
+    {
+        std::size_t neighbors = 16;  // k nearest neighbours averaged per point
+        real std_ratio = 1;          // Points farther than mean + std_ratio * sigma are removed
+        std::size_t chunk_size = 65536;
+    };
+
+    // Statistical outlier removal. Each point's mean distance to its k nearest neighbours is
+    // compared with the mean and standard deviation of that figure over the whole cloud; points
+    // more than std_ratio deviations above the mean are dropped. Neighbours come from a KdTree
+    // over the cloud, queried in chunks of chunk_size points (in Morton order within a chunk),
+    // so the neighbour buffers stay at k * chunk_size entries and only one real per point is
+    // kept between the passes. Writes the indices of the kept points in input order and returns
+    // how many there are.
+    inline std::size_t filter_statistical_outliers(const std::span<const Vector3> points, std::vector<std::uint32_t>& kept,
+                                                   const OutlierFilterSettings& settings = {})
+    {
+        const std::size_t n = points.size();
+        kept.clear();
+        if (n == 0) return 0;
+        const std::size_t k = std::min(settings.neighbors, n - 1);
+        if (k == 0)
+        {
+            kept.resize(n);
+            for (std::size_t i = 0; i < n; ++i) kept[i] = static_cast<std::uint32_t>(i);
+            return n;
+        }
+
+        const KdTree tree(points);
+        std::vector<real> mean_distance(n);
+        const std::size_t chunk_size = std::max<std::size_t>(settings.chunk_size, 1);
+        // k + 1 neighbours since every point finds itself
+        std::vector<KdNeighbor> neighbors((k + 1) * std::min(chunk_size, n));
+        std::vector<std::uint32_t> counts(std::min(chunk_size, n));
+        for (std::size_t first = 0; first < n; first += chunk_size)
+        {
+            const std::size_t count = std::min(chunk_size, n - first);
+            tree.knn(points.subspan(first, count), k + 1, neighbors, counts);
+            parallel_for(count, 4096, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t q = begin; q < end; ++q)
+                {
+                    const auto self = static_cast<std::uint32_t>(first + q);
+                    real sum = 0;
+                    std::size_t used = 0;
+                    for (std::uint32_t j = 0; j < counts[q] && used < k; ++j)
+                    {
+                        const KdNeighbor& neighbor = neighbors[q * (k + 1) + j];
+                        if (neighbor.index == self) continue;
+                        sum += real_sqrt(neighbor.distance_sq);
+                        ++used;
+                    }
+                    mean_distance[first + q] = used > 0 ? sum / static_cast<real>(used) : 0;
+                }
+            });
+        }
+
+        // Mean and deviation, summed per slice and combined in slice order for a stable result
+        const std::size_t chunks = parallel_chunk_count(n, 65536);
+        std::vector<real> partial(chunks);
+        parallel_for_chunks(n, chunks, [&](const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+            real sum = 0;
+            for (std::size_t i = begin; i < end; ++i) sum += mean_distance[i];
+            partial[chunk] = sum;
+        });
+        real total = 0;
+        for (const real s : partial) total += s;
+        const real mean = total / static_cast<real>(n);
+        parallel_for_chunks(n, chunks, [&](const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+            real sum = 0;
+            for (std::size_t i = begin; i < end; ++i) sum += (mean_distance[i] - mean) * (mean_distance[i] - mean);
+            partial[chunk] = sum;
+        });
+        total = 0;
+        for (const real s : partial) total += s;
+        const real threshold = mean + settings.std_ratio * real_sqrt(total / static_cast<real>(n));
+
+        kept.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+            if (mean_distance[i] <= threshold) kept.push_back(static_cast<std::uint32_t>(i));
+        return kept.size();
+    }
+
+    // Same, writing the kept points themselves.
+    inline std::size_t filter_statistical_outliers(const std::span<const Vector3> points, std::vector<Vector3>& kept,
+                                                   const OutlierFilterSettings& settings = {})
+    {
+        std::vector<std::uint32_t> indices;
+        filter_statistical_outliers(points, indices, settings);
+        kept.resize(indices.size());
+        for (std::size_t i = 0; i < indices.size(); ++i) kept[i] = points[indices[i]];
+        return kept.size();
+    }
+}
+
+#endif //LINKIT_POINT_FILTERS_H
@@ -0,0 +1,256 @@
+#ifndef LINKIT_POINT_RECORDS_H
+#define LINKIT_POINT_RECORDS_H
+#include "precision.h"
+#include "vector3.h"
+#include "matrix3.h"
+#include "matrix4.h"
+#include "parallel.h"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+// Fixed-stride binary point records as found in raw XYZ dumps and binary little-endian PLY
+// vertex lists, transformed in place without decoding the rest of the record (colors,
+// intensities and so on are left untouched).
+
+namespace linkit
+{
+    enum class ScalarType : std::uint8_t
+    {
+        float32,
+        float64
+    };
+
+    struct PointLayout
+    {
+        std::size_t stride = 3 * sizeof(float);
+        std::size_t position_offset[3] = {0, sizeof(float), 2 * sizeof(float)};
+        ScalarType position_type = ScalarType::float32;
+        bool has_normals = false;
+        std::size_t normal_offset[3] = {};
+        ScalarType normal_type = ScalarType::float32;
+        std::uint64_t count = 0; // Number of records; 0 means they run to the end of the input
+
+        // Headerless x, y, z triples.
+        [[nodiscard]] static PointLayout xyz(const ScalarType type)
+        {
+            PointLayout layout;
+            const std::size_t size = type == ScalarType::float32 ? sizeof(float) : sizeof(double);
+            layout.stride = 3 * size;
+            layout.position_offset[1] = size;
+            layout.position_offset[2] = 2 * size;
+            layout.position_type = type;
+            return layout;
+        }
+    };
+
+    // Reads the vertex layout from a PLY header (the text up to and including the end_header
+    // line). Only binary_little_endian files whose first element is a vertex list with scalar
+    // float or double x, y, z properties are accepted; nx, ny, nz of the same kind are picked up
+    // as normals. Returns false for anything else, leaving layout unspecified.
+    inline bool parse_ply_header(const std::string_view header, PointLayout& layout)
+    {
+        layout = PointLayout();
+        layout.stride = 0;
+        bool binary_le = false, in_vertex = false, seen_element = false;
+        int found = 0, found_normals = 0;
+        std::size_t pos = 0;
+        while (pos < header.size())
+        {
+            std::size_t end = header.find('\n', pos);
+            if (end == std::string_view::npos) end = header.size();
+            std::string_view line = header.substr(pos, end - pos);
+            pos = end + 1;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+            std::string_view words[4];
+            std::size_t count = 0, at = 0;
+            while (count < 4 && at < line.size())
+            {
+                while (at < line.size() && line[at] == ' ') ++at;
+                const std::size_t start = at;
+                while (at < line.size() && line[at] != ' ') ++at;
+                if (at > start) words[count++] = line.substr(start, at - start);
+            }
+            if (count == 0) continue;
+
+            if (words[0] == "format")
+                binary_le = count >= 2 && words[1] == "binary_little_endian";
+            else if (words[0] == "element")
+            {
+                if (count < 3) return false;
+                if (!seen_element)
+                {
+                    if (words[1] != "vertex") return false;
+                    std::uint64_t n = 0;
+                    for (const char c : words[2])
+                    {
+                        if (c < '0' || c > '9') return false;
+                        n = n * 10 + static_cast<std::uint64_t>(c - '0');
+                    }
+                    layout.count = n;
+                    in_vertex = true;
+                }
+                else
+                    in_vertex = false;
+                seen_element = true;
+            }
+            else if (words[0] == "property" && in_vertex)
+            {
+                if (count < 3 || words[1] == "list") return false;
+                const std::string_view type = words[1];
+                std::size_t size;
+                if (type == "char" || type == "uchar" || type == "int8" || type == "uint8") size = 1;
+                else if (type == "short" || type == "ushort" || type == "int16" || type == "uint16") size = 2;
+                else if (type == "int" || type == "uint" || type == "int32" || type == "uint32" || type == "float" || type == "float32") size = 4;
+                else if (type == "double" || type == "float64") size = 8;
+                else return false;
+
+                const bool is_float = type == "float" || type == "float32" || type == "double" || type == "float64";
+                const ScalarType scalar = size == 4 ? ScalarType::float32 : ScalarType::float64;
+                const std::string_view name = words[2];
+                const int axis = name == "x" || name == "nx" ? 0 : name == "y" || name == "ny" ? 1 : name == "z" || name == "nz" ? 2 : -1;
+                if (axis >= 0 && name.size() == 1)
+                {
+                    if (!is_float || (found != 0 && scalar != layout.position_type)) return false;
+                    layout.position_type = scalar;
+                    layout.position_offset[axis] = layout.stride;
+                    found |= 1 << axis;
+                }
+                else if (axis >= 0 && is_float && (found_normals == 0 || scalar == layout.normal_type))
+                {
+                    layout.normal_type = scalar;
+                    layout.normal_offset[axis] = layout.stride;
+                    found_normals |= 1 << axis;
+                }
+                layout.stride += size;
+            }
+            else if (words[0] == "end_header")
+                break;
+        }
+        layout.has_normals = found_normals == 7;
+        return binary_le && found == 7;
+    }
+
+    namespace detail
+    {
+        static_assert(std::endian::native == std::endian::little || std::endian::native == std::endian::big,
+                      "point records need a little- or big-endian host");
+
+        // Records are little-endian; bytes are swapped on big-endian hosts.
+        template <typename Bits>
+        Bits little_endian(const Bits bits)
+        {
+            if constexpr (std::endian::native == std::endian::big)
+                return std::byteswap(bits);
+            else
+                return bits;
+        }
+
+        inline real load_scalar(const std::byte* p, const ScalarType type)
+        {
+            if (type == ScalarType::float32)
+            {
+                std::uint32_t bits;
+                std::memcpy(&bits, p, sizeof(bits));
+                return static_cast<real>(std::bit_cast<float>(little_endian(bits)));
+            }
+            std::uint64_t bits;
+            std::memcpy(&bits, p, sizeof(bits));
+            return static_cast<real>(std::bit_cast<double>(little_endian(bits)));
+        }
+
+        inline void store_scalar(std::byte* p, const ScalarType type, const real value)
+        {
+            if (type == ScalarType::float32)
+            {
+                const std::uint32_t bits = little_endian(std::bit_cast<std::uint32_t>(static_cast<float>(value)));
+                std::memcpy(p, &bits, sizeof(bits));
+                return;
+            }
+            const std::uint64_t bits = little_endian(std::bit_cast<std::uint64_t>(static_cast<double>(value)));
+            std::memcpy(p, &bits, sizeof(bits));
+        }
+    }
+
+    // Transforms the positions of every whole record in records by transform (with the
+    // perspective divide if its bottom row is not (0, 0, 0, 1)) and the normals, if the layout
+    // has them, by the inverse transpose of its upper 3x3, renormalized. Records are gathered in
+    // blocks into Vector3 scratch arrays so the arithmetic runs over contiguous data; blocks are
+    // spread over the default job system. Returns the number of records transformed.
+    inline std::size_t transform_records(const std::span<std::byte> records, const PointLayout& layout, const Matrix4& transform)
+    {
+        if (layout.stride == 0) return 0;
+        const std::size_t count = records.size() / layout.stride;
+        const auto& m = transform.m;
+        const bool projective = m[3][0] != 0 || m[3][1] != 0 || m[3][2] != 0 || m[3][3] != 1;
+
+        Matrix3 normal_matrix;
+        if (layout.has_normals)
+        {
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    normal_matrix.m[i][j] = m[i][j];
+            normal_matrix = normal_matrix.inverse().transposed();
+        }
+
+        parallel_for(count, 16384, [&](const std::size_t begin, const std::size_t end) {
+            constexpr std::size_t block = 256;
+            Vector3 points[block];
+            for (std::size_t first = begin; first < end; first += block)
+            {
+                const std::size_t n = std::min(block, end - first);
+                std::byte* base = records.data() + first * layout.stride;
+
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    const std::byte* record = base + i * layout.stride;
+                    points[i] = Vector3(detail::load_scalar(record + layout.position_offset[0], layout.position_type),
+                                        detail::load_scalar(record + layout.position_offset[1], layout.position_type),
+                                        detail::load_scalar(record + layout.position_offset[2], layout.position_type));
+                }
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    const Vector3 p = points[i];
+                    Vector3 q(m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+                              m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3],
+                              m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]);
+                    if (projective)
+                    {
+                        const real w = m[3][0] * p.x + m[3][1] * p.y + m[3][2] * p.z + m[3][3];
+                        q = q * (static_cast<real>(1.0) / w);
+                    }
+                    points[i] = q;
+                }
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    std::byte* record = base + i * layout.stride;
+                    detail::store_scalar(record + layout.position_offset[0], layout.position_type, points[i].x);
+                    detail::store_scalar(record + layout.position_offset[1], layout.position_type, points[i].y);
+                    detail::store_scalar(record + layout.position_offset[2], layout.position_type, points[i].z);
+                }
+
+                if (!layout.has_normals) continue;
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    std::byte* record = base + i * layout.stride;
+                    Vector3 normal = normal_matrix * Vector3(detail::load_scalar(record + layout.normal_offset[0], layout.normal_type),
+                                                             detail::load_scalar(record + layout.normal_offset[1], layout.normal_type),
+                                                             detail::load_scalar(record + layout.normal_offset[2], layout.normal_type));
+                    const real length_sq = normal.magnitude_squared();
+                    if (length_sq > 0) normal = normal * (static_cast<real>(1.0) / real_sqrt(length_sq));
+                    detail::store_scalar(record + layout.normal_offset[0], layout.normal_type, normal.x);
+                    detail::store_scalar(record + layout.normal_offset[1], layout.normal_type, normal.y);
+                    detail::store_scalar(record + layout.normal_offset[2], layout.normal_type, normal.z);
+                }
+            }
+        });
+        return count;
+    }
+}
+
+#endif //LINKIT_POINT_RECORDS_H
@@ -28,6 +28,11 @@ namespace linkit
         return std::cos(angle);
     }
 
+    inline real real_tan(const real angle)
+    {
+        return std::tan(angle);
+    }
+
     inline real real_acos(const real cosine)
     {
         return std::acos(cosine);
@@ -38,6 +43,11 @@ namespace linkit
         return std::asin(sine);
     }
 
+    inline real real_atan2(const real y, const real x)
+    {
+        return std::atan2(y, x);
+    }
+
 }
 
 #endif //LINKIT_PRECISION_H
\ No newline at end of file
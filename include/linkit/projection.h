@@ -0,0 +1,151 @@
+#ifndef LINKIT_PROJECTION_H
+#define LINKIT_PROJECTION_H
+#include "precision.h"
+#include "vector3.h"
+#include "matrix4.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace linkit
+{
+    // Bits set in the clip flags of a point for every clip-space plane it lies outside of.
+    constexpr std::uint8_t clip_left = 1;
+    constexpr std::uint8_t clip_right = 2;
+    constexpr std::uint8_t clip_bottom = 4;
+    constexpr std::uint8_t clip_top = 8;
+    constexpr std::uint8_t clip_near = 16;
+    constexpr std::uint8_t clip_far = 32;
+    constexpr std::uint8_t all_clip_bits = clip_left | clip_right | clip_bottom | clip_top | clip_near | clip_far;
+
+    // Target rectangle in pixels, y growing downwards. Screen coordinates are produced in fixed
+    // point with subpixel_bits fractional bits (0 for whole pixels).
+    struct Viewport
+    {
+        std::int32_t x = 0;
+        std::int32_t y = 0;
+        std::int32_t width = 0;
+        std::int32_t height = 0;
+        std::uint32_t subpixel_bits = 0;
+    };
+
+    // Window coordinates of a projected point; depth is mapped to [0, 1] (for reversed-Z, 1 is
+    // the near plane), stored as float like a depth buffer.
+    struct ScreenPoint
+    {
+        std::int32_t x = 0;
+        std::int32_t y = 0;
+        float depth = 0;
+    };
+
+    // Projects points by view_projection to the viewport in one pass: the clip-space transform,
+    // the plane tests, the perspective divide and the fixed-point rounding all run over four
+    // lane-major points at a time without per-lane branches, and blocks are spread over the
+    // default job system. If flags is not empty it receives each point's clip bits. Points
+    // behind the eye (w <= 0) get a zero ScreenPoint, as do points with a NaN or infinite clip
+    // coordinate, which also get every clip bit; other outside points are still projected, with
+    // coordinates clamped to +-2^30, so guard-band rasterizers can use them. out (and flags)
+    // must hold points.size() entries. Returns the number of points inside every plane.
+    inline std::size_t project_points(const Matrix4& view_projection, const std::span<const Vector3> points, const Viewport& viewport,
+                                      const std::span<ScreenPoint> out, const std::span<std::uint8_t> flags = {},
+                                      const DepthRange depth_range = DepthRange::negative_one_to_one)
+    {
+        const std::size_t n = points.size();
+        if (n == 0) return 0;
+        const auto& m = view_projection.m;
+        const real unit = static_cast<real>(std::uint64_t(1) << std::min<std::uint32_t>(viewport.subpixel_bits, 16));
+        const real half_width = static_cast<real>(0.5) * static_cast<real>(viewport.width) * unit;
+        const real half_height = static_cast<real>(0.5) * static_cast<real>(viewport.height) * unit;
+        const real center_x = static_cast<real>(viewport.x) * unit + half_width;
+        const real center_y = static_cast<real>(viewport.y) * unit + half_height;
+        const bool symmetric = depth_range == DepthRange::negative_one_to_one;
+        const bool reversed = depth_range == DepthRange::reversed_zero_to_one;
+        const real depth_scale = symmetric ? static_cast<real>(0.5) : static_cast<real>(1.0);
+        const real depth_bias = symmetric ? static_cast<real>(0.5) : static_cast<real>(0.0);
+        constexpr real limit = static_cast<real>(1 << 30);
+
+        const std::size_t chunks = parallel_chunk_count(n, 16384);
+        std::vector<std::size_t> visible(chunks);
+        parallel_for_chunks(n, chunks, [&](const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+            constexpr std::size_t lanes = 4;
+            std::size_t inside = 0;
+            for (std::size_t first = begin; first < end; first += lanes)
+            {
+                const std::size_t count = std::min(lanes, end - first);
+                real px[lanes] = {}, py[lanes] = {}, pz[lanes] = {};
+                for (std::size_t l = 0; l < count; ++l)
+                {
+                    px[l] = points[first + l].x;
+                    py[l] = points[first + l].y;
+                    pz[l] = points[first + l].z;
+                }
+
+                real cx[lanes], cy[lanes], cz[lanes], cw[lanes];
+                for (std::size_t l = 0; l < lanes; ++l)
+                {
+                    cx[l] = m[0][0] * px[l] + m[0][1] * py[l] + m[0][2] * pz[l] + m[0][3];
+                    cy[l] = m[1][0] * px[l] + m[1][1] * py[l] + m[1][2] * pz[l] + m[1][3];
+                    cz[l] = m[2][0] * px[l] + m[2][1] * py[l] + m[2][2] * pz[l] + m[2][3];
+                    cw[l] = m[3][0] * px[l] + m[3][1] * py[l] + m[3][2] * pz[l] + m[3][3];
+                }
+
+                // NaN compares false against every plane, so non-finite lanes are flagged apart
+                bool finite[lanes];
+                for (std::size_t l = 0; l < lanes; ++l)
+                    finite[l] = std::isfinite(cx[l]) && std::isfinite(cy[l]) && std::isfinite(cz[l]) && std::isfinite(cw[l]);
+
+                std::uint8_t bits[lanes];
+                for (std::size_t l = 0; l < lanes; ++l)
+                {
+                    const real w = cw[l];
+                    const real z_low = symmetric ? -w : static_cast<real>(0.0);
+                    const bool below = cz[l] < z_low, above = cz[l] > w;
+                    const auto plane_bits = static_cast<std::uint8_t>((cx[l] < -w ? clip_left : 0) | (cx[l] > w ? clip_right : 0) |
+                                                                      (cy[l] < -w ? clip_bottom : 0) | (cy[l] > w ? clip_top : 0) |
+                                                                      (below ? (reversed ? clip_far : clip_near) : 0) |
+                                                                      (above ? (reversed ? clip_near : clip_far) : 0));
+                    bits[l] = finite[l] ? plane_bits : all_clip_bits;
+                }
+
+                // Masked lanes are selected away rather than scaled by zero, since 0 * inf and
+                // 0 * NaN are NaN, and NaN must never reach the integer conversion below
+                real sx[lanes], sy[lanes], sz[lanes];
+                for (std::size_t l = 0; l < lanes; ++l)
+                {
+                    const bool in_front = finite[l] && cw[l] > 0;
+                    const real inv_w = static_cast<real>(1.0) / (in_front ? cw[l] : static_cast<real>(1.0));
+                    // A denormal w can still overflow inv_w, and 0 * inf is NaN
+                    const real x = cx[l] * inv_w * half_width + center_x;
+                    const real y = center_y - cy[l] * inv_w * half_height;
+                    const real z = cz[l] * inv_w * depth_scale + depth_bias;
+                    const bool keep = in_front && !std::isnan(x) && !std::isnan(y) && !std::isnan(z);
+                    sx[l] = keep ? std::clamp(x, -limit, limit) : static_cast<real>(0.0);
+                    sy[l] = keep ? std::clamp(y, -limit, limit) : static_cast<real>(0.0);
+                    sz[l] = keep ? z : static_cast<real>(0.0);
+                }
+
+                for (std::size_t l = 0; l < count; ++l)
+                {
+                    ScreenPoint& screen = out[first + l];
+                    screen.x = static_cast<std::int32_t>(std::floor(sx[l] + static_cast<real>(0.5)));
+                    screen.y = static_cast<std::int32_t>(std::floor(sy[l] + static_cast<real>(0.5)));
+                    screen.depth = static_cast<float>(sz[l]);
+                    inside += bits[l] == 0;
+                }
+                if (!flags.empty())
+                    for (std::size_t l = 0; l < count; ++l)
+                        flags[first + l] = bits[l];
+            }
+            visible[chunk] = inside;
+        });
+
+        std::size_t total = 0;
+        for (const std::size_t v : visible) total += v;
+        return total;
+    }
+}
+
+#endif //LINKIT_PROJECTION_H
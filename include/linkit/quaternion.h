@@ -160,7 +160,89 @@ namespace linkit
             *this = *this * other;
         }
 
+        [[nodiscard]] real dot(const Quaternion& other) const
+            {
+                return w * other.w + x * other.x + y * other.y + z * other.z;
+            }
+
+        // Normalized linear interpolation along the shorter arc. Not constant speed, but cheap and
+        // accurate for nearby orientations.
+        [[nodiscard]] static Quaternion nlerp(const Quaternion& a, const Quaternion& b, const real t)
+            {
+                const real wb = a.dot(b) < 0 ? -t : t;
+                const real wa = 1 - t;
+                Quaternion q(a.w * wa + b.w * wb, a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb);
+                q.normalize();
+                return q;
+            }
+
+        // Constant-speed interpolation along the shorter arc.
+        [[nodiscard]] static Quaternion slerp(const Quaternion& a, const Quaternion& b, const real t)
+            {
+                return slerp_direct(a, a.dot(b) < 0 ? Quaternion(-b.w, -b.x, -b.y, -b.z) : b, t);
+            }
+
+        // Constant-speed interpolation along the arc from a to b as given, even when it is the
+        // longer one (squad needs this for its outer blend). The angle comes from atan2 of the
+        // chord lengths |a - b| and |a + b| and the weights from sin(x) / x, so the result stays
+        // accurate for nearly equal orientations instead of switching to nlerp. Exactly opposite
+        // quaternions have no defined arc and return a.
+        [[nodiscard]] static Quaternion slerp_direct(const Quaternion& a, const Quaternion& b, const real t)
+            {
+                const real dw = a.w - b.w, dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+                const real sw = a.w + b.w, sx = a.x + b.x, sy = a.y + b.y, sz = a.z + b.z;
+                real wa, wb;
+                if (!slerp_weights(real_sqrt(dw * dw + dx * dx + dy * dy + dz * dz), real_sqrt(sw * sw + sx * sx + sy * sy + sz * sz), t, wa, wb))
+                    return a;
+                return Quaternion(a.w * wa + b.w * wb, a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb);
+            }
+
+        // The weights of slerp_direct(a, b, t) = a * wa + b * wb, given the chord lengths
+        // |a - b| and |a + b|, for batched callers that compute the chords themselves. Returns
+        // false, with wa = 1 and wb = 0, for exactly opposite quaternions.
+        static bool slerp_weights(const real difference, const real sum, const real t, real& wa, real& wb)
+            {
+                const real angle = 2 * real_atan2(difference, sum);
+                const real sinc_angle = sinc(angle);
+                if (sinc_angle < REAL_EPSILON)
+                {
+                    wa = 1;
+                    wb = 0;
+                    return false;
+                }
+                wa = (1 - t) * sinc((1 - t) * angle) / sinc_angle;
+                wb = t * sinc(t * angle) / sinc_angle;
+                return true;
+            }
+
+        // Exponential map: the unit quaternion rotating by |v| * 2 radians about v.
+        [[nodiscard]] static Quaternion exp(const Vector3& v)
+            {
+                const real angle = v.magnitude();
+                if (angle < REAL_EPSILON)
+                    return Quaternion(1, v.x, v.y, v.z);
+                const real s = real_sin(angle) / angle;
+                return Quaternion(real_cos(angle), v.x * s, v.y * s, v.z * s);
+            }
+
+        // Inverse of exp() for unit quaternions: half the rotation angle times the axis.
+        [[nodiscard]] Vector3 log() const
+            {
+                const real sin_half = real_sqrt(x * x + y * y + z * z);
+                if (sin_half < REAL_EPSILON)
+                    return Vector3(x, y, z);
+                const real s = real_atan2(sin_half, w) / sin_half;
+                return Vector3(x * s, y * s, z * s);
+            }
 
+        private:
+            // sin(x) / x, with its Taylor series near zero.
+            static real sinc(const real x)
+            {
+                if (std::abs(x) < static_cast<real>(1e-4))
+                    return 1 - x * x / 6;
+                return real_sin(x) / x;
+            }
     };
 }
 
@@ -0,0 +1,473 @@
+#ifndef LINKIT_QUICKHULL_H
+#define LINKIT_QUICKHULL_H
+#include "precision.h"
+#include "vector3.h"
+#include "parallel.h"
+#include "convex_shapes.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace linkit
+{
+    // Quickhull over a Vector3 point set. Faces are triangles in a half-edge mesh whose edges and
+    // faces live in arenas with free lists, and each face keeps the points still outside it. The
+    // initial partition and the redistribution of large orphan sets run in parallel. Faces are
+    // expanded farthest point first, so with a vertex cap the result is the hull of the most
+    // extreme points found so far. An object can be reused to build many hulls without
+    // reallocating.
+    class QuickHull
+    {
+    public:
+        QuickHull() = default;
+
+        // Builds the hull of points. max_vertices = 0 means no cap; otherwise at least 4.
+        // Returns false, leaving the hull empty, if the points do not span a volume.
+        bool build(const std::span<const Vector3> points, const std::size_t max_vertices = 0)
+        {
+            reset();
+            _points = points;
+            if (points.size() < 4) return false;
+            if (!initial_simplex()) return false;
+
+            std::size_t vertex_count = 4;
+            const std::size_t cap = max_vertices == 0 ? std::numeric_limits<std::size_t>::max() : std::max<std::size_t>(max_vertices, 4);
+            while (!_queue.empty() && vertex_count < cap)
+            {
+                const auto [distance, face] = _queue.top();
+                _queue.pop();
+                const Face& f = _faces[face];
+                if (!f.alive || _outside[face].empty() || f.farthest_distance != distance) continue;
+                add_point(f.farthest, face);
+                ++vertex_count;
+            }
+
+            extract();
+            return true;
+        }
+
+        // Hull vertex positions and the indices of those vertices in the input.
+        [[nodiscard]] std::span<const Vector3> vertices() const
+        {
+            return _vertices;
+        }
+
+        [[nodiscard]] std::span<const std::uint32_t> vertex_indices() const
+        {
+            return _vertex_indices;
+        }
+
+        // Counter-clockwise (outward-facing) triangles, three indices into vertices() each.
+        [[nodiscard]] std::span<const std::uint32_t> triangles() const
+        {
+            return _triangles;
+        }
+
+        [[nodiscard]] real volume() const
+        {
+            if (_vertices.empty()) return 0;
+            const Vector3& origin = _vertices[0];
+            real sum = 0;
+            for (std::size_t t = 0; t < _triangles.size(); t += 3)
+            {
+                const Vector3 a = _vertices[_triangles[t]] - origin;
+                const Vector3 b = _vertices[_triangles[t + 1]] - origin;
+                const Vector3 c = _vertices[_triangles[t + 2]] - origin;
+                sum += a * (b % c);
+            }
+            return sum / 6;
+        }
+
+        [[nodiscard]] real surface_area() const
+        {
+            real sum = 0;
+            for (std::size_t t = 0; t < _triangles.size(); t += 3)
+            {
+                const Vector3& a = _vertices[_triangles[t]];
+                sum += ((_vertices[_triangles[t + 1]] - a) % (_vertices[_triangles[t + 2]] - a)).magnitude();
+            }
+            return sum / 2;
+        }
+
+        [[nodiscard]] ConvexHullShape to_shape() const
+        {
+            return ConvexHullShape(_vertices);
+        }
+
+    private:
+        static constexpr std::uint32_t none = 0xffffffffu;
+
+        struct HalfEdge
+        {
+            std::uint32_t origin; // Point index
+            std::uint32_t face;
+            std::uint32_t next;
+            std::uint32_t twin;
+        };
+
+        struct Face
+        {
+            std::uint32_t edge;
+            Vector3 normal;
+            real offset;
+            real farthest_distance;
+            std::uint32_t farthest;
+            std::uint32_t visit;
+            bool alive;
+        };
+
+        struct HorizonEdge
+        {
+            std::uint32_t a, b, twin;
+        };
+
+        std::span<const Vector3> _points;
+        real _epsilon = 0;
+        std::uint32_t _visit = 0;
+
+        std::vector<HalfEdge> _edges;
+        std::vector<std::uint32_t> _free_edges;
+        std::vector<Face> _faces;
+        std::vector<std::uint32_t> _free_faces;
+        std::vector<std::vector<std::uint32_t>> _outside; // Outside set per face, capacity kept on reuse
+        std::priority_queue<std::pair<real, std::uint32_t>> _queue;
+
+        // Scratch reused between iterations
+        std::vector<std::uint32_t> _visible;
+        std::vector<HorizonEdge> _horizon;
+        std::vector<std::uint32_t> _new_faces;
+        std::vector<std::uint32_t> _orphans;
+        std::vector<std::pair<std::uint32_t, real>> _assignment;
+        struct StackEntry
+        {
+            std::uint32_t edge;
+            int remaining;
+        };
+        std::vector<StackEntry> _stack;
+
+        std::vector<Vector3> _vertices;
+        std::vector<std::uint32_t> _vertex_indices;
+        std::vector<std::uint32_t> _triangles;
+        std::vector<std::uint32_t> _vertex_map;
+
+        void reset()
+        {
+            _edges.clear();
+            _free_edges.clear();
+            _faces.clear();
+            _free_faces.clear();
+            for (std::vector<std::uint32_t>& outside : _outside) outside.clear();
+            _queue = {};
+            _vertices.clear();
+            _vertex_indices.clear();
+            _triangles.clear();
+        }
+
+        [[nodiscard]] real distance(const Face& face, const Vector3& p) const
+        {
+            return face.normal * p - face.offset;
+        }
+
+        std::uint32_t new_edge(const std::uint32_t origin, const std::uint32_t face)
+        {
+            std::uint32_t e;
+            if (!_free_edges.empty())
+            {
+                e = _free_edges.back();
+                _free_edges.pop_back();
+            }
+            else
+            {
+                e = static_cast<std::uint32_t>(_edges.size());
+                _edges.emplace_back();
+            }
+            _edges[e] = HalfEdge{origin, face, none, none};
+            return e;
+        }
+
+        std::uint32_t new_face(const std::uint32_t a, const std::uint32_t b, const std::uint32_t c)
+        {
+            std::uint32_t f;
+            if (!_free_faces.empty())
+            {
+                f = _free_faces.back();
+                _free_faces.pop_back();
+            }
+            else
+            {
+                f = static_cast<std::uint32_t>(_faces.size());
+                _faces.emplace_back();
+                if (_outside.size() < _faces.size()) _outside.emplace_back();
+            }
+
+            const std::uint32_t e0 = new_edge(a, f), e1 = new_edge(b, f), e2 = new_edge(c, f);
+            _edges[e0].next = e1;
+            _edges[e1].next = e2;
+            _edges[e2].next = e0;
+
+            const Vector3& pa = _points[a];
+            Vector3 normal = (_points[b] - pa) % (_points[c] - pa);
+            const real length = normal.magnitude();
+            if (length > 0) normal *= static_cast<real>(1.0) / length;
+            _faces[f] = Face{e0, normal, normal * pa, 0, none, 0, true};
+            _outside[f].clear();
+            return f;
+        }
+
+        void free_face(const std::uint32_t f)
+        {
+            Face& face = _faces[f];
+            face.alive = false;
+            std::uint32_t e = face.edge;
+            for (int k = 0; k < 3; ++k)
+            {
+                const std::uint32_t next = _edges[e].next;
+                _free_edges.push_back(e);
+                e = next;
+            }
+            _free_faces.push_back(f);
+        }
+
+        void enqueue(const std::uint32_t f)
+        {
+            if (!_outside[f].empty())
+                _queue.emplace(_faces[f].farthest_distance, f);
+        }
+
+        // Index of the point maximizing score, reduced over parallel chunks.
+        template <typename Score>
+        std::pair<std::uint32_t, real> farthest(Score&& score) const
+        {
+            const std::size_t chunks = parallel_chunk_count(_points.size(), 65536);
+            std::vector<std::pair<std::uint32_t, real>> best(chunks, {0, -std::numeric_limits<real>::max()});
+            parallel_for_chunks(_points.size(), chunks, [&](const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+                std::pair<std::uint32_t, real> local{0, -std::numeric_limits<real>::max()};
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const real s = score(_points[i]);
+                    if (s > local.second) local = {static_cast<std::uint32_t>(i), s};
+                }
+                best[chunk] = local;
+            });
+            std::pair<std::uint32_t, real> result = best[0];
+            for (const auto& candidate : best)
+                if (candidate.second > result.second) result = candidate;
+            return result;
+        }
+
+        bool initial_simplex()
+        {
+            std::uint32_t extremes[6];
+            extremes[0] = farthest([](const Vector3& p) { return p.x; }).first;
+            extremes[1] = farthest([](const Vector3& p) { return -p.x; }).first;
+            extremes[2] = farthest([](const Vector3& p) { return p.y; }).first;
+            extremes[3] = farthest([](const Vector3& p) { return -p.y; }).first;
+            extremes[4] = farthest([](const Vector3& p) { return p.z; }).first;
+            extremes[5] = farthest([](const Vector3& p) { return -p.z; }).first;
+
+            // Scale-relative tolerance, as in qhull
+            const real max_abs = std::max(std::abs(_points[extremes[0]].x), std::abs(_points[extremes[1]].x)) +
+                                 std::max(std::abs(_points[extremes[2]].y), std::abs(_points[extremes[3]].y)) +
+                                 std::max(std::abs(_points[extremes[4]].z), std::abs(_points[extremes[5]].z));
+            _epsilon = 3 * std::numeric_limits<real>::epsilon() * max_abs;
+
+            // Most distant pair among the axis extremes
+            std::uint32_t v0 = 0, v1 = 0;
+            real best = -1;
+            for (int i = 0; i < 6; ++i)
+                for (int j = i + 1; j < 6; ++j)
+                {
+                    const real d = (_points[extremes[i]] - _points[extremes[j]]).magnitude_squared();
+                    if (d > best)
+                    {
+                        best = d;
+                        v0 = extremes[i];
+                        v1 = extremes[j];
+                    }
+                }
+            if (best <= _epsilon * _epsilon) return false;
+
+            const Vector3 origin = _points[v0];
+            const Vector3 axis = _points[v1] - origin;
+            const auto [v2, line_distance] = farthest([&](const Vector3& p) { return (axis % (p - origin)).magnitude_squared(); });
+            if (line_distance <= _epsilon * _epsilon * axis.magnitude_squared()) return false;
+
+            Vector3 normal = axis % (_points[v2] - origin);
+            normal *= static_cast<real>(1.0) / normal.magnitude();
+            const auto [v3, plane_distance] = farthest([&](const Vector3& p) { return std::abs(normal * (p - origin)); });
+            if (plane_distance <= _epsilon) return false;
+
+            // Orient the faces outward: v3 must lie below the base
+            std::uint32_t a = v0, b = v1, c = v2;
+            if (normal * (_points[v3] - origin) > 0) std::swap(b, c);
+            const std::uint32_t faces[4] = {new_face(a, b, c), new_face(a, v3, b), new_face(b, v3, c), new_face(c, v3, a)};
+
+            // Link twins by matching reversed edges
+            for (const std::uint32_t f : faces)
+            {
+                std::uint32_t e = _faces[f].edge;
+                for (int k = 0; k < 3; ++k, e = _edges[e].next)
+                {
+                    const std::uint32_t dest = _edges[_edges[e].next].origin;
+                    for (const std::uint32_t g : faces)
+                    {
+                        std::uint32_t h = _faces[g].edge;
+                        for (int m = 0; m < 3; ++m, h = _edges[h].next)
+                            if (_edges[h].origin == dest && _edges[_edges[h].next].origin == _edges[e].origin)
+                                _edges[e].twin = h;
+                    }
+                }
+            }
+
+            // Partition every point except the simplex vertices
+            _orphans.resize(_points.size());
+            for (std::size_t i = 0; i < _points.size(); ++i)
+                _orphans[i] = static_cast<std::uint32_t>(i);
+            for (const std::uint32_t v : {v0, v1, v2, v3})
+                _orphans[v] = none;
+            _new_faces.assign(faces, faces + 4);
+            distribute_orphans();
+            return true;
+        }
+
+        // Assigns each point in _orphans to the new face it is farthest outside of, if any.
+        void distribute_orphans()
+        {
+            _assignment.resize(_orphans.size());
+            auto assign = [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    std::pair<std::uint32_t, real> best{none, _epsilon};
+                    if (_orphans[i] != none)
+                    {
+                        const Vector3& p = _points[_orphans[i]];
+                        for (const std::uint32_t f : _new_faces)
+                        {
+                            const real d = distance(_faces[f], p);
+                            if (d > best.second) best = {f, d};
+                        }
+                    }
+                    _assignment[i] = best;
+                }
+            };
+            if (_orphans.size() * _new_faces.size() > 65536)
+                parallel_for(_orphans.size(), 8192, assign);
+            else
+                assign(0, _orphans.size());
+
+            for (std::size_t i = 0; i < _orphans.size(); ++i)
+            {
+                const auto [f, d] = _assignment[i];
+                if (f == none) continue;
+                _outside[f].push_back(_orphans[i]);
+                Face& face = _faces[f];
+                if (face.farthest == none || d > face.farthest_distance)
+                {
+                    face.farthest = _orphans[i];
+                    face.farthest_distance = d;
+                }
+            }
+            for (const std::uint32_t f : _new_faces)
+                enqueue(f);
+        }
+
+        void add_point(const std::uint32_t eye, const std::uint32_t start)
+        {
+            const Vector3& p = _points[eye];
+
+            // Depth-first search over visible faces. Entering a face through an edge and then
+            // walking its other two edges in order yields the horizon as a closed loop.
+            ++_visit;
+            _visible.clear();
+            _horizon.clear();
+            _stack.clear();
+            _faces[start].visit = _visit;
+            _visible.push_back(start);
+            _stack.push_back({_faces[start].edge, 3});
+            while (!_stack.empty())
+            {
+                StackEntry& top = _stack.back();
+                if (top.remaining == 0)
+                {
+                    _stack.pop_back();
+                    continue;
+                }
+                const std::uint32_t e = top.edge;
+                top.edge = _edges[e].next;
+                --top.remaining;
+
+                const std::uint32_t twin = _edges[e].twin;
+                const std::uint32_t neighbor = _edges[twin].face;
+                if (_faces[neighbor].visit == _visit) continue;
+                if (distance(_faces[neighbor], p) > _epsilon)
+                {
+                    _faces[neighbor].visit = _visit;
+                    _visible.push_back(neighbor);
+                    _stack.push_back({_edges[twin].next, 2});
+                }
+                else
+                {
+                    _horizon.push_back({_edges[e].origin, _edges[_edges[e].next].origin, twin});
+                }
+            }
+
+            // Collect the orphaned points before the visible faces are recycled
+            _orphans.clear();
+            for (const std::uint32_t f : _visible)
+            {
+                for (const std::uint32_t point : _outside[f])
+                    if (point != eye) _orphans.push_back(point);
+                _outside[f].clear();
+                free_face(f);
+            }
+
+            // Cone of new faces from the horizon to the eye
+            _new_faces.clear();
+            for (const HorizonEdge& h : _horizon)
+            {
+                const std::uint32_t f = new_face(h.a, h.b, eye);
+                const std::uint32_t e = _faces[f].edge;
+                _edges[e].twin = h.twin;
+                _edges[h.twin].twin = e;
+                _new_faces.push_back(f);
+            }
+            for (std::size_t i = 0; i < _new_faces.size(); ++i)
+            {
+                const std::uint32_t to_eye = _edges[_faces[_new_faces[i]].edge].next;                           // b -> eye
+                const std::uint32_t from_eye = _edges[_edges[_faces[_new_faces[(i + 1) % _new_faces.size()]].edge].next].next; // eye -> a
+                _edges[to_eye].twin = from_eye;
+                _edges[from_eye].twin = to_eye;
+            }
+
+            distribute_orphans();
+        }
+
+        void extract()
+        {
+            _vertex_map.assign(_points.size(), none);
+            for (std::uint32_t f = 0; f < _faces.size(); ++f)
+            {
+                if (!_faces[f].alive) continue;
+                std::uint32_t e = _faces[f].edge;
+                for (int k = 0; k < 3; ++k, e = _edges[e].next)
+                {
+                    const std::uint32_t point = _edges[e].origin;
+                    if (_vertex_map[point] == none)
+                    {
+                        _vertex_map[point] = static_cast<std::uint32_t>(_vertices.size());
+                        _vertices.push_back(_points[point]);
+                        _vertex_indices.push_back(point);
+                    }
+                    _triangles.push_back(_vertex_map[point]);
+                }
+            }
+        }
+    };
+}
+
+#endif //LINKIT_QUICKHULL_H
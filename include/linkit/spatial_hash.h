@@ -0,0 +1,222 @@
+#ifndef LINKIT_SPATIAL_HASH_H
+#define LINKIT_SPATIAL_HASH_H
+#include "precision.h"
+#include "vector3.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace linkit
+{
+    // Cell-linked list over a Vector3 array, rebuilt from scratch every frame. Points are hashed
+    // into a power-of-two bucket table and counting-sorted so that each bucket is a contiguous
+    // run of point indices and positions. Neighbor queries assume radius <= cell_size.
+    class SpatialHashGrid
+    {
+    public:
+        real cell_size;
+
+        explicit SpatialHashGrid(const real cell_size): cell_size(cell_size) {}
+
+        void build(const std::span<const Vector3> positions)
+        {
+            const std::size_t n = positions.size();
+            std::size_t buckets = 1024;
+            while (buckets < 2 * n) buckets <<= 1;
+            _mask = static_cast<std::uint32_t>(buckets - 1);
+            _inv_cell = cell_size > 0 ? static_cast<real>(1.0) / cell_size : 0;
+
+            _bucket_of.resize(n);
+            _bucket_start.assign(buckets + 1, 0);
+            _sorted_index.resize(n);
+            _px.resize(n);
+            _py.resize(n);
+            _pz.resize(n);
+
+            // Hash and count
+            parallel_for(n, 4096, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const std::uint32_t bucket = bucket_of(cell_coord(positions[i].x),
+                                                           cell_coord(positions[i].y),
+                                                           cell_coord(positions[i].z));
+                    _bucket_of[i] = bucket;
+                    std::atomic_ref(_bucket_start[bucket + 1]).fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+
+            for (std::size_t b = 0; b < buckets; ++b)
+                _bucket_start[b + 1] += _bucket_start[b];
+
+            // Scatter indices and positions into bucket order
+            _cursor.assign(_bucket_start.begin(), _bucket_start.end() - 1);
+            parallel_for(n, 4096, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const std::uint32_t slot = std::atomic_ref(_cursor[_bucket_of[i]]).fetch_add(1, std::memory_order_relaxed);
+                    _sorted_index[slot] = static_cast<std::uint32_t>(i);
+                }
+            });
+
+            // Slot order inside a bucket depends on thread timing; sort it to keep results deterministic.
+            parallel_for(buckets, 4096, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t b = begin; b < end; ++b)
+                {
+                    const auto first = _sorted_index.begin() + _bucket_start[b];
+                    const auto last = _sorted_index.begin() + _bucket_start[b + 1];
+                    if (last - first > 1) std::sort(first, last);
+                    for (auto it = first; it != last; ++it)
+                    {
+                        const std::size_t slot = it - _sorted_index.begin();
+                        _px[slot] = positions[*it].x;
+                        _py[slot] = positions[*it].y;
+                        _pz[slot] = positions[*it].z;
+                    }
+                }
+            });
+        }
+
+        // Calls fn(i, j, distance_squared) once for every unordered pair of points closer than
+        // radius, with i and j indices into the array passed to build(). fn is called
+        // concurrently from several threads.
+        template <typename Fn>
+        void for_each_neighbor_pair(const real radius, Fn&& fn) const
+        {
+            const real radius_sq = radius * radius;
+            parallel_for(_sorted_index.size(), 2048, [&](const std::size_t begin, const std::size_t end) {
+                std::uint32_t neighbors[27];
+                int neighbor_count = 0;
+                std::int64_t last_cell[3] = {0, 0, 0};
+                bool has_cell = false;
+
+                for (std::size_t slot = begin; slot < end; ++slot)
+                {
+                    const real x = _px[slot], y = _py[slot], z = _pz[slot];
+                    const std::int64_t cell[3] = {cell_coord(x), cell_coord(y), cell_coord(z)};
+                    if (!has_cell || cell[0] != last_cell[0] || cell[1] != last_cell[1] || cell[2] != last_cell[2])
+                    {
+                        neighbor_count = neighbor_buckets(cell, neighbors);
+                        std::copy(cell, cell + 3, last_cell);
+                        has_cell = true;
+                    }
+
+                    for (int k = 0; k < neighbor_count; ++k)
+                    {
+                        const std::uint32_t b = neighbors[k];
+                        // Each pair is reported from the lower slot only
+                        for (std::uint32_t other = std::max<std::uint32_t>(_bucket_start[b], static_cast<std::uint32_t>(slot + 1));
+                             other < _bucket_start[b + 1]; ++other)
+                        {
+                            const real dx = _px[other] - x;
+                            const real dy = _py[other] - y;
+                            const real dz = _pz[other] - z;
+                            const real dist_sq = dx * dx + dy * dy + dz * dz;
+                            if (dist_sq < radius_sq)
+                                fn(_sorted_index[slot], _sorted_index[other], dist_sq);
+                        }
+                    }
+                }
+            });
+        }
+
+        // Calls fn(j, distance_squared) for every point within radius of point. Only the cells the
+        // query sphere reaches are visited, so a radius well below cell_size mostly reads one bucket.
+        template <typename Fn>
+        void for_each_neighbor(const Vector3& point, const real radius, Fn&& fn) const
+        {
+            if (_sorted_index.empty()) return;
+            const real radius_sq = radius * radius;
+            const real coords[3] = {point.x, point.y, point.z};
+            std::int64_t lo[3], hi[3];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const std::int64_t cell = cell_coord(coords[axis]);
+                lo[axis] = std::max(cell_coord(coords[axis] - radius), cell - 1);
+                hi[axis] = std::min(cell_coord(coords[axis] + radius), cell + 1);
+            }
+            std::uint32_t neighbors[27];
+            int neighbor_count = 0;
+            for (std::int64_t z = lo[2]; z <= hi[2]; ++z)
+                for (std::int64_t y = lo[1]; y <= hi[1]; ++y)
+                    for (std::int64_t x = lo[0]; x <= hi[0]; ++x)
+                        neighbors[neighbor_count++] = bucket_of(x, y, z);
+            if (neighbor_count > 1)
+            {
+                std::sort(neighbors, neighbors + neighbor_count);
+                neighbor_count = static_cast<int>(std::unique(neighbors, neighbors + neighbor_count) - neighbors);
+            }
+            for (int k = 0; k < neighbor_count; ++k)
+            {
+                const std::uint32_t b = neighbors[k];
+                for (std::uint32_t slot = _bucket_start[b]; slot < _bucket_start[b + 1]; ++slot)
+                {
+                    const real dx = _px[slot] - point.x;
+                    const real dy = _py[slot] - point.y;
+                    const real dz = _pz[slot] - point.z;
+                    const real dist_sq = dx * dx + dy * dy + dz * dz;
+                    if (dist_sq < radius_sq)
+                        fn(_sorted_index[slot], dist_sq);
+                }
+            }
+        }
+
+        // Original point indices in bucket order; bucket b covers [bucket_start()[b], bucket_start()[b + 1]).
+        [[nodiscard]] std::span<const std::uint32_t> sorted_indices() const
+        {
+            return _sorted_index;
+        }
+
+        [[nodiscard]] std::span<const std::uint32_t> bucket_start() const
+        {
+            return _bucket_start;
+        }
+
+    private:
+        std::vector<std::uint32_t> _bucket_of;
+        std::vector<std::uint32_t> _bucket_start;
+        std::vector<std::uint32_t> _cursor;
+        std::vector<std::uint32_t> _sorted_index;
+        std::vector<real> _px, _py, _pz; // Positions in bucket order
+        std::uint32_t _mask = 0;
+        real _inv_cell = 0;
+
+        // 64-bit cell coordinates so that tiny cells (e.g. a welding tolerance) far from the
+        // origin do not overflow. Clamped in real to +-2^62 before converting, since casting NaN
+        // or a value beyond int64 is undefined; NaN maps to cell 0. The margin keeps the
+        // neighbour offsets (cell +- 1) in range.
+        [[nodiscard]] std::int64_t cell_coord(const real value) const
+        {
+            constexpr real limit = static_cast<real>(std::int64_t{1} << 62);
+            const real c = std::floor(value * _inv_cell);
+            if (std::isnan(c)) return 0;
+            return static_cast<std::int64_t>(std::clamp(c, -limit, limit));
+        }
+
+        [[nodiscard]] std::uint32_t bucket_of(const std::int64_t x, const std::int64_t y, const std::int64_t z) const
+        {
+            const std::uint64_t h = static_cast<std::uint64_t>(x) * 73856093u ^
+                                    static_cast<std::uint64_t>(y) * 19349663u ^
+                                    static_cast<std::uint64_t>(z) * 83492791u;
+            return static_cast<std::uint32_t>(h ^ (h >> 32)) & _mask;
+        }
+
+        // Distinct buckets of the 27 cells around cell. Different cells may share a bucket, so
+        // duplicates are removed to avoid visiting a bucket twice.
+        int neighbor_buckets(const std::int64_t cell[3], std::uint32_t out[27]) const
+        {
+            int count = 0;
+            for (int dz = -1; dz <= 1; ++dz)
+                for (int dy = -1; dy <= 1; ++dy)
+                    for (int dx = -1; dx <= 1; ++dx)
+                        out[count++] = bucket_of(cell[0] + dx, cell[1] + dy, cell[2] + dz);
+            std::sort(out, out + count);
+            return static_cast<int>(std::unique(out, out + count) - out);
+        }
+    };
+}
+
+#endif //LINKIT_SPATIAL_HASH_H
@@ -0,0 +1,403 @@
+#ifndef LINKIT_SPLINE_H
+#define LINKIT_SPLINE_H
+#include "precision.h"
+#include "vector3.h"
+#include "quaternion.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace linkit
+{
+    // Piecewise cubic curve through Vector3 control points. Whatever the input form, each segment
+    // is stored as power-basis coefficients p(u) = ((a*u + b)*u + c)*u + d for u in [0, 1], so
+    // Catmull-Rom, Hermite and Bezier curves share one evaluator. The curve parameter t runs over
+    // [0, segment_count()]: segment floor(t) at u = t - floor(t). Parameters outside the range
+    // are clamped to the end points.
+    class Spline
+    {
+    public:
+        Spline() = default;
+
+        // Uniform Catmull-Rom spline passing through every point. The end tangents reuse the
+        // first and last points as phantom neighbours.
+        [[nodiscard]] static Spline catmull_rom(const std::span<const Vector3> points)
+        {
+            Spline spline;
+            if (points.size() < 2) return spline;
+            const std::size_t last = points.size() - 1;
+            spline._segments.reserve(last);
+            for (std::size_t i = 0; i < last; ++i)
+            {
+                const Vector3& p0 = points[i == 0 ? 0 : i - 1];
+                const Vector3& p1 = points[i];
+                const Vector3& p2 = points[i + 1];
+                const Vector3& p3 = points[std::min(i + 2, last)];
+                spline._segments.push_back(from_hermite(p1, p2, (p2 - p0) * static_cast<real>(0.5), (p3 - p1) * static_cast<real>(0.5)));
+            }
+            return spline;
+        }
+
+        // Cubic Hermite spline with an explicit tangent at every point.
+        [[nodiscard]] static Spline hermite(const std::span<const Vector3> points, const std::span<const Vector3> tangents)
+        {
+            Spline spline;
+            const std::size_t count = std::min(points.size(), tangents.size());
+            if (count < 2) return spline;
+            spline._segments.reserve(count - 1);
+            for (std::size_t i = 0; i + 1 < count; ++i)
+                spline._segments.push_back(from_hermite(points[i], points[i + 1], tangents[i], tangents[i + 1]));
+            return spline;
+        }
+
+        // Chain of cubic Bezier segments sharing end points: 3 * n + 1 control points make n
+        // segments. Trailing points that do not complete a segment are ignored.
+        [[nodiscard]] static Spline bezier(const std::span<const Vector3> control)
+        {
+            Spline spline;
+            if (control.size() < 4) return spline;
+            const std::size_t count = (control.size() - 1) / 3;
+            spline._segments.reserve(count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const Vector3& p0 = control[3 * i];
+                const Vector3& p1 = control[3 * i + 1];
+                const Vector3& p2 = control[3 * i + 2];
+                const Vector3& p3 = control[3 * i + 3];
+                spline._segments.push_back(make_segment(
+                    p3 - p0 + (p1 - p2) * static_cast<real>(3),
+                    (p0 - p1 * static_cast<real>(2) + p2) * static_cast<real>(3),
+                    (p1 - p0) * static_cast<real>(3),
+                    p0));
+            }
+            return spline;
+        }
+
+        [[nodiscard]] std::size_t segment_count() const
+        {
+            return _segments.size();
+        }
+
+        [[nodiscard]] bool empty() const
+        {
+            return _segments.empty();
+        }
+
+        [[nodiscard]] Vector3 position(const real t) const
+        {
+            real u;
+            const Segment& s = locate(t, u);
+            return Vector3(((s.a[0] * u + s.b[0]) * u + s.c[0]) * u + s.d[0],
+                           ((s.a[1] * u + s.b[1]) * u + s.c[1]) * u + s.d[1],
+                           ((s.a[2] * u + s.b[2]) * u + s.c[2]) * u + s.d[2]);
+        }
+
+        // First derivative with respect to t (the velocity when t advances by one per second).
+        [[nodiscard]] Vector3 derivative(const real t) const
+        {
+            real u;
+            const Segment& s = locate(t, u);
+            return Vector3((3 * s.a[0] * u + 2 * s.b[0]) * u + s.c[0],
+                           (3 * s.a[1] * u + 2 * s.b[1]) * u + s.c[1],
+                           (3 * s.a[2] * u + 2 * s.b[2]) * u + s.c[2]);
+        }
+
+        [[nodiscard]] Vector3 second_derivative(const real t) const
+        {
+            real u;
+            const Segment& s = locate(t, u);
+            return Vector3(6 * s.a[0] * u + 2 * s.b[0], 6 * s.a[1] * u + 2 * s.b[1], 6 * s.a[2] * u + 2 * s.b[2]);
+        }
+
+        // Batched evaluation: positions[i] (and derivatives[i], if not empty) at parameters[i].
+        // Parameters are processed four at a time; each lane gathers its segment's coefficients
+        // into lane-major arrays and the Horner steps then run across lanes without branches.
+        void evaluate(const std::span<const real> parameters, const std::span<Vector3> positions,
+                      const std::span<Vector3> derivatives = {}) const
+        {
+            if (_segments.empty()) return;
+            const std::size_t count = std::min(parameters.size(), positions.size());
+            const bool with_derivatives = derivatives.size() >= count;
+            parallel_for(count, 4096, [&](const std::size_t begin, const std::size_t end) {
+                constexpr std::size_t lanes = 4;
+                for (std::size_t first = begin; first < end; first += lanes)
+                {
+                    const std::size_t n = std::min(lanes, end - first);
+                    real u[lanes] = {};
+                    real a[3][lanes], b[3][lanes], c[3][lanes], d[3][lanes];
+                    for (std::size_t l = 0; l < lanes; ++l)
+                    {
+                        const Segment& s = locate(l < n ? parameters[first + l] : 0, u[l]);
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            a[k][l] = s.a[k];
+                            b[k][l] = s.b[k];
+                            c[k][l] = s.c[k];
+                            d[k][l] = s.d[k];
+                        }
+                    }
+
+                    real p[3][lanes], v[3][lanes];
+                    for (int k = 0; k < 3; ++k)
+                        for (std::size_t l = 0; l < lanes; ++l)
+                        {
+                            p[k][l] = ((a[k][l] * u[l] + b[k][l]) * u[l] + c[k][l]) * u[l] + d[k][l];
+                            v[k][l] = (3 * a[k][l] * u[l] + 2 * b[k][l]) * u[l] + c[k][l];
+                        }
+
+                    for (std::size_t l = 0; l < n; ++l)
+                    {
+                        positions[first + l] = Vector3(p[0][l], p[1][l], p[2][l]);
+                        if (with_derivatives) derivatives[first + l] = Vector3(v[0][l], v[1][l], v[2][l]);
+                    }
+                }
+            });
+        }
+
+    private:
+        struct Segment
+        {
+            real a[3], b[3], c[3], d[3];
+        };
+
+        std::vector<Segment> _segments;
+
+        static Segment make_segment(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d)
+        {
+            return Segment{{a.x, a.y, a.z}, {b.x, b.y, b.z}, {c.x, c.y, c.z}, {d.x, d.y, d.z}};
+        }
+
+        static Segment from_hermite(const Vector3& p0, const Vector3& p1, const Vector3& m0, const Vector3& m1)
+        {
+            return make_segment((p0 - p1) * static_cast<real>(2) + m0 + m1,
+                                (p1 - p0) * static_cast<real>(3) - m0 * static_cast<real>(2) - m1,
+                                m0,
+                                p0);
+        }
+
+        const Segment& locate(const real t, real& u) const
+        {
+            const auto last = static_cast<real>(_segments.size());
+            const real clamped = std::clamp(t, static_cast<real>(0), last);
+            const std::size_t index = std::min(static_cast<std::size_t>(clamped), _segments.size() - 1);
+            u = clamped - static_cast<real>(index);
+            return _segments[index];
+        }
+    };
+
+    // Precomputed map from arc length to curve parameter. The curve length is integrated with
+    // 5-point Gauss-Legendre quadrature over samples_per_segment slices of each segment, and the
+    // (distance, parameter) pair at every slice boundary is kept together with dt/ds = 1 / |C'(t)|
+    // there. parameter() finds the slice by a binary search narrowed by a guide table spaced
+    // evenly in distance, starts from the cubic Hermite through the slice's end points and
+    // slopes (limited to three times the secant so cusps stay monotonic), and refines it with one
+    // Newton step on the quadrature length from the slice start. The table keeps a copy of the
+    // spline for that step. At the default 16 slices per segment the parameter error stays within
+    // about 1e-6 of a segment.
+    class ArcLengthTable
+    {
+    public:
+        ArcLengthTable() = default;
+
+        explicit ArcLengthTable(const Spline& spline, const std::size_t samples_per_segment = 16)
+        {
+            build(spline, samples_per_segment);
+        }
+
+        void build(const Spline& spline, std::size_t samples_per_segment = 16)
+        {
+            _distances.clear();
+            _slopes.clear();
+            _guide.clear();
+            _step = 0;
+            _length = 0;
+            if (spline.empty()) return;
+            samples_per_segment = std::max<std::size_t>(samples_per_segment, 1);
+            _spline = spline;
+
+            const std::size_t slices = spline.segment_count() * samples_per_segment;
+            _step = static_cast<real>(1) / static_cast<real>(samples_per_segment);
+            _distances.assign(slices + 1, 0);
+            _slopes.resize(slices + 1);
+            parallel_for(slices + 1, 1024, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const real t0 = static_cast<real>(i) * _step;
+                    const real speed = spline.derivative(t0).magnitude();
+                    _slopes[i] = speed > 0 ? static_cast<real>(1.0) / speed : std::numeric_limits<real>::infinity();
+                    if (i < slices) _distances[i + 1] = arc_length(t0, _step);
+                }
+            });
+            for (std::size_t i = 0; i < slices; ++i)
+                _distances[i + 1] += _distances[i];
+            _length = _distances[slices];
+
+            // _guide[j] is the slice holding distance j * _spacing
+            _guide.resize(slices + 1);
+            _spacing = _length / static_cast<real>(slices);
+            std::size_t slice = 0;
+            for (std::size_t j = 0; j <= slices; ++j)
+            {
+                const real distance = _spacing * static_cast<real>(j);
+                while (slice + 1 < slices && _distances[slice + 1] < distance) ++slice;
+                _guide[j] = static_cast<std::uint32_t>(slice);
+            }
+        }
+
+        [[nodiscard]] real length() const
+        {
+            return _length;
+        }
+
+        // Curve parameter at the given distance from the start, clamped to [0, length()].
+        [[nodiscard]] real parameter(const real distance) const
+        {
+            if (_distances.empty()) return 0;
+            const std::size_t slices = _distances.size() - 1;
+            if (!(_spacing > 0)) return 0;
+            const real d = std::clamp(distance, static_cast<real>(0), _length);
+
+            const std::size_t j = std::min(static_cast<std::size_t>(d / _spacing), slices - 1);
+            const real* first = _distances.data() + _guide[j];
+            const real* last = _distances.data() + std::min<std::size_t>(_guide[j + 1] + 1, slices);
+            const std::size_t i = std::max<std::ptrdiff_t>(std::upper_bound(first, last, d) - _distances.data() - 1, 0);
+
+            const real h = _distances[i + 1] - _distances[i];
+            const real t0 = static_cast<real>(i) * _step;
+            if (!(h > 0)) return t0;
+            const real secant = _step / h;
+            const real m0 = std::min(_slopes[i], 3 * secant) * h;
+            const real m1 = std::min(_slopes[i + 1], 3 * secant) * h;
+            const real s = (d - _distances[i]) / h;
+            const real s2 = s * s, s3 = s2 * s;
+            real t = t0 + (3 * s2 - 2 * s3) * _step + (s3 - 2 * s2 + s) * m0 + (s3 - s2) * m1;
+
+            // One Newton step on the arc length measured from the slice start
+            const real speed = _spline.derivative(t).magnitude();
+            if (speed > 0)
+                t -= (_distances[i] + arc_length(t0, t - t0) - d) / speed;
+            return std::clamp(t, t0, t0 + _step);
+        }
+
+        void parameters(const std::span<const real> distances, const std::span<real> out) const
+        {
+            const std::size_t count = std::min(distances.size(), out.size());
+            parallel_for(count, 8192, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                    out[i] = parameter(distances[i]);
+            });
+        }
+
+    private:
+        Spline _spline;
+        std::vector<real> _distances;      // Arc length at slice boundary i, parameter i * _step
+        std::vector<real> _slopes;         // dt/ds at slice boundary i
+        std::vector<std::uint32_t> _guide; // Slice holding distance j * _spacing
+        real _step = 0;
+        real _spacing = 0;
+        real _length = 0;
+
+        // 5-point Gauss-Legendre estimate of the length of [t0, t0 + width].
+        [[nodiscard]] real arc_length(const real t0, const real width) const
+        {
+            static constexpr real nodes[5] = {-0.9061798459386640, -0.5384693101056831, 0, 0.5384693101056831, 0.9061798459386640};
+            static constexpr real weights[5] = {0.2369268850561891, 0.4786286704993665, 0.5688888888888889, 0.4786286704993665, 0.2369268850561891};
+            real length = 0;
+            for (int k = 0; k < 5; ++k)
+                length += weights[k] * _spline.derivative(t0 + width * (nodes[k] + 1) * static_cast<real>(0.5)).magnitude();
+            return length * width * static_cast<real>(0.5);
+        }
+    };
+
+    // Positions (and optionally tangents) at arc-length distances along spline. parameters is
+    // caller-owned scratch for the curve parameters, so a buffer kept between calls is reused.
+    inline void evaluate_at_distances(const Spline& spline, const ArcLengthTable& table, const std::span<const real> distances,
+                                      const std::span<Vector3> positions, std::vector<real>& parameters,
+                                      const std::span<Vector3> derivatives = {})
+    {
+        parameters.resize(std::min(distances.size(), positions.size()));
+        table.parameters(distances, parameters);
+        spline.evaluate(parameters, positions, derivatives);
+    }
+
+    // Spherical quadrangle interpolation through a sequence of orientations: a C1-continuous
+    // rotation path, the quaternion analogue of a Catmull-Rom curve. Keys are sign-aligned with
+    // their predecessor on construction so every segment takes the shorter arc. The parameter
+    // runs over [0, segment_count()] like Spline.
+    class SquadSpline
+    {
+    public:
+        SquadSpline() = default;
+
+        explicit SquadSpline(const std::span<const Quaternion> keys)
+        {
+            build(keys);
+        }
+
+        void build(const std::span<const Quaternion> keys)
+        {
+            _keys.assign(keys.begin(), keys.end());
+            for (std::size_t i = 1; i < _keys.size(); ++i)
+                if (_keys[i - 1].dot(_keys[i]) < 0)
+                    _keys[i] = Quaternion(-_keys[i].w, -_keys[i].x, -_keys[i].y, -_keys[i].z);
+
+            // Inner control points s_i = q_i * exp(-(log(q_i^-1 q_i+1) + log(q_i^-1 q_i-1)) / 4)
+            const std::size_t count = _keys.size();
+            _controls.resize(count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const Quaternion& q = _keys[i];
+                const Quaternion inverse = q.conjugate();
+                const Vector3 next = (inverse * _keys[std::min(i + 1, count - 1)]).log();
+                const Vector3 previous = (inverse * _keys[i == 0 ? 0 : i - 1]).log();
+                _controls[i] = q * Quaternion::exp((next + previous) * static_cast<real>(-0.25));
+            }
+        }
+
+        [[nodiscard]] std::size_t segment_count() const
+        {
+            return _keys.size() < 2 ? 0 : _keys.size() - 1;
+        }
+
+        [[nodiscard]] Quaternion evaluate(const real t) const
+        {
+            if (_keys.empty()) return Quaternion();
+            if (_keys.size() == 1) return _keys[0];
+            const std::size_t segments = _keys.size() - 1;
+            const real clamped = std::clamp(t, static_cast<real>(0), static_cast<real>(segments));
+            const std::size_t i = std::min(static_cast<std::size_t>(clamped), segments - 1);
+            const real u = clamped - static_cast<real>(i);
+            return squad(_keys[i], _controls[i], _controls[i + 1], _keys[i + 1], u);
+        }
+
+        void evaluate(const std::span<const real> parameters, const std::span<Quaternion> out) const
+        {
+            const std::size_t count = std::min(parameters.size(), out.size());
+            parallel_for(count, 2048, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                    out[i] = evaluate(parameters[i]);
+            });
+        }
+
+        // squad(q0, s0, s1, q1, u) = slerp(slerp(q0, q1, u), slerp(s0, s1, u), 2u(1 - u)). None of
+        // the slerps may flip to the shorter arc: the two intermediate quaternions can fall in
+        // opposite hemispheres partway through a segment, and flipping there makes the curve jump.
+        [[nodiscard]] static Quaternion squad(const Quaternion& q0, const Quaternion& s0, const Quaternion& s1,
+                                              const Quaternion& q1, const real u)
+        {
+            Quaternion q = Quaternion::slerp_direct(Quaternion::slerp_direct(q0, q1, u), Quaternion::slerp_direct(s0, s1, u), 2 * u * (1 - u));
+            q.normalize();
+            return q;
+        }
+
+    private:
+        std::vector<Quaternion> _keys;
+        std::vector<Quaternion> _controls;
+    };
+}
+
+#endif //LINKIT_SPLINE_H
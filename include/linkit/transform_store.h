@@ -0,0 +1,254 @@
+#ifndef LINKIT_TRANSFORM_STORE_H
+#define LINKIT_TRANSFORM_STORE_H
+#include "precision.h"
+#include "vector3.h"
+#include "quaternion.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace linkit
+{
+    // Interpolates two transform arrays: positions linearly, orientations along the shortest arc
+    // with Quaternion::slerp, which stays accurate for nearby orientations.
+    inline void interpolate_transforms(const std::span<const Vector3> from_positions, const std::span<const Vector3> to_positions,
+                                       const std::span<const Quaternion> from_orientations, const std::span<const Quaternion> to_orientations,
+                                       const real alpha, const std::span<Vector3> out_positions, const std::span<Quaternion> out_orientations)
+    {
+        const std::size_t position_count = std::min({from_positions.size(), to_positions.size(), out_positions.size()});
+        const std::size_t orientation_count = std::min({from_orientations.size(), to_orientations.size(), out_orientations.size()});
+
+        parallel_for(std::max(position_count, orientation_count), 8192, [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < std::min(end, position_count); ++i)
+            {
+                const Vector3& a = from_positions[i];
+                const Vector3& b = to_positions[i];
+                out_positions[i] = Vector3(a.x + (b.x - a.x) * alpha, a.y + (b.y - a.y) * alpha, a.z + (b.z - a.z) * alpha);
+            }
+
+            for (std::size_t i = begin; i < std::min(end, orientation_count); ++i)
+            {
+                Quaternion q = Quaternion::slerp(from_orientations[i], to_orientations[i], alpha);
+                q.normalize();
+                out_orientations[i] = q;
+            }
+        });
+    }
+
+    // Multi-buffered transform store for handing positions and orientations from a single writer
+    // (the physics thread) to any number of readers. The writer fills a free buffer and publishes
+    // it with one atomic store. Readers pin the latest buffer and read it in place, so they never
+    // copy or take a lock; a pinned buffer is never reused by the writer. Enough buffers are kept
+    // for every reader to pin the last two frames while the writer works on a third.
+    class TransformStore
+    {
+        struct Buffer;
+
+    public:
+        struct WriteFrame
+        {
+            std::span<Vector3> positions;
+            std::span<Quaternion> orientations;
+        };
+
+        // Pinned view of one published frame. The buffer is released when the snapshot is destroyed.
+        class Snapshot
+        {
+        public:
+            Snapshot() = default;
+            Snapshot(const Snapshot&) = delete;
+            Snapshot& operator=(const Snapshot&) = delete;
+            Snapshot(Snapshot&& other) noexcept: _buffer(std::exchange(other._buffer, nullptr)) {}
+            Snapshot& operator=(Snapshot&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    release();
+                    _buffer = std::exchange(other._buffer, nullptr);
+                }
+                return *this;
+            }
+            ~Snapshot()
+            {
+                release();
+            }
+
+            [[nodiscard]] bool valid() const
+            {
+                return _buffer != nullptr;
+            }
+
+            [[nodiscard]] std::span<const Vector3> positions() const
+            {
+                return _buffer->positions;
+            }
+
+            [[nodiscard]] std::span<const Quaternion> orientations() const
+            {
+                return _buffer->orientations;
+            }
+
+            [[nodiscard]] real time() const
+            {
+                return _buffer->time;
+            }
+
+            [[nodiscard]] std::uint64_t frame() const
+            {
+                return _buffer->frame;
+            }
+
+        private:
+            friend class TransformStore;
+            Buffer* _buffer = nullptr;
+
+            explicit Snapshot(Buffer* buffer): _buffer(buffer) {}
+
+            void release()
+            {
+                if (_buffer != nullptr)
+                    _buffer->state.fetch_sub(1, std::memory_order_release);
+                _buffer = nullptr;
+            }
+        };
+
+        explicit TransformStore(const std::size_t count, const std::size_t max_readers = 2)
+            : _buffer_count(2 * std::max<std::size_t>(max_readers, 1) + 3),
+              _buffers(std::make_unique<Buffer[]>(_buffer_count))
+        {
+            for (std::size_t i = 0; i < _buffer_count; ++i)
+            {
+                _buffers[i].positions.resize(count);
+                _buffers[i].orientations.resize(count);
+            }
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return _buffers[0].positions.size();
+        }
+
+        // Claims a free buffer for the writer. Its contents are an older frame unless copy_latest
+        // is set. Only one thread may write at a time.
+        WriteFrame begin_write(const bool copy_latest = false)
+        {
+            const std::uint64_t published = _published.load(std::memory_order_relaxed);
+            const auto latest = static_cast<std::uint32_t>(published);
+            const auto previous = static_cast<std::uint32_t>(published >> 32);
+
+            for (;;)
+            {
+                for (std::uint32_t i = 0; i < _buffer_count; ++i)
+                {
+                    if (i == latest || i == previous) continue;
+                    std::uint32_t expected = 0;
+                    if (_buffers[i].state.compare_exchange_strong(expected, writing, std::memory_order_acq_rel))
+                    {
+                        _writing = i;
+                        Buffer& buffer = _buffers[i];
+                        if (copy_latest && latest != none)
+                        {
+                            std::copy(_buffers[latest].positions.begin(), _buffers[latest].positions.end(), buffer.positions.begin());
+                            std::copy(_buffers[latest].orientations.begin(), _buffers[latest].orientations.end(), buffer.orientations.begin());
+                        }
+                        return WriteFrame{buffer.positions, buffer.orientations};
+                    }
+                }
+                // Only reachable with more concurrent readers than the store was sized for
+                std::this_thread::yield();
+            }
+        }
+
+        // Makes the buffer from begin_write() the latest frame.
+        void publish(const real time)
+        {
+            if (_writing == none) return;
+            Buffer& buffer = _buffers[_writing];
+            buffer.time = time;
+            buffer.frame = ++_frame;
+            buffer.state.fetch_sub(writing, std::memory_order_release);
+
+            const std::uint64_t published = _published.load(std::memory_order_relaxed);
+            _published.store((published << 32) | _writing, std::memory_order_release);
+            _writing = none;
+        }
+
+        // Latest published frame, or an invalid snapshot before the first publish().
+        [[nodiscard]] Snapshot acquire() const
+        {
+            for (;;)
+            {
+                const auto latest = static_cast<std::uint32_t>(_published.load(std::memory_order_acquire));
+                if (latest == none) return Snapshot();
+                if (Buffer* buffer = pin(latest)) return Snapshot(buffer);
+            }
+        }
+
+        // Writes the transforms at `time`, interpolated between the last two published frames.
+        // Returns false until two frames have been published.
+        bool interpolate(const real time, const std::span<Vector3> out_positions, const std::span<Quaternion> out_orientations) const
+        {
+            for (;;)
+            {
+                const std::uint64_t published = _published.load(std::memory_order_acquire);
+                const auto latest = static_cast<std::uint32_t>(published);
+                const auto previous = static_cast<std::uint32_t>(published >> 32);
+                if (latest == none || previous == none) return false;
+
+                Snapshot to(pin(latest));
+                if (!to.valid()) continue;
+                Snapshot from(pin(previous));
+                if (!from.valid()) continue;
+                // The writer may have recycled and republished previous before it was pinned, so
+                // it could now hold a frame newer than latest; only consecutive frames are used.
+                if (from.frame() + 1 != to.frame()) continue;
+
+                const real duration = to.time() - from.time();
+                const real alpha = duration > 0 ? std::clamp((time - from.time()) / duration, static_cast<real>(0), static_cast<real>(1)) : 1;
+                interpolate_transforms(from.positions(), to.positions(), from.orientations(), to.orientations(),
+                                       alpha, out_positions, out_orientations);
+                return true;
+            }
+        }
+
+    private:
+        static constexpr std::uint32_t none = 0xffffffffu;
+        static constexpr std::uint32_t writing = 0x80000000u;
+
+        struct Buffer
+        {
+            std::vector<Vector3> positions;
+            std::vector<Quaternion> orientations;
+            real time = 0;
+            std::uint64_t frame = 0;
+            alignas(64) std::atomic<std::uint32_t> state{0}; // Reader count, plus `writing` while claimed
+        };
+
+        std::size_t _buffer_count;
+        std::unique_ptr<Buffer[]> _buffers;
+        alignas(64) std::atomic<std::uint64_t> _published{~std::uint64_t{0}}; // previous << 32 | latest
+        std::uint32_t _writing = none;
+        std::uint64_t _frame = 0;
+
+        // Fails if the writer claimed the buffer after it was read from _published; the caller
+        // then retries with the newer frame.
+        Buffer* pin(const std::uint32_t index) const
+        {
+            Buffer& buffer = _buffers[index];
+            if (buffer.state.fetch_add(1, std::memory_order_acquire) & writing)
+            {
+                buffer.state.fetch_sub(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            return &buffer;
+        }
+    };
+}
+
+#endif //LINKIT_TRANSFORM_STORE_H
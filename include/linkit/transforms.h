@@ -0,0 +1,496 @@
+#ifndef LINKIT_TRANSFORMS_H
+#define LINKIT_TRANSFORMS_H
+#include "precision.h"
+#include "vector3.h"
+#include "matrix3.h"
+#include "matrix4.h"
+#include "quaternion.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+// Typed transforms that only store the entries their kind can change. Every transform is a
+// linear part followed by an optional translation, x -> L x + t, and a product keeps whichever
+// type can represent the result most cheaply: rotations stay rotations, a rotation times a
+// uniform scale is a ScaledRotation, and only mixing a rotation with a non-uniform Scale (or a
+// Matrix3) falls back to DenseLinear, a Matrix3 with the same interface as the other types. A
+// translation on either side turns the product into Affine<L>, so
+//
+//     Translation(t) * Rotation<>(angle, axis) * UniformScale(s)
+//
+// is a Similarity<> (a quaternion, a factor and an offset) assembled by copying its parts, with
+// no arithmetic at all, and Matrix4 is only formed by to_matrix4(). Result types follow from
+// the operand types, so chains resolve at compile time with no run-time dispatch.
+//
+// inverse() follows Matrix3::inverse(): a singular transform (a scale factor or determinant
+// below REAL_EPSILON in magnitude) is returned unchanged, and so is an Affine whose linear part
+// is singular.
+
+namespace linkit
+{
+    template <typename Basis = Quaternion>
+    class Rotation
+    {
+        static_assert(std::is_same_v<Basis, Quaternion> || std::is_same_v<Basis, Matrix3>,
+                      "Rotation is backed by a unit Quaternion or an orthonormal Matrix3");
+
+    public:
+        Basis basis;
+
+        Rotation() = default;
+        explicit Rotation(const Basis& basis) : basis(basis) {}
+        Rotation(const real angle, const Vector3& axis)
+        {
+            if constexpr (std::is_same_v<Basis, Quaternion>)
+                basis = Quaternion(angle, axis);
+            else
+                basis = Matrix3::rotate(angle, axis);
+        }
+
+        Vector3 operator*(const Vector3& v) const
+        {
+            if constexpr (std::is_same_v<Basis, Quaternion>)
+                return basis.rotate(v);
+            else
+                return basis * v;
+        }
+
+        [[nodiscard]] Rotation inverse() const
+        {
+            if constexpr (std::is_same_v<Basis, Quaternion>)
+                return Rotation(basis.conjugate());
+            else
+                return Rotation(basis.transposed());
+        }
+
+        [[nodiscard]] Matrix3 to_matrix3() const
+        {
+            if constexpr (std::is_same_v<Basis, Quaternion>)
+                return basis.to_matrix3();
+            else
+                return basis;
+        }
+
+        [[nodiscard]] Matrix4 to_matrix4() const
+        {
+            return Matrix4(to_matrix3());
+        }
+    };
+
+    class UniformScale
+    {
+    public:
+        real factor = 1;
+
+        UniformScale() = default;
+        explicit UniformScale(const real factor) : factor(factor) {}
+
+        Vector3 operator*(const Vector3& v) const
+        {
+            return v * factor;
+        }
+
+        [[nodiscard]] UniformScale inverse() const
+        {
+            if (std::abs(factor) < REAL_EPSILON) return *this;
+            return UniformScale(static_cast<real>(1.0) / factor);
+        }
+
+        [[nodiscard]] Matrix3 to_matrix3() const
+        {
+            return Matrix3::scale(Vector3(factor, factor, factor));
+        }
+
+        [[nodiscard]] Matrix4 to_matrix4() const
+        {
+            return Matrix4::scale(Vector3(factor, factor, factor));
+        }
+    };
+
+    class Scale
+    {
+    public:
+        Vector3 factors = Vector3(1, 1, 1);
+
+        Scale() = default;
+        explicit Scale(const Vector3& factors) : factors(factors) {}
+        explicit Scale(const UniformScale& scale) : factors(scale.factor, scale.factor, scale.factor) {}
+
+        Vector3 operator*(const Vector3& v) const
+        {
+            return Vector3(v.x * factors.x, v.y * factors.y, v.z * factors.z);
+        }
+
+        [[nodiscard]] Scale inverse() const
+        {
+            if (std::min({std::abs(factors.x), std::abs(factors.y), std::abs(factors.z)}) < REAL_EPSILON) return *this;
+            return Scale(Vector3(static_cast<real>(1.0) / factors.x, static_cast<real>(1.0) / factors.y, static_cast<real>(1.0) / factors.z));
+        }
+
+        [[nodiscard]] Matrix3 to_matrix3() const
+        {
+            return Matrix3::scale(factors);
+        }
+
+        [[nodiscard]] Matrix4 to_matrix4() const
+        {
+            return Matrix4::scale(factors);
+        }
+    };
+
+    // Rotation after a uniform scale; the two commute, so either order is this type.
+    template <typename Basis = Quaternion>
+    class ScaledRotation
+    {
+    public:
+        Rotation<Basis> rotation;
+        real factor = 1;
+
+        ScaledRotation() = default;
+        ScaledRotation(const Rotation<Basis>& rotation, const real factor) : rotation(rotation), factor(factor) {}
+
+        Vector3 operator*(const Vector3& v) const
+        {
+            return rotation * (v * factor);
+        }
+
+        [[nodiscard]] ScaledRotation inverse() const
+        {
+            if (std::abs(factor) < REAL_EPSILON) return *this;
+            return ScaledRotation(rotation.inverse(), static_cast<real>(1.0) / factor);
+        }
+
+        [[nodiscard]] Matrix3 to_matrix3() const
+        {
+            return rotation.to_matrix3() * factor;
+        }
+
+        [[nodiscard]] Matrix4 to_matrix4() const
+        {
+            return Matrix4(to_matrix3());
+        }
+    };
+
+    // Any linear map, stored densely. Products with no cheaper closed form end up here.
+    class DenseLinear
+    {
+    public:
+        Matrix3 matrix;
+
+        DenseLinear() = default;
+        explicit DenseLinear(const Matrix3& matrix) : matrix(matrix) {}
+
+        Vector3 operator*(const Vector3& v) const
+        {
+            return matrix * v;
+        }
+
+        [[nodiscard]] DenseLinear inverse() const
+        {
+            return DenseLinear(matrix.inverse());
+        }
+
+        [[nodiscard]] Matrix3 to_matrix3() const
+        {
+            return matrix;
+        }
+
+        [[nodiscard]] Matrix4 to_matrix4() const
+        {
+            return Matrix4(matrix);
+        }
+    };
+
+    class Translation
+    {
+    public:
+        Vector3 offset;
+
+        Translation() = default;
+        explicit Translation(const Vector3& offset) : offset(offset) {}
+
+        Vector3 operator*(const Vector3& v) const
+        {
+            return v + offset;
+        }
+
+        [[nodiscard]] Translation inverse() const
+        {
+            return Translation(offset * static_cast<real>(-1.0));
+        }
+
+        [[nodiscard]] Matrix4 to_matrix4() const
+        {
+            return Matrix4::translate(offset);
+        }
+    };
+
+    template <typename T> struct is_linear_transform : std::false_type {};
+    template <typename Basis> struct is_linear_transform<Rotation<Basis>> : std::true_type {};
+    template <typename Basis> struct is_linear_transform<ScaledRotation<Basis>> : std::true_type {};
+    template <> struct is_linear_transform<UniformScale> : std::true_type {};
+    template <> struct is_linear_transform<Scale> : std::true_type {};
+    template <> struct is_linear_transform<DenseLinear> : std::true_type {};
+    template <> struct is_linear_transform<Matrix3> : std::true_type {};
+    template <typename T> constexpr bool is_linear_transform_v = is_linear_transform<T>::value;
+
+    namespace detail
+    {
+        inline const Matrix3& dense(const Matrix3& linear)
+        {
+            return linear;
+        }
+
+        template <typename Linear>
+        Matrix3 dense(const Linear& linear)
+        {
+            return linear.to_matrix3();
+        }
+
+        // Whether inverse() returns linear unchanged.
+        template <typename Basis>
+        bool singular(const Rotation<Basis>&)
+        {
+            return false;
+        }
+
+        template <typename Basis>
+        bool singular(const ScaledRotation<Basis>& linear)
+        {
+            return std::abs(linear.factor) < REAL_EPSILON;
+        }
+
+        inline bool singular(const UniformScale& linear)
+        {
+            return std::abs(linear.factor) < REAL_EPSILON;
+        }
+
+        inline bool singular(const Scale& linear)
+        {
+            return std::min({std::abs(linear.factors.x), std::abs(linear.factors.y), std::abs(linear.factors.z)}) < REAL_EPSILON;
+        }
+
+        inline bool singular(const DenseLinear& linear)
+        {
+            return std::abs(linear.matrix.determinant()) < REAL_EPSILON;
+        }
+
+        inline bool singular(const Matrix3& linear)
+        {
+            return std::abs(linear.determinant()) < REAL_EPSILON;
+        }
+    }
+
+    // x -> linear * x + translation.
+    template <typename Linear>
+    class Affine
+    {
+        static_assert(is_linear_transform_v<Linear>, "Affine needs a linear transform type");
+
+    public:
+        Linear linear;
+        Vector3 translation;
+
+        Affine() = default;
+        Affine(const Linear& linear, const Vector3& translation) : linear(linear), translation(translation) {}
+
+        Vector3 operator*(const Vector3& v) const
+        {
+            return linear * v + translation;
+        }
+
+        [[nodiscard]] Affine inverse() const
+        {
+            if (detail::singular(linear)) return *this;
+            const Linear inv = linear.inverse();
+            return Affine(inv, (inv * translation) * static_cast<real>(-1.0));
+        }
+
+        [[nodiscard]] Matrix4 to_matrix4() const
+        {
+            Matrix4 result(detail::dense(linear));
+            result.m[0][3] = translation.x;
+            result.m[1][3] = translation.y;
+            result.m[2][3] = translation.z;
+            return result;
+        }
+    };
+
+    template <typename Basis = Quaternion> using Rigid = Affine<Rotation<Basis>>;
+    template <typename Basis = Quaternion> using Similarity = Affine<ScaledRotation<Basis>>;
+
+    // Linear parts. Rotations with different bases meet in Matrix3.
+    template <typename Basis>
+    Rotation<Basis> operator*(const Rotation<Basis>& a, const Rotation<Basis>& b)
+    {
+        return Rotation<Basis>(a.basis * b.basis);
+    }
+
+    inline Rotation<Matrix3> operator*(const Rotation<Quaternion>& a, const Rotation<Matrix3>& b)
+    {
+        return Rotation<Matrix3>(a.to_matrix3() * b.basis);
+    }
+
+    inline Rotation<Matrix3> operator*(const Rotation<Matrix3>& a, const Rotation<Quaternion>& b)
+    {
+        return Rotation<Matrix3>(a.basis * b.to_matrix3());
+    }
+
+    inline UniformScale operator*(const UniformScale& a, const UniformScale& b)
+    {
+        return UniformScale(a.factor * b.factor);
+    }
+
+    inline Scale operator*(const Scale& a, const Scale& b)
+    {
+        return Scale(Vector3(a.factors.x * b.factors.x, a.factors.y * b.factors.y, a.factors.z * b.factors.z));
+    }
+
+    inline Scale operator*(const UniformScale& a, const Scale& b)
+    {
+        return Scale(b.factors * a.factor);
+    }
+
+    inline Scale operator*(const Scale& a, const UniformScale& b)
+    {
+        return Scale(a.factors * b.factor);
+    }
+
+    template <typename Basis>
+    ScaledRotation<Basis> operator*(const Rotation<Basis>& a, const UniformScale& b)
+    {
+        return ScaledRotation<Basis>(a, b.factor);
+    }
+
+    template <typename Basis>
+    ScaledRotation<Basis> operator*(const UniformScale& a, const Rotation<Basis>& b)
+    {
+        return ScaledRotation<Basis>(b, a.factor);
+    }
+
+    template <typename Basis>
+    ScaledRotation<Basis> operator*(const ScaledRotation<Basis>& a, const UniformScale& b)
+    {
+        return ScaledRotation<Basis>(a.rotation, a.factor * b.factor);
+    }
+
+    template <typename Basis>
+    ScaledRotation<Basis> operator*(const UniformScale& a, const ScaledRotation<Basis>& b)
+    {
+        return ScaledRotation<Basis>(b.rotation, a.factor * b.factor);
+    }
+
+    template <typename Basis>
+    ScaledRotation<Basis> operator*(const ScaledRotation<Basis>& a, const Rotation<Basis>& b)
+    {
+        return ScaledRotation<Basis>(a.rotation * b, a.factor);
+    }
+
+    template <typename Basis>
+    ScaledRotation<Basis> operator*(const Rotation<Basis>& a, const ScaledRotation<Basis>& b)
+    {
+        return ScaledRotation<Basis>(a * b.rotation, b.factor);
+    }
+
+    template <typename Basis>
+    ScaledRotation<Basis> operator*(const ScaledRotation<Basis>& a, const ScaledRotation<Basis>& b)
+    {
+        return ScaledRotation<Basis>(a.rotation * b.rotation, a.factor * b.factor);
+    }
+
+    inline ScaledRotation<Matrix3> operator*(const ScaledRotation<Quaternion>& a, const ScaledRotation<Matrix3>& b)
+    {
+        return ScaledRotation<Matrix3>(a.rotation * b.rotation, a.factor * b.factor);
+    }
+
+    inline ScaledRotation<Matrix3> operator*(const ScaledRotation<Matrix3>& a, const ScaledRotation<Quaternion>& b)
+    {
+        return ScaledRotation<Matrix3>(a.rotation * b.rotation, a.factor * b.factor);
+    }
+
+    inline ScaledRotation<Matrix3> operator*(const ScaledRotation<Quaternion>& a, const Rotation<Matrix3>& b)
+    {
+        return ScaledRotation<Matrix3>(a.rotation * b, a.factor);
+    }
+
+    inline ScaledRotation<Matrix3> operator*(const Rotation<Matrix3>& a, const ScaledRotation<Quaternion>& b)
+    {
+        return ScaledRotation<Matrix3>(a * b.rotation, b.factor);
+    }
+
+    inline ScaledRotation<Matrix3> operator*(const ScaledRotation<Matrix3>& a, const Rotation<Quaternion>& b)
+    {
+        return ScaledRotation<Matrix3>(a.rotation * b, a.factor);
+    }
+
+    inline ScaledRotation<Matrix3> operator*(const Rotation<Quaternion>& a, const ScaledRotation<Matrix3>& b)
+    {
+        return ScaledRotation<Matrix3>(a * b.rotation, b.factor);
+    }
+
+    // Every other pair of linear parts (a rotation with a non-uniform scale, anything with a
+    // Matrix3 or a DenseLinear) has no cheaper closed form than the dense product.
+    template <typename A, typename B>
+        requires is_linear_transform_v<A> && is_linear_transform_v<B>
+    DenseLinear operator*(const A& a, const B& b)
+    {
+        return DenseLinear(detail::dense(a) * detail::dense(b));
+    }
+
+    // Translations, applied right to left like the matrices they stand for.
+    inline Translation operator*(const Translation& a, const Translation& b)
+    {
+        return Translation(a.offset + b.offset);
+    }
+
+    template <typename Linear>
+        requires is_linear_transform_v<Linear>
+    Affine<Linear> operator*(const Translation& a, const Linear& b)
+    {
+        return Affine<Linear>(b, a.offset);
+    }
+
+    template <typename Linear>
+        requires is_linear_transform_v<Linear>
+    Affine<Linear> operator*(const Linear& a, const Translation& b)
+    {
+        return Affine<Linear>(a, a * b.offset);
+    }
+
+    template <typename Linear>
+    Affine<Linear> operator*(const Translation& a, const Affine<Linear>& b)
+    {
+        return Affine<Linear>(b.linear, a.offset + b.translation);
+    }
+
+    template <typename Linear>
+    Affine<Linear> operator*(const Affine<Linear>& a, const Translation& b)
+    {
+        return Affine<Linear>(a.linear, a.linear * b.offset + a.translation);
+    }
+
+    template <typename LinearA, typename LinearB>
+        requires is_linear_transform_v<LinearB>
+    auto operator*(const Affine<LinearA>& a, const LinearB& b)
+    {
+        using Linear = decltype(a.linear * b);
+        return Affine<Linear>(a.linear * b, a.translation);
+    }
+
+    template <typename LinearA, typename LinearB>
+        requires is_linear_transform_v<LinearA>
+    auto operator*(const LinearA& a, const Affine<LinearB>& b)
+    {
+        using Linear = decltype(a * b.linear);
+        return Affine<Linear>(a * b.linear, a * b.translation);
+    }
+
+    template <typename LinearA, typename LinearB>
+    auto operator*(const Affine<LinearA>& a, const Affine<LinearB>& b)
+    {
+        using Linear = decltype(a.linear * b.linear);
+        return Affine<Linear>(a.linear * b.linear, a.linear * b.translation + a.translation);
+    }
+}
+
+#endif //LINKIT_TRANSFORMS_H
@@ -0,0 +1,132 @@
+#ifndef LINKIT_VERTEX_WELD_H
+#define LINKIT_VERTEX_WELD_H
+#include "precision.h"
+#include "vector3.h"
+#include "parallel.h"
+#include "spatial_hash.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace linkit
+{
+    namespace detail
+    {
+        // Lock-free union-find over a parent array. Roots are always linked under the smaller
+        // index, so every set's root is its lowest vertex index whatever order the unions ran in.
+        inline std::uint32_t weld_find(std::vector<std::uint32_t>& parent, std::uint32_t x)
+        {
+            for (;;)
+            {
+                std::uint32_t p = std::atomic_ref(parent[x]).load(std::memory_order_relaxed);
+                if (p == x) return x;
+                const std::uint32_t grandparent = std::atomic_ref(parent[p]).load(std::memory_order_relaxed);
+                // Path halving; only ever moves x closer to its root
+                if (grandparent != p)
+                    std::atomic_ref(parent[x]).compare_exchange_weak(p, grandparent, std::memory_order_relaxed);
+                x = grandparent;
+            }
+        }
+
+        inline void weld_unite(std::vector<std::uint32_t>& parent, std::uint32_t a, std::uint32_t b)
+        {
+            for (;;)
+            {
+                a = weld_find(parent, a);
+                b = weld_find(parent, b);
+                if (a == b) return;
+                if (a > b) std::swap(a, b);
+                std::uint32_t expected = b;
+                if (std::atomic_ref(parent[b]).compare_exchange_strong(expected, a, std::memory_order_relaxed))
+                    return;
+            }
+        }
+    }
+
+    // Merges vertices closer than tolerance. Nearby vertices are found through a spatial hash
+    // with tolerance-sized cells, so the cost is linear in the vertex count. Merging is
+    // transitive: a chain of vertices each within tolerance of the next collapses to one vertex.
+    // Each welded vertex keeps the position of the lowest-indexed vertex it absorbed, and welded
+    // vertices appear in the order of those indices, so the result does not depend on threading.
+    //
+    // remap receives, for every input vertex, its index in welded. Returns the welded count.
+    inline std::size_t weld_vertices(const std::span<const Vector3> positions, std::vector<std::uint32_t>& remap,
+                                     std::vector<Vector3>& welded, const real tolerance = REAL_EPSILON)
+    {
+        const std::size_t n = positions.size();
+        remap.resize(n);
+        welded.clear();
+        if (n == 0) return 0;
+
+        std::vector<std::uint32_t> parent(n);
+        parallel_for(n, 65536, [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                parent[i] = static_cast<std::uint32_t>(i);
+        });
+
+        {
+            // Cells a few times larger than the tolerance let most vertices look at their own cell
+            // only. A zero tolerance would put every vertex into one cell.
+            const real radius = std::max(tolerance, REAL_EPSILON);
+            SpatialHashGrid grid(4 * radius);
+            grid.build(positions);
+            parallel_for(n, 4096, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    grid.for_each_neighbor(positions[i], radius, [&](const std::uint32_t j, real) {
+                        if (j > i) detail::weld_unite(parent, static_cast<std::uint32_t>(i), j);
+                    });
+                }
+            });
+        }
+
+        // Flatten to roots and count the roots per chunk
+        const std::size_t chunks = parallel_chunk_count(n, 65536);
+        std::vector<std::size_t> chunk_offset(chunks + 1, 0);
+        parallel_for_chunks(n, chunks, [&](const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+            std::size_t roots = 0;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const std::uint32_t root = detail::weld_find(parent, static_cast<std::uint32_t>(i));
+                std::atomic_ref(parent[i]).store(root, std::memory_order_relaxed);
+                roots += root == i;
+            }
+            chunk_offset[chunk + 1] = roots;
+        });
+        for (std::size_t c = 0; c < chunks; ++c)
+            chunk_offset[c + 1] += chunk_offset[c];
+
+        // Roots take consecutive slots in index order
+        welded.resize(chunk_offset[chunks]);
+        parallel_for_chunks(n, chunks, [&](const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+            std::size_t slot = chunk_offset[chunk];
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                if (parent[i] != i) continue;
+                remap[i] = static_cast<std::uint32_t>(slot);
+                welded[slot++] = positions[i];
+            }
+        });
+
+        // A root always precedes its members, but may sit in another chunk
+        parallel_for(n, 65536, [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                if (parent[i] != i) remap[i] = remap[parent[i]];
+        });
+        return welded.size();
+    }
+
+    // Rewrites mesh indices through a remap table from weld_vertices().
+    inline void remap_indices(const std::span<std::uint32_t> indices, const std::span<const std::uint32_t> remap)
+    {
+        parallel_for(indices.size(), 65536, [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                indices[i] = remap[indices[i]];
+        });
+    }
+}
+
+#endif //LINKIT_VERTEX_WELD_H
@@ -0,0 +1,380 @@
+// Differential accuracy test: each fast path against a long double reference on random and
+// adversarial inputs. Prints max/mean ULP error and throughput per case and exits non-zero if
+// any case with a budget exceeds it. Run by CTest as linkit_accuracy.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <span>
+#include <vector>
+#include "linkit/accuracy.h"
+#include "linkit/matrix3.h"
+#include "linkit/matrix3_batch.h"
+#include "linkit/matrix4.h"
+#include "linkit/quaternion.h"
+using namespace linkit;
+
+namespace
+{
+    using Quad = long double;
+
+    // Gauss-Jordan inverse with partial pivoting in long double. Mirrors the fast paths'
+    // singular test: when |det| < REAL_EPSILON the input is returned unchanged.
+    template <int N>
+    void reference_inverse(const real (&in)[N][N], Quad (&out)[N][N])
+    {
+        Quad a[N][N], inv[N][N];
+        for (int i = 0; i < N; ++i)
+            for (int j = 0; j < N; ++j)
+            {
+                a[i][j] = in[i][j];
+                inv[i][j] = i == j ? 1 : 0;
+            }
+        Quad det = 1;
+        for (int col = 0; col < N; ++col)
+        {
+            int pivot = col;
+            for (int row = col + 1; row < N; ++row)
+                if (std::abs(a[row][col]) > std::abs(a[pivot][col])) pivot = row;
+            if (pivot != col)
+            {
+                for (int j = 0; j < N; ++j)
+                {
+                    std::swap(a[pivot][j], a[col][j]);
+                    std::swap(inv[pivot][j], inv[col][j]);
+                }
+                det = -det;
+            }
+            det *= a[col][col];
+            if (a[col][col] == 0) break;
+            const Quad scale = 1 / a[col][col];
+            for (int j = 0; j < N; ++j)
+            {
+                a[col][j] *= scale;
+                inv[col][j] *= scale;
+            }
+            for (int row = 0; row < N; ++row)
+            {
+                if (row == col) continue;
+                const Quad f = a[row][col];
+                for (int j = 0; j < N; ++j)
+                {
+                    a[row][j] -= f * a[col][j];
+                    inv[row][j] -= f * inv[col][j];
+                }
+            }
+        }
+        const bool singular = std::abs(det) < REAL_EPSILON;
+        for (int i = 0; i < N; ++i)
+            for (int j = 0; j < N; ++j)
+                out[i][j] = singular ? static_cast<Quad>(in[i][j]) : inv[i][j];
+    }
+
+    // Normwise: every entry in ULPs of the largest reference entry
+    template <int N>
+    void compare_matrix(const real (&value)[N][N], const Quad (&reference)[N][N], AccuracyStats& stats, const std::size_t index)
+    {
+        Quad scale = 0;
+        for (int i = 0; i < N; ++i)
+            for (int j = 0; j < N; ++j)
+                scale = std::max(scale, std::abs(reference[i][j]));
+        for (int i = 0; i < N; ++i)
+            for (int j = 0; j < N; ++j)
+                stats.add(ulp_error(value[i][j], reference[i][j], scale), index);
+    }
+
+    void compare_quaternion(const Quaternion& value, const Quad (&reference)[4], AccuracyStats& stats, const std::size_t index)
+    {
+        const Quad scale = std::max({std::abs(reference[0]), std::abs(reference[1]), std::abs(reference[2]), std::abs(reference[3])});
+        stats.add(ulp_error(value.w, reference[0], scale), index);
+        stats.add(ulp_error(value.x, reference[1], scale), index);
+        stats.add(ulp_error(value.y, reference[2], scale), index);
+        stats.add(ulp_error(value.z, reference[3], scale), index);
+    }
+
+    void compare_vector(const Vector3& value, const Quad (&reference)[3], AccuracyStats& stats, const std::size_t index)
+    {
+        const Quad scale = std::max({std::abs(reference[0]), std::abs(reference[1]), std::abs(reference[2])});
+        stats.add(ulp_error(value.x, reference[0], scale), index);
+        stats.add(ulp_error(value.y, reference[1], scale), index);
+        stats.add(ulp_error(value.z, reference[2], scale), index);
+    }
+
+    struct QuaternionPair
+    {
+        Quaternion a, b;
+        real t;
+    };
+
+    // Two independent systems, so the batched kernels run with both lanes filled
+    struct LinearSystemPair
+    {
+        Matrix3 m[2];
+        Vector3 rhs[2];
+    };
+
+    struct Matrix3Pair
+    {
+        Matrix3 m[2];
+    };
+
+    struct Vector3Pair
+    {
+        Vector3 v[2];
+    };
+}
+
+int main()
+{
+    std::mt19937_64 rng(0x6c696e6b6974ull);
+    std::uniform_real_distribution<real> uniform(-1, 1);
+    const auto random_vector = [&] { return Vector3(uniform(rng), uniform(rng), uniform(rng)); };
+    const auto random_rotation = [&] {
+        Vector3 axis = random_vector();
+        if (axis.magnitude_squared() < static_cast<real>(0.01)) axis = Vector3(0, 0, 1);
+        return Quaternion(uniform(rng) * PI, axis);
+    };
+    constexpr std::size_t n = 20000;
+    std::vector<AccuracyReport> reports;
+
+    // real_sqrt: correctly rounded, so within half an ULP of the exact root
+    {
+        std::vector<real> random(n), adversarial;
+        for (real& x : random) x = std::abs(uniform(rng)) * 1e6;
+        for (int e = -1074; e <= 1023; e += 7) adversarial.push_back(std::ldexp(static_cast<real>(1), e));
+        for (int i = 1; i < 2000; ++i)
+        {
+            adversarial.push_back(std::numeric_limits<real>::denorm_min() * i * 977);
+            adversarial.push_back(1 + i * std::numeric_limits<real>::epsilon());
+            adversarial.push_back(std::numeric_limits<real>::max() / i);
+        }
+        std::vector<real> out(std::max(random.size(), adversarial.size()));
+        const auto fast = [](const real x) { return real_sqrt(x); };
+        const auto compare = [](const real x, const real value, AccuracyStats& stats, const std::size_t i) {
+            const Quad reference = std::sqrt(static_cast<Quad>(x));
+            stats.add(ulp_error(value, reference, reference), i);
+        };
+        reports.push_back(measure_accuracy<real, real>("real_sqrt random", random, out, fast, compare, 0.5001L));
+        reports.push_back(measure_accuracy<real, real>("real_sqrt powers/denormal/extreme", adversarial, out, fast, compare, 0.5001L));
+    }
+
+    // Unit results whose squared magnitude under- or overflows real: normalize then falls back to
+    // a zero, identity or unchanged result instead of a unit one. 2^(digits+2) ULPs of a unit
+    // scale is the largest error a finite result no longer than 2 can have, so this budget only
+    // rejects non-finite or blown-up output.
+    const long double degenerate_budget = std::ldexp(1.0L, std::numeric_limits<real>::digits + 2);
+    const real tiny_scale = std::sqrt(std::numeric_limits<real>::min()) / 1024;
+    const real huge_scale = std::sqrt(std::numeric_limits<real>::max()) * 1024;
+
+    // Quaternion::normalize
+    {
+        std::vector<Quaternion> random(n), tiny(n), huge(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            random[i] = Quaternion(uniform(rng), uniform(rng), uniform(rng), uniform(rng));
+            tiny[i] = Quaternion(uniform(rng) * tiny_scale, uniform(rng) * tiny_scale, uniform(rng) * tiny_scale, uniform(rng) * tiny_scale);
+            huge[i] = Quaternion(uniform(rng) * huge_scale, uniform(rng) * huge_scale, uniform(rng) * huge_scale, uniform(rng) * huge_scale);
+        }
+        std::vector<Quaternion> out(n);
+        const auto fast = [](Quaternion q) {
+            q.normalize();
+            return q;
+        };
+        const auto compare = [](const Quaternion& q, const Quaternion& value, AccuracyStats& stats, const std::size_t i) {
+            const Quad w = q.w, x = q.x, y = q.y, z = q.z;
+            const Quad magnitude = std::sqrt(w * w + x * x + y * y + z * z);
+            const Quad reference[4] = {w / magnitude, x / magnitude, y / magnitude, z / magnitude};
+            compare_quaternion(value, reference, stats, i);
+        };
+        reports.push_back(measure_accuracy<Quaternion, Quaternion>("Quaternion::normalize random", random, out, fast, compare, 4));
+        reports.push_back(measure_accuracy<Quaternion, Quaternion>("Quaternion::normalize tiny", tiny, out, fast, compare,
+                                                                   degenerate_budget));
+        reports.push_back(measure_accuracy<Quaternion, Quaternion>("Quaternion::normalize huge", huge, out, fast, compare,
+                                                                   degenerate_budget));
+    }
+
+    // Vector3::normalize: random vectors, and denormal ones whose squared magnitude is zero
+    {
+        std::vector<Vector3> random(n), denormal(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            random[i] = random_vector();
+            const auto component = [&] {
+                return std::numeric_limits<real>::denorm_min() * static_cast<real>(std::uniform_int_distribution<int>(-4096, 4096)(rng));
+            };
+            denormal[i] = Vector3(component(), component(), component());
+            if (denormal[i].x == 0) denormal[i].x = std::numeric_limits<real>::denorm_min();
+        }
+        std::vector<Vector3> out(n);
+        const auto fast = [](const Vector3& v) { return v.normalized(); };
+        const auto compare = [](const Vector3& v, const Vector3& value, AccuracyStats& stats, const std::size_t i) {
+            const Quad x = v.x, y = v.y, z = v.z;
+            const Quad magnitude = std::sqrt(x * x + y * y + z * z);
+            const Quad reference[3] = {x / magnitude, y / magnitude, z / magnitude};
+            compare_vector(value, reference, stats, i);
+        };
+        reports.push_back(measure_accuracy<Vector3, Vector3>("Vector3::normalize random", random, out, fast, compare, 4));
+        reports.push_back(measure_accuracy<Vector3, Vector3>("Vector3::normalize denormal", denormal, out, fast, compare, degenerate_budget));
+    }
+
+    // Quaternion::slerp: random pairs, pairs a few ULPs to a few degrees apart, and near-antipodal
+    // pairs (shorter arc taken). The reference measures the angle with atan2 so it stays exact
+    // for nearby orientations, where acos of the dot product loses half the digits.
+    {
+        std::vector<QuaternionPair> random(n), nearby(n), antipodal(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            random[i].a = random_rotation();
+            random[i].b = random_rotation();
+            nearby[i].a = random_rotation();
+            nearby[i].b = nearby[i].a * Quaternion(std::pow(static_cast<real>(10), 8 * uniform(rng) - 10), random_vector());
+            nearby[i].b.normalize();
+            antipodal[i].a = random_rotation();
+            const Quaternion b = antipodal[i].a * Quaternion(uniform(rng) * static_cast<real>(0.2), random_vector());
+            antipodal[i].b = Quaternion(-b.w, -b.x, -b.y, -b.z);
+            random[i].t = (uniform(rng) + 1) / 2;
+            nearby[i].t = (uniform(rng) + 1) / 2;
+            antipodal[i].t = (uniform(rng) + 1) / 2;
+        }
+        std::vector<Quaternion> out(n);
+        const auto fast = [](const QuaternionPair& pair) { return Quaternion::slerp(pair.a, pair.b, pair.t); };
+        const auto compare = [](const QuaternionPair& pair, const Quaternion& value, AccuracyStats& stats, const std::size_t i) {
+            const Quad a[4] = {pair.a.w, pair.a.x, pair.a.y, pair.a.z};
+            Quad b[4] = {pair.b.w, pair.b.x, pair.b.y, pair.b.z};
+            if (a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] < 0)
+                for (Quad& c : b) c = -c;
+            Quad difference = 0, sum = 0;
+            for (int k = 0; k < 4; ++k)
+            {
+                difference += (a[k] - b[k]) * (a[k] - b[k]);
+                sum += (a[k] + b[k]) * (a[k] + b[k]);
+            }
+            const Quad angle = 2 * std::atan2(std::sqrt(difference), std::sqrt(sum));
+            Quad wa = 1 - pair.t, wb = pair.t;
+            if (angle > 0)
+            {
+                wa = std::sin((1 - pair.t) * angle) / std::sin(angle);
+                wb = std::sin(pair.t * angle) / std::sin(angle);
+            }
+            Quad reference[4];
+            for (int k = 0; k < 4; ++k) reference[k] = a[k] * wa + b[k] * wb;
+            compare_quaternion(value, reference, stats, i);
+        };
+        reports.push_back(measure_accuracy<QuaternionPair, Quaternion>("Quaternion::slerp random", random, out, fast, compare, 16));
+        reports.push_back(measure_accuracy<QuaternionPair, Quaternion>("Quaternion::slerp nearby (<1e-2 rad)", nearby, out, fast, compare, 16));
+        reports.push_back(measure_accuracy<QuaternionPair, Quaternion>("Quaternion::slerp near-antipodal", antipodal, out, fast, compare, 16));
+    }
+
+    // Matrix3::invert
+    {
+        std::vector<Matrix3> random(n), ill(n), singular(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const Matrix3 u = random_rotation().to_matrix3();
+            const Matrix3 v = random_rotation().to_matrix3();
+            random[i] = u * Matrix3::scale(Vector3(1 + uniform(rng) * static_cast<real>(0.5), 1, 1 - uniform(rng) * static_cast<real>(0.5))) * v;
+            // Condition number 1e8 at determinant 1, so the singular test does not trigger
+            ill[i] = u * Matrix3::scale(Vector3(1e4, 1, 1e-4)) * v;
+            singular[i] = u * Matrix3::scale(Vector3(1 + uniform(rng), 1 + uniform(rng), 0)) * v;
+        }
+        std::vector<Matrix3> out(n);
+        const auto fast = [](const Matrix3& m) { return m.inverse(); };
+        const auto compare = [](const Matrix3& m, const Matrix3& value, AccuracyStats& stats, const std::size_t i) {
+            Quad reference[3][3];
+            reference_inverse<3>(m.m, reference);
+            compare_matrix<3>(value.m, reference, stats, i);
+        };
+        reports.push_back(measure_accuracy<Matrix3, Matrix3>("Matrix3::invert well-conditioned", random, out, fast, compare, 16));
+        // Forward error grows with the condition number; the loose budget catches a blown-up or
+        // non-finite inverse rather than lost digits
+        reports.push_back(measure_accuracy<Matrix3, Matrix3>("Matrix3::invert cond 1e8", ill, out, fast, compare, 1e12L));
+        reports.push_back(measure_accuracy<Matrix3, Matrix3>("Matrix3::invert singular (unchanged)", singular, out, fast, compare, 1));
+
+        // Batched invert and solve on the same inputs, two systems per call so both lanes are
+        // live. The timings include a parallel_for per call; the benchmarks measure throughput.
+        std::vector<Matrix3Pair> random_pairs(n / 2), singular_pairs(n / 2);
+        std::vector<LinearSystemPair> systems(n / 2);
+        for (std::size_t i = 0; i < n / 2; ++i)
+            for (int l = 0; l < 2; ++l)
+            {
+                random_pairs[i].m[l] = random[2 * i + l];
+                singular_pairs[i].m[l] = singular[2 * i + l];
+                systems[i].m[l] = random[2 * i + l];
+                systems[i].rhs[l] = random_vector();
+            }
+        std::vector<Matrix3Pair> pair_out(n / 2);
+        const auto batch_invert = [](const Matrix3Pair& pair) {
+            Matrix3Pair result;
+            SolveStatus status[2];
+            invert(pair.m, result.m, status);
+            return result;
+        };
+        const auto compare_pair = [](const Matrix3Pair& pair, const Matrix3Pair& value, AccuracyStats& stats, const std::size_t i) {
+            for (int l = 0; l < 2; ++l)
+            {
+                Quad reference[3][3];
+                reference_inverse<3>(pair.m[l].m, reference);
+                compare_matrix<3>(value.m[l].m, reference, stats, i);
+            }
+        };
+        reports.push_back(measure_accuracy<Matrix3Pair, Matrix3Pair>("Matrix3 batch invert well-conditioned", random_pairs, pair_out,
+                                                                     batch_invert, compare_pair, 16));
+        reports.push_back(measure_accuracy<Matrix3Pair, Matrix3Pair>("Matrix3 batch invert singular", singular_pairs, pair_out,
+                                                                     batch_invert, compare_pair, 1));
+
+        std::vector<Vector3Pair> solutions(n / 2);
+        const auto batch_solve = [](const LinearSystemPair& pair) {
+            Vector3Pair result{{pair.rhs[0], pair.rhs[1]}};
+            SolveStatus status[2];
+            solve(pair.m, result.v, status);
+            return result;
+        };
+        const auto compare_solution = [](const LinearSystemPair& pair, const Vector3Pair& value, AccuracyStats& stats, const std::size_t i) {
+            for (int l = 0; l < 2; ++l)
+            {
+                Quad inverse[3][3];
+                reference_inverse<3>(pair.m[l].m, inverse);
+                const Quad b[3] = {pair.rhs[l].x, pair.rhs[l].y, pair.rhs[l].z};
+                Quad reference[3];
+                for (int r = 0; r < 3; ++r) reference[r] = inverse[r][0] * b[0] + inverse[r][1] * b[1] + inverse[r][2] * b[2];
+                compare_vector(value.v[l], reference, stats, i);
+            }
+        };
+        reports.push_back(measure_accuracy<LinearSystemPair, Vector3Pair>("Matrix3 batch solve well-conditioned", systems, solutions,
+                                                                          batch_solve, compare_solution, 16));
+    }
+
+    // Matrix4::invert
+    {
+        std::vector<Matrix4> random(n), ill(n), singular(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const Quaternion rotation = random_rotation();
+            const Vector3 position = random_vector() * 10;
+            random[i] = Matrix4::object_transform_matrix(position, rotation,
+                                                         Vector3(1 + uniform(rng) * static_cast<real>(0.5), 1, 1 - uniform(rng) * static_cast<real>(0.5)));
+            ill[i] = Matrix4::object_transform_matrix(position, rotation, Vector3(1e4, 1, 1e-4));
+            singular[i] = Matrix4::object_transform_matrix(position, rotation, Vector3(1 + uniform(rng), 0, 1));
+        }
+        std::vector<Matrix4> out(n);
+        const auto fast = [](const Matrix4& m) { return m.inverse(); };
+        const auto compare = [](const Matrix4& m, const Matrix4& value, AccuracyStats& stats, const std::size_t i) {
+            Quad reference[4][4];
+            reference_inverse<4>(m.m, reference);
+            compare_matrix<4>(value.m, reference, stats, i);
+        };
+        reports.push_back(measure_accuracy<Matrix4, Matrix4>("Matrix4::invert well-conditioned TRS", random, out, fast, compare, 16));
+        // The TRS structure keeps this close to the well-conditioned case
+        reports.push_back(measure_accuracy<Matrix4, Matrix4>("Matrix4::invert cond 1e8 TRS", ill, out, fast, compare, 64));
+        reports.push_back(measure_accuracy<Matrix4, Matrix4>("Matrix4::invert singular (unchanged)", singular, out, fast, compare, 1));
+    }
+
+    bool passed = true;
+    for (const AccuracyReport& report : reports)
+    {
+        std::printf("%s\n", report.to_string().c_str());
+        passed = passed && report.passed();
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+// Broadphase pair test: SweepAndPrune and UniformGridBroadphase against a brute force
+// AABB::overlaps pass on random boxes, with far outliers, huge extents and touching faces
+// mixed in. Both broadphases must report exactly the brute force pair set, including after
+// the boxes move. Run by CTest as linkit_broadphase.
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+#include "linkit/aabb.h"
+#include "linkit/broadphase.h"
+using namespace linkit;
+
+namespace
+{
+    std::vector<BodyPair> sorted(std::vector<BodyPair> pairs)
+    {
+        std::sort(pairs.begin(), pairs.end(), [](const BodyPair& l, const BodyPair& r) {
+            return l.a != r.a ? l.a < r.a : l.b < r.b;
+        });
+        return pairs;
+    }
+
+    std::vector<BodyPair> brute_force(const std::span<const AABB> boxes)
+    {
+        std::vector<BodyPair> pairs;
+        for (std::uint32_t i = 0; i < boxes.size(); ++i)
+            for (std::uint32_t j = i + 1; j < boxes.size(); ++j)
+                if (boxes[i].overlaps(boxes[j])) pairs.push_back(BodyPair{i, j});
+        return pairs;
+    }
+
+    bool same_pairs(const std::vector<BodyPair>& expected, const std::vector<BodyPair>& found)
+    {
+        const std::vector<BodyPair> s = sorted(found);
+        if (s.size() != expected.size()) return false;
+        for (std::size_t i = 0; i < s.size(); ++i)
+            if (s[i].a != expected[i].a || s[i].b != expected[i].b) return false;
+        return true;
+    }
+
+    struct Scene
+    {
+        std::string name;
+        std::vector<AABB> boxes;
+    };
+
+    AABB random_box(std::mt19937& rng, const real spread, const real max_size)
+    {
+        std::uniform_real_distribution<real> position(-spread, spread);
+        std::uniform_real_distribution<real> size(0, max_size);
+        const Vector3 min(position(rng), position(rng), position(rng));
+        return AABB(min, min + Vector3(size(rng), size(rng), size(rng)));
+    }
+
+    std::vector<AABB> random_boxes(std::mt19937& rng, const std::size_t count, const real spread, const real max_size)
+    {
+        std::vector<AABB> boxes(count);
+        for (AABB& box : boxes)
+            box = random_box(rng, spread, max_size);
+        return boxes;
+    }
+
+    // Moves every box by a small random offset so the next SweepAndPrune update takes the
+    // incremental insertion sort path.
+    void jitter(std::mt19937& rng, std::vector<AABB>& boxes, const real amount)
+    {
+        std::uniform_real_distribution<real> offset(-amount, amount);
+        for (AABB& box : boxes)
+        {
+            const Vector3 d(offset(rng), offset(rng), offset(rng));
+            box = AABB(box.min + d, box.max + d);
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(20240611);
+    std::vector<Scene> scenes;
+
+    scenes.push_back({"random", random_boxes(rng, 2000, 30, 4)});
+
+    {
+        Scene scene{"far outliers", random_boxes(rng, 1500, 20, 2)};
+        for (const real far : {static_cast<real>(1e6), static_cast<real>(-1e9), static_cast<real>(1e15)})
+            for (int i = 0; i < 20; ++i)
+            {
+                const AABB box = random_box(rng, 1, 1);
+                scene.boxes.emplace_back(box.min + Vector3(far, -far, far), box.max + Vector3(far, -far, far));
+            }
+        scenes.push_back(std::move(scene));
+    }
+
+    {
+        // Half the largest finite value, so the frame bounds reach the top of the range
+        const real huge = std::numeric_limits<real>::max() / 2;
+        Scene scene{"huge extents", random_boxes(rng, 1500, 20, 2)};
+        scene.boxes.emplace_back(Vector3(-huge, -huge, -huge), Vector3(huge, huge, huge));
+        scene.boxes.emplace_back(Vector3(-huge, 0, 0), Vector3(huge, 1, 1));
+        scene.boxes.emplace_back(Vector3(5, -huge, -huge), Vector3(6, huge, huge));
+        scene.boxes.emplace_back(Vector3(huge / 2, huge / 2, huge / 2), Vector3(huge, huge, huge));
+        scenes.push_back(std::move(scene));
+    }
+
+    {
+        Scene scene{"touching and degenerate", {}};
+        for (int x = 0; x < 12; ++x)
+            for (int y = 0; y < 12; ++y)
+                for (int z = 0; z < 12; ++z)
+                    scene.boxes.emplace_back(Vector3(x, y, z), Vector3(x + 1, y + 1, z + 1));
+        for (int i = 0; i < 50; ++i)
+        {
+            const Vector3 p(std::uniform_int_distribution<int>(0, 12)(rng), 3, 7);
+            scene.boxes.emplace_back(p, p);
+        }
+        scenes.push_back(std::move(scene));
+    }
+
+    bool passed = true;
+    for (Scene& scene : scenes)
+    {
+        SweepAndPrune sap;
+        for (int frame = 0; frame < 3; ++frame)
+        {
+            const std::vector<BodyPair> expected = brute_force(scene.boxes);
+            const bool sap_ok = same_pairs(expected, sap.update(scene.boxes));
+            bool grid_ok = true;
+            for (const real cell_size : {static_cast<real>(0.5), static_cast<real>(4), std::numeric_limits<real>::min()})
+            {
+                UniformGridBroadphase grid(cell_size);
+                grid_ok = grid_ok && same_pairs(expected, grid.update(scene.boxes));
+            }
+            std::printf("%-24s frame %d: %zu boxes, %zu pairs, sweep and prune %s, grid %s\n", scene.name.c_str(), frame,
+                        scene.boxes.size(), expected.size(), sap_ok ? "ok" : "MISMATCH", grid_ok ? "ok" : "MISMATCH");
+            passed = passed && sap_ok && grid_ok;
+            jitter(rng, scene.boxes, static_cast<real>(0.25));
+        }
+    }
+    return passed ? 0 : 1;
+}
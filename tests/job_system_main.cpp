@@ -0,0 +1,175 @@
+// Job system stress test: dependency ordering through JobSystem::schedule, parallel_for nested
+// inside worker jobs, and one TransformStore writer racing several readers. Each case prints
+// ok or FAILED and the program exits non-zero on any failure. Run by CTest as linkit_job_system.
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+#include "linkit/job_system.h"
+#include "linkit/parallel.h"
+#include "linkit/transform_store.h"
+using namespace linkit;
+
+namespace
+{
+    // Diamonds a -> (b, c) -> d plus a chain of jobs that each depend on the one before. Every
+    // job checks that its dependencies have already finished.
+    bool dependencies_run_in_order(JobSystem& jobs)
+    {
+        std::atomic<int> violations{0};
+
+        for (int round = 0; round < 500; ++round)
+        {
+            std::atomic<int> a_done{0}, b_done{0}, c_done{0}, d_done{0};
+            const JobHandle a = jobs.schedule([&] { a_done = 1; });
+            const JobHandle b = jobs.schedule([&] { if (!a_done) ++violations; b_done = 1; }, {a});
+            const JobHandle c = jobs.schedule([&] { if (!a_done) ++violations; c_done = 1; }, {a});
+            const JobHandle d = jobs.schedule([&] { if (!b_done || !c_done) ++violations; d_done = 1; }, {b, c});
+            jobs.wait(d);
+            if (!d_done) ++violations;
+        }
+
+        constexpr int chain_length = 2000;
+        std::vector<int> order;
+        order.reserve(chain_length);
+        JobHandle previous;
+        for (int i = 0; i < chain_length; ++i)
+            previous = jobs.schedule([&order, i] { order.push_back(i); }, {previous});
+        jobs.wait(previous);
+        for (int i = 0; i < chain_length; ++i)
+            if (i >= static_cast<int>(order.size()) || order[i] != i) ++violations;
+
+        return violations == 0;
+    }
+
+    // Outer jobs that each run an inner parallel_for and wait for it from a worker thread, on the
+    // same job system for even rows and through parallel.h for odd rows. Every index of every
+    // inner range must be visited exactly once.
+    bool nested_parallel_for_covers_ranges(JobSystem& jobs)
+    {
+        constexpr std::size_t outer = 64;
+        constexpr std::size_t inner = 4096;
+        std::vector<std::atomic<int>> visits(outer * inner);
+
+        for (int round = 0; round < 20; ++round)
+        {
+            for (std::atomic<int>& v : visits)
+                v = 0;
+
+            const JobHandle root = jobs.parallel_for(outer, 1, [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t o = begin; o < end; ++o)
+                {
+                    const auto visit = [&visits, o](const std::size_t b, const std::size_t e) {
+                        for (std::size_t i = b; i < e; ++i)
+                            visits[o * inner + i].fetch_add(1, std::memory_order_relaxed);
+                    };
+                    if (o % 2 == 0)
+                        jobs.wait(jobs.parallel_for(inner, 64, visit));
+                    else
+                        parallel_for(inner, 64, visit);
+                }
+            });
+            jobs.wait(root);
+
+            for (const std::atomic<int>& v : visits)
+                if (v != 1) return false;
+        }
+        return true;
+    }
+
+    // One writer publishes frames whose positions and orientations are uniform within the
+    // frame; readers check that no snapshot mixes two frames, that frames never go backwards and
+    // that interpolation only blends consecutive frames.
+    bool transform_store_readers_see_whole_frames(JobSystem&)
+    {
+        constexpr std::size_t count = 512;
+        constexpr std::size_t readers = 3;
+        constexpr int frames = 20000;
+        constexpr std::uint64_t min_reads = 5000;
+        TransformStore store(count, readers);
+        std::atomic<bool> stop{false};
+        std::atomic<int> violations{0};
+        std::atomic<std::uint64_t> reads{0};
+
+        const auto reader = [&] {
+            std::vector<Vector3> positions(count);
+            std::vector<Quaternion> orientations(count);
+            std::uint64_t last_frame = 0;
+            real last_interpolated = -1;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                {
+                    const TransformStore::Snapshot snapshot = store.acquire();
+                    if (snapshot.valid())
+                    {
+                        const real value = snapshot.positions()[0].x;
+                        const real w = snapshot.orientations()[0].w;
+                        for (std::size_t i = 0; i < count; ++i)
+                            if (snapshot.positions()[i].x != value || snapshot.orientations()[i].w != w) ++violations;
+                        if (snapshot.frame() < last_frame || value != static_cast<real>(snapshot.frame() - 1)) ++violations;
+                        last_frame = snapshot.frame();
+                    }
+                }
+
+                if (store.interpolate(std::numeric_limits<real>::max(), positions, orientations))
+                {
+                    const real value = positions[0].x;
+                    for (const Vector3& p : positions)
+                        if (p.x != value) ++violations;
+                    if (value < last_interpolated) ++violations;
+                    last_interpolated = value;
+                }
+                reads.fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (std::size_t r = 0; r < readers; ++r)
+            threads.emplace_back(reader);
+
+        for (int f = 0; f < frames || reads.load() < min_reads; ++f)
+        {
+            const TransformStore::WriteFrame frame = store.begin_write();
+            const Quaternion orientation(static_cast<real>(f) * static_cast<real>(0.001), Vector3(0, 1, 0));
+            for (Vector3& p : frame.positions)
+                p = Vector3(static_cast<real>(f), 0, 0);
+            for (Quaternion& q : frame.orientations)
+                q = orientation;
+            store.publish(static_cast<real>(f));
+        }
+        stop = true;
+        for (std::thread& t : threads)
+            t.join();
+
+        std::printf("  %llu reads across %zu readers\n", static_cast<unsigned long long>(reads.load()), readers);
+        return violations == 0;
+    }
+}
+
+int main()
+{
+    struct Case
+    {
+        const char* name;
+        bool (*run)(JobSystem&);
+    };
+    const Case cases[] = {
+        {"schedule with dependencies", dependencies_run_in_order},
+        {"nested parallel_for from workers", nested_parallel_for_covers_ranges},
+        {"TransformStore one writer, several readers", transform_store_readers_see_whole_frames},
+    };
+
+    // A fixed worker count so the cross-thread paths run even on a single core machine
+    JobSystem jobs(4);
+    bool passed = true;
+    for (const Case& c : cases)
+    {
+        const bool ok = c.run(jobs);
+        std::printf("%-44s %s\n", c.name, ok ? "ok" : "FAILED");
+        passed = passed && ok;
+    }
+    return passed ? 0 : 1;
+}
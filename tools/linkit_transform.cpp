@@ -0,0 +1,320 @@
+// linkit_transform: applies a rigid/affine/projective transform to a binary point cloud of any
+// size with constant memory.
+//
+//   linkit_transform [options] <input> <output>
+//     --matrix "m00 m01 ... m33"   row-major Matrix4 (applied after the TRS options)
+//     --translate "x y z"          translation
+//     --rotate "w x y z"           rotation quaternion (normalized on input)
+//     --scale "x y z" | s          scale
+//     --format ply|xyz32|xyz64     input layout; default: ply for *.ply, otherwise xyz32
+//     --chunk-mb N                 I/O chunk size (default 32)
+//     --buffers N                  chunks in flight (default 4, at least 3)
+//
+// PLY input must be binary_little_endian with the vertex list first; the header and anything
+// after the vertices (faces, ...) are copied unchanged, normals are rotated with the points.
+// A reader, a transform and a writer thread hand fixed-size chunks around a bounded pool, so
+// reading the next chunk, transforming the current one on the job system and writing the
+// previous one overlap, and memory use is buffers * chunk size regardless of the input size.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "linkit/format.h"
+#include "linkit/matrix4.h"
+#include "linkit/point_records.h"
+#include "linkit/quaternion.h"
+#include "linkit/vector3.h"
+using namespace linkit;
+
+namespace
+{
+    struct Chunk
+    {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size = 0;           // Bytes filled
+        std::size_t record_bytes = 0;   // Leading bytes holding whole point records
+    };
+
+    // Bounded hand-off between pipeline stages. pop() returns nullptr once the queue is closed
+    // and drained.
+    class ChunkQueue
+    {
+    public:
+        void push(Chunk* chunk)
+        {
+            {
+                std::lock_guard lock(_mutex);
+                _chunks.push_back(chunk);
+            }
+            _ready.notify_one();
+        }
+
+        Chunk* pop()
+        {
+            std::unique_lock lock(_mutex);
+            _ready.wait(lock, [this] { return !_chunks.empty() || _closed; });
+            if (_chunks.empty()) return nullptr;
+            Chunk* chunk = _chunks.front();
+            _chunks.pop_front();
+            return chunk;
+        }
+
+        void close()
+        {
+            {
+                std::lock_guard lock(_mutex);
+                _closed = true;
+            }
+            _ready.notify_all();
+        }
+
+    private:
+        std::mutex _mutex;
+        std::condition_variable _ready;
+        std::deque<Chunk*> _chunks;
+        bool _closed = false;
+    };
+
+    struct FileCloser
+    {
+        void operator()(std::FILE* file) const
+        {
+            if (file) std::fclose(file);
+        }
+    };
+    using File = std::unique_ptr<std::FILE, FileCloser>;
+
+    // Parses the whole of [first, last); trailing text after a valid value is an error.
+    template <typename T>
+    bool parse_all(const char* first, const char* last, T& value)
+    {
+        using std::from_chars;
+        const std::from_chars_result r = from_chars(first, last, value);
+        return r.ec == std::errc() && r.ptr == last;
+    }
+
+    int usage()
+    {
+        std::fprintf(stderr,
+                     "usage: linkit_transform [--matrix M] [--translate V] [--rotate Q] [--scale V|s]\n"
+                     "                        [--format ply|xyz32|xyz64] [--chunk-mb N] [--buffers N] <input> <output>\n");
+        return 1;
+    }
+
+    bool ends_with(const std::string_view text, const std::string_view suffix)
+    {
+        return text.size() >= suffix.size() && text.substr(text.size() - suffix.size()) == suffix;
+    }
+
+    // Reads the PLY header byte by byte up to and including the end_header line.
+    bool read_ply_header(std::FILE* input, std::string& header)
+    {
+        int c;
+        while ((c = std::fgetc(input)) != EOF)
+        {
+            header.push_back(static_cast<char>(c));
+            if (c == '\n' && (ends_with(header, "end_header\n") || ends_with(header, "end_header\r\n"))) return true;
+            if (header.size() > (1u << 20)) return false;
+        }
+        return false;
+    }
+
+    std::size_t fill(std::FILE* input, std::byte* data, const std::size_t capacity)
+    {
+        std::size_t size = 0;
+        while (size < capacity)
+        {
+            const std::size_t got = std::fread(data + size, 1, capacity - size, input);
+            if (got == 0) break;
+            size += got;
+        }
+        return size;
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    Vector3 translation, scale(1, 1, 1);
+    Quaternion rotation;
+    std::optional<Matrix4> matrix;
+    std::string format;
+    std::size_t chunk_mb = 32, buffer_count = 4;
+    std::vector<const char*> paths;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        const char* value = has_value ? argv[i + 1] : "";
+        const char* value_end = value + std::strlen(value);
+        bool ok = true;
+        if (arg == "--matrix" && has_value)
+        {
+            Matrix4 m;
+            ok = parse_all(value, value_end, m);
+            matrix = m;
+        }
+        else if (arg == "--translate" && has_value)
+            ok = parse_all(value, value_end, translation);
+        else if (arg == "--rotate" && has_value)
+        {
+            ok = parse_all(value, value_end, rotation);
+            rotation.normalize();
+        }
+        else if (arg == "--scale" && has_value)
+        {
+            if (!parse_all(value, value_end, scale))
+            {
+                real s = 0;
+                ok = parse_all(value, value_end, s);
+                scale = Vector3(s, s, s);
+            }
+        }
+        else if (arg == "--format" && has_value)
+            format = value;
+        else if (arg == "--chunk-mb" && has_value)
+            chunk_mb = std::strtoull(value, nullptr, 10);
+        else if (arg == "--buffers" && has_value)
+            buffer_count = std::strtoull(value, nullptr, 10);
+        else if (arg.starts_with("--"))
+            return usage();
+        else
+        {
+            paths.push_back(argv[i]);
+            continue;
+        }
+        if (!ok)
+        {
+            std::fprintf(stderr, "linkit_transform: cannot parse %s \"%s\"\n", argv[i], value);
+            return 1;
+        }
+        ++i;
+    }
+    if (paths.size() != 2 || chunk_mb == 0) return usage();
+    buffer_count = std::max<std::size_t>(buffer_count, 3);
+    if (format.empty()) format = ends_with(paths[0], ".ply") || ends_with(paths[0], ".PLY") ? "ply" : "xyz32";
+
+    Matrix4 transform = Matrix4::object_transform_matrix(translation, rotation, scale);
+    if (matrix) transform = *matrix * transform;
+
+    const File input(std::fopen(paths[0], "rb"));
+    if (!input)
+    {
+        std::fprintf(stderr, "linkit_transform: cannot open %s\n", paths[0]);
+        return 2;
+    }
+    const File output(std::fopen(paths[1], "wb"));
+    if (!output)
+    {
+        std::fprintf(stderr, "linkit_transform: cannot create %s\n", paths[1]);
+        return 2;
+    }
+    // Chunks are already large; stdio buffering would only add a copy
+    std::setvbuf(input.get(), nullptr, _IONBF, 0);
+
+    PointLayout layout;
+    std::string header;
+    if (format == "ply")
+    {
+        if (!read_ply_header(input.get(), header) || !parse_ply_header(header, layout))
+        {
+            std::fprintf(stderr, "linkit_transform: %s is not a binary little-endian PLY with a leading vertex list\n", paths[0]);
+            return 2;
+        }
+    }
+    else if (format == "xyz32" || format == "xyz64")
+        layout = PointLayout::xyz(format == "xyz32" ? ScalarType::float32 : ScalarType::float64);
+    else
+        return usage();
+    std::setvbuf(output.get(), nullptr, _IONBF, 0);
+    if (!header.empty() && std::fwrite(header.data(), 1, header.size(), output.get()) != header.size())
+    {
+        std::fprintf(stderr, "linkit_transform: write to %s failed\n", paths[1]);
+        return 2;
+    }
+
+    // Chunks hold whole records so a record never straddles two of them
+    const std::size_t chunk_bytes = std::max<std::size_t>(chunk_mb * (1u << 20) / layout.stride, 1) * layout.stride;
+    std::vector<Chunk> chunks(buffer_count);
+    ChunkQueue free_chunks, read_chunks, transformed_chunks;
+    for (Chunk& chunk : chunks)
+    {
+        chunk.data = std::make_unique<std::byte[]>(chunk_bytes);
+        free_chunks.push(&chunk);
+    }
+
+    bool read_failed = false;
+    std::atomic<bool> write_failed = false;
+    std::uint64_t records_done = 0, bytes_total = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    std::jthread reader([&] {
+        // Bytes of point records still to come; unbounded for headerless XYZ
+        std::uint64_t record_bytes_left = layout.count > 0 ? layout.count * layout.stride : UINT64_MAX;
+        while (!write_failed.load(std::memory_order_relaxed))
+        {
+            Chunk* chunk = free_chunks.pop();
+            chunk->size = fill(input.get(), chunk->data.get(), chunk_bytes);
+            if (chunk->size == 0)
+            {
+                read_failed = std::ferror(input.get()) != 0;
+                free_chunks.push(chunk);
+                break;
+            }
+            const std::uint64_t records = std::min<std::uint64_t>(chunk->size, record_bytes_left);
+            chunk->record_bytes = static_cast<std::size_t>(records - records % layout.stride);
+            if (record_bytes_left != UINT64_MAX) record_bytes_left -= chunk->record_bytes;
+            read_chunks.push(chunk);
+        }
+        read_chunks.close();
+    });
+
+    std::jthread transformer([&] {
+        while (Chunk* chunk = read_chunks.pop())
+        {
+            records_done += transform_records(std::span<std::byte>(chunk->data.get(), chunk->record_bytes), layout, transform);
+            transformed_chunks.push(chunk);
+        }
+        transformed_chunks.close();
+    });
+
+    std::jthread writer([&] {
+        while (Chunk* chunk = transformed_chunks.pop())
+        {
+            // After a failed write the reader stops and chunks in flight are drained unwritten
+            if (!write_failed && std::fwrite(chunk->data.get(), 1, chunk->size, output.get()) != chunk->size)
+                write_failed = true;
+            bytes_total += chunk->size;
+            free_chunks.push(chunk);
+        }
+    });
+
+    reader.join();
+    transformer.join();
+    writer.join();
+
+    if (read_failed || write_failed || std::fflush(output.get()) != 0)
+    {
+        std::fprintf(stderr, "linkit_transform: %s failed\n", read_failed ? "read" : "write");
+        return 2;
+    }
+    if (layout.count > 0 && records_done != layout.count)
+        std::fprintf(stderr, "linkit_transform: warning: header declares %llu vertices, found %llu\n",
+                     static_cast<unsigned long long>(layout.count), static_cast<unsigned long long>(records_done));
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%llu points, %.1f MB in %.2f s (%.1f MB/s)\n", static_cast<unsigned long long>(records_done),
+                 static_cast<double>(bytes_total) / 1e6, seconds, static_cast<double>(bytes_total) / 1e6 / std::max(seconds, 1e-9));
+    return 0;
+}